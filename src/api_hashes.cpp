@@ -1,6 +1,7 @@
 #include "server.h"
 #include "client.h"
 #include "type_hash.h"
+#include "glob_pattern.h"
 
 namespace rediscpp
 {
@@ -109,6 +110,40 @@ namespace rediscpp
 	{
 		return api_hgetall_internal(client, true, true);
 	}
+	///キーと値を少しずつ列挙する
+	///@note カーソルはキーのSCANと同じく逆順のビットで進めるので、途中でバケット数が変わっても続きから列挙する
+	///@note Available since 2.8.0.
+	bool server_type::api_hscan(client_type * client)
+	{
+		auto & key = *client->get_keys()[0];
+		bool is_valid = false;
+		uint64_t cursor = atou64(client->get_argument(2), is_valid);
+		if (!is_valid) {
+			throw std::runtime_error("ERR invalid cursor");
+		}
+		std::string pattern("*");
+		size_t count = 10;
+		parse_scan_options(client, 3, pattern, count, NULL);
+		glob_pattern_type matcher(pattern);
+		auto current = client->get_time();
+		auto db = readable_db(client);
+		std::shared_ptr<type_hash> hash = db->get_hash(key, current);
+		if (!hash) {
+			response_scan(client, 0, std::vector<std::string>());
+			return true;
+		}
+		std::vector<std::pair<const std::string*,const std::string*>> fields;
+		uint64_t next = hash->hscan(cursor, count, fields);
+		std::vector<std::string> items;
+		for (auto it = fields.begin(), end = fields.end(); it != end; ++it) {
+			if (matcher.match(*it->first)) {
+				items.push_back(*it->first);
+				items.push_back(*it->second);
+			}
+		}
+		response_scan(client, next, items);
+		return true;
+	}
 	///キーの全取得
 	///@note Available since 2.0.0.
 	bool server_type::api_hkeys(client_type * client)
@@ -137,21 +172,22 @@ namespace rediscpp
 			return true;
 		}
 		auto r = hash->hgetall();
+		reply_type reply(client);
 		if (keys && vals) {
-			client->response_start_multi_bulk(hash->size() * 2);
+			reply.multi_bulk(hash->size() * 2);
 			for (auto it = r.first, end = r.second; it != end; ++it) {
-				client->response_bulk(it->first);
-				client->response_bulk(it->second);
+				reply.bulk(it->first);
+				reply.bulk(it->second);
 			}
 		} else {
-			client->response_start_multi_bulk(hash->size());
+			reply.multi_bulk(hash->size());
 			if (keys) {
 				for (auto it = r.first, end = r.second; it != end; ++it) {
-					client->response_bulk(it->first);
+					reply.bulk(it->first);
 				}
 			} else {
 				for (auto it = r.first, end = r.second; it != end; ++it) {
-					client->response_bulk(it->second);
+					reply.bulk(it->second);
 				}
 			}
 		}
@@ -5,9 +5,20 @@
 #include "type_list.h"
 #include "type_set.h"
 #include "type_zset.h"
+#include "glob_pattern.h"
 
 namespace rediscpp
 {
+	namespace
+	{
+		const std::string type_names[5] = {
+			std::string("string"),
+			std::string("list"),
+			std::string("set"),
+			std::string("zset"),
+			std::string("hash"),
+		};
+	}
 	///キーをすべて列挙する
 	///@note Available since 1.0.0.
 	bool server_type::api_keys(client_type * client)
@@ -16,12 +27,154 @@ namespace rediscpp
 		auto & pattern = client->get_argument(1);
 		std::unordered_set<std::string> keys;
 		db->match(keys, pattern);
-		client->response_start_multi_bulk(keys.size());
+		reply_type reply(client);
+		reply.multi_bulk(keys.size());
 		for (auto it = keys.begin(), end = keys.end(); it != end; ++it) {
-			client->response_bulk(*it);
+			reply.bulk(*it);
+		}
+		return true;
+	}
+	///キーを少しずつ列挙する
+	///@note カーソルの下位6ビットがshard、残りがshardの辞書のカーソルで、一度に一つのshardだけをロックする
+	///@note 見るグループの数をCOUNTの10倍までにするので、一致するキーが少なくても一度の呼び出しは短い
+	///@note Available since 2.8.0.
+	bool server_type::api_scan(client_type * client)
+	{
+		bool is_valid = false;
+		uint64_t cursor = atou64(client->get_argument(1), is_valid);
+		if (!is_valid) {
+			throw std::runtime_error("ERR invalid cursor");
+		}
+		std::string pattern("*");
+		std::string type;
+		size_t count = 10;
+		parse_scan_options(client, 2, pattern, count, &type);
+		glob_pattern_type matcher(pattern);
+		int type_index = -1;
+		if (!type.empty()) {
+			for (int i = 0; i < 5; ++i) {
+				if (type == type_names[i]) {
+					type_index = i;
+				}
+			}
+			if (type_index < 0) {
+				//存在しない型のキーは無い
+				response_scan(client, 0, std::vector<std::string>());
+				return true;
+			}
+		}
+		const uint64_t shard_mask = database_type::max_shard_count - 1;
+		const int index = client->get_db_index();
+		const size_t shard_count = databases.at(index)->get_shard_count();
+		size_t shard = cursor & shard_mask;
+		uint64_t position = cursor >> 6;
+		if (shard_count <= shard) {
+			throw std::runtime_error("ERR invalid cursor");
+		}
+		auto current = client->get_time();
+		std::vector<std::string> keys;
+		for (size_t steps = 0, max_steps = count * 10; keys.size() < count && steps < max_steps; ) {
+			{
+				auto db = readable_db(index, client, static_cast<shard_mask_type>(1) << shard);
+				do {
+					position = db->scan(shard, position, [&](const dictionary_entry_type & entry) {
+						if (db->is_expired(shard, entry, current)) {
+							return;
+						}
+						if (0 <= type_index && entry.value->get_type() != type_index) {
+							return;
+						}
+						if (!matcher.match(entry.key)) {
+							return;
+						}
+						keys.push_back(entry.key);
+					});
+					++steps;
+				} while (position && keys.size() < count && steps < max_steps);
+			}
+			if (!position) {
+				if (++shard == shard_count) {
+					break;
+				}
+			}
 		}
+		response_scan(client, shard == shard_count ? 0 : (position << 6) | shard, keys);
 		return true;
 	}
+	///SCAN系のMATCH, COUNT, TYPEを読む
+	///@param[in] type TYPEを受け付けない時はNULL
+	void server_type::parse_scan_options(client_type * client, size_t start, std::string & pattern, size_t & count, std::string * type)
+	{
+		auto & arguments = client->get_arguments();
+		for (size_t i = start, n = arguments.size(); i < n; i += 2) {
+			std::string option = arguments[i];
+			std::transform(option.begin(), option.end(), option.begin(), toupper);
+			if (i + 1 == n) {
+				throw std::runtime_error("ERR syntax error");
+			}
+			auto & value = arguments[i + 1];
+			if (option == "MATCH") {
+				pattern = value;
+			} else if (option == "COUNT") {
+				bool is_valid = false;
+				int64_t parsed = atoi64(value, is_valid);
+				if (!is_valid || parsed < 1) {
+					throw std::runtime_error("ERR value is not an integer or out of range");
+				}
+				count = static_cast<size_t>(parsed);
+			} else if (type && option == "TYPE") {
+				*type = value;
+			} else {
+				throw std::runtime_error("ERR syntax error");
+			}
+		}
+	}
+	///カーソルの番号、接続をまたいで古いカーソルと一致しないように全体で振る
+	static std::atomic<uint64_t> scan_cursor_sequence((static_cast<uint64_t>(time(NULL)) << 20) | 1);
+	///SSCAN, ZSCANの続きのメンバーを接続毎に覚えて、カーソルを返す
+	///@note 他の接続の列挙では捨てられず、この接続で古いカーソルから捨てる
+	uint64_t client_type::save_scan_cursor(const std::string & member)
+	{
+		uint64_t cursor = scan_cursor_sequence++;
+		if (!cursor) {
+			cursor = scan_cursor_sequence++;
+		}
+		scan_cursors[cursor] = member;
+		scan_cursor_order.push_back(cursor);
+		while (max_scan_cursors < scan_cursor_order.size()) {
+			scan_cursors.erase(scan_cursor_order.front());
+			scan_cursor_order.pop_front();
+		}
+		return cursor;
+	}
+	///@return 0なら最初から、この接続が返したカーソルなら続きのメンバーを設定してtrue
+	bool client_type::load_scan_cursor(const std::string & cursor_string, std::string & member)
+	{
+		bool is_valid = false;
+		uint64_t cursor = atou64(cursor_string, is_valid);
+		if (!is_valid) {
+			throw std::runtime_error("ERR invalid cursor");
+		}
+		if (!cursor) {
+			return false;
+		}
+		auto it = scan_cursors.find(cursor);
+		if (it == scan_cursors.end()) {
+			throw std::runtime_error("ERR invalid cursor");
+		}
+		member = it->second;
+		return true;
+	}
+	void server_type::response_scan(client_type * client, uint64_t cursor, const std::vector<std::string> & items)
+	{
+		reply_type reply(client);
+		reply.multi_bulk(2);
+		reply.bulk(format("%" PRIu64, cursor));
+		reply.multi_bulk(items.size());
+		for (auto it = items.begin(), end = items.end(); it != end; ++it) {
+			reply.bulk(*it);
+		}
+	}
 	///キーを削除する
 	///@note Available since 1.0.0.
 	bool server_type::api_del(client_type * client)
@@ -39,6 +192,13 @@ namespace rediscpp
 		client->response_integer(removed);
 		return true;
 	}
+	///キーを削除する
+	///@note 大きな値はDELでも別スレッドで解放するので、DELと同じ
+	///@note Available since 4.0.0.
+	bool server_type::api_unlink(client_type * client)
+	{
+		return api_del(client);
+	}
 	///キーの存在確認
 	///@note Available since 1.0.0.
 	bool server_type::api_exists(client_type * client)
@@ -103,13 +263,10 @@ namespace rediscpp
 		}
 		auto & key = client->get_argument(1);
 		auto db = writable_db(client);
-		auto value = db->get_with_expire(key, current);
-		if (!value.second) {
+		if (!db->expire(key, tv, current)) {
 			client->response_integer0();
 			return true;
 		}
-		value.first->expire(tv);
-		db->regist_expiring_key(tv, key);
 		client->response_integer1();
 		return true;
 	}
@@ -120,11 +277,9 @@ namespace rediscpp
 		auto db = writable_db(client);
 		auto & key = client->get_argument(1);
 		auto current = client->get_time();
-		auto value = db->get_with_expire(key, current);
-		if (!value.second) {
+		if (!db->persist(key, current)) {
 			client->response_integer0();
 		} else {
-			value.first->persist();
 			client->response_integer1();
 		}
 		return true;
@@ -151,11 +306,11 @@ namespace rediscpp
 			client->response_integer(-2);
 			return true;
 		}
-		if (!value.first->is_expiring()) {
+		if (!value.first.is_expiring()) {
 			client->response_integer(-1);
 			return true;
 		}
-		timeval_type ttl = value.first->ttl(current);
+		timeval_type ttl = value.first.ttl(current);
 		uint64_t result = ttl.tv_sec * 1000 + ttl.tv_usec / 1000;
 		if (sec) {
 			result /= 1000;
@@ -170,7 +325,7 @@ namespace rediscpp
 		int dst_index = atoi64(client->get_argument(2));
 		if (dst_index == client->get_db_index()) {
 			client->response_integer0();
-			return 0;
+			return true;
 		}
 		int src_index = client->get_db_index();
 		std::map<int,std::shared_ptr<database_write_locker>> dbs;
@@ -191,9 +346,9 @@ namespace rediscpp
 			client->response_integer0();
 			return true;
 		}
-		if (!dst_db->insert(key, *value.first, value.second, current)) {
+		if (!dst_db->insert(key, value.first, value.second, current)) {
 			client->response_integer0();
-			return false;
+			return true;
 		}
 		src_db->erase(key, current);
 		client->response_integer1();
@@ -203,7 +358,7 @@ namespace rediscpp
 	///@note Available since 1.0.0.
 	bool server_type::api_randomkey(client_type * client)
 	{
-		auto db = writable_db(client);
+		auto db = readable_db(client);
 		auto current = client->get_time();
 		auto value = db->randomkey(current);
 		if (value.empty()) {
@@ -229,7 +384,7 @@ namespace rediscpp
 			throw std::runtime_error("ERR same key");
 		}
 		db->erase(key, current);
-		db->replace(newkey, *value.first, value.second);
+		db->replace(newkey, value.first, value.second);
 		client->response_ok();
 		return true;
 	}
@@ -253,7 +408,7 @@ namespace rediscpp
 			client->response_integer0();
 			return true;
 		}
-		if (!db->insert(newkey, *value.first, value.second, current)) {
+		if (!db->insert(newkey, value.first, value.second, current)) {
 			throw std::runtime_error("ERR internal error");
 		}
 		db->erase(key, current);
@@ -267,19 +422,46 @@ namespace rediscpp
 		auto db = readable_db(client);
 		auto & key = client->get_argument(1);
 		auto current = client->get_time();
-		auto value = db->get(key, current);
+		auto value = db->peek(key, current);
 		if (!value) {
 			client->response_status("none");
 			return true;
 		}
-		static const std::string types[5] = {
-			std::string("string"), 
-			std::string("list"), 
-			std::string("set"), 
-			std::string("zset"), 
-			std::string("hash"), 
-		};
-		client->response_status(types[value->get_type()]);
+		client->response_status(type_names[value->get_type()]);
+		return true;
+	}
+	///キーの参照の情報
+	///@note FREQ, IDLETIMEのみ対応、参照としては数えない
+	///@note Available since 2.2.3.
+	bool server_type::api_object(client_type * client)
+	{
+		auto subcommand = client->get_argument(1);
+		std::transform(subcommand.begin(), subcommand.end(), subcommand.begin(), toupper);
+		auto db = readable_db(client);
+		auto & key = client->get_argument(2);
+		auto current = client->get_time();
+		auto value = db->peek(key, current);
+		if (subcommand == "FREQ") {
+			if (!type_interface::lfu_mode) {
+				throw std::runtime_error("ERR An LFU maxmemory policy is not selected, access frequency not tracked.");
+			}
+			if (!value) {
+				client->response_null();
+				return true;
+			}
+			client->response_integer(value->get_freq(current));
+		} else if (subcommand == "IDLETIME") {
+			if (type_interface::lfu_mode) {
+				throw std::runtime_error("ERR An LFU maxmemory policy is selected, idle time not tracked.");
+			}
+			if (!value) {
+				client->response_null();
+				return true;
+			}
+			client->response_integer(value->get_idle(current));
+		} else {
+			throw std::runtime_error("ERR syntax error");
+		}
 		return true;
 	}
 	template<typename T1, typename T2>
@@ -598,7 +780,7 @@ namespace rediscpp
 			sort(db, values, by, by_pattern, numeric, current);
 		}
 		std::list<bool> nulls;
-		std::list<std::string> list_values;
+		type_list::container_type list_values;
 		size_t list_count = 0;
 		if (get_pattern.empty()) {
 			get_pattern.push_back(pattern_type("#"));
@@ -662,6 +844,11 @@ namespace rediscpp
 		std::shared_ptr<type_list> result(new type_list());
 		result->move(std::move(list_values), list_count);
 		if (store) {
+			if (result->empty()) {
+				db->erase(destination, current);
+			} else {
+				db->replace(destination, result);
+			}
 			client->response_integer(result->size());
 		} else {
 			client->response_start_multi_bulk(result->size());
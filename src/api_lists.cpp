@@ -80,11 +80,7 @@ namespace rediscpp
 				}
 				//新規追加の場合は通知する
 				if (created) {
-					if (client->in_exec()) {
-						notify_list_pushed();
-					} else {
-						excecute_blocked_client();
-					}
+					notify_list_pushed();//ロックを解放してから待機中のクライアントを処理する
 				}
 				return true;
 			}
@@ -140,11 +136,7 @@ namespace rediscpp
 		client->response_bulk(result);
 		//新規追加の場合は通知する
 		if (created) {
-			if (client->in_exec()) {
-				notify_list_pushed();
-			} else {
-				excecute_blocked_client();
-			}
+			notify_list_pushed();//ロックを解放してから待機中のクライアントを処理する
 		}
 		return true;
 	}
@@ -205,11 +197,7 @@ namespace rediscpp
 		client->response_integer(list->size());
 		//新規追加時の通知
 		if (created) {
-			if (client->in_exec()) {
-				notify_list_pushed();
-			} else {
-				excecute_blocked_client();
-			}
+			notify_list_pushed();//ロックを解放してから待機中のクライアントを処理する
 		}
 		return true;
 	}
@@ -328,9 +316,10 @@ namespace rediscpp
 		}
 		size_t count = end - start;
 		auto range = list->get_range(start, end);
-		client->response_start_multi_bulk(count);
+		reply_type reply(client);
+		reply.multi_bulk(count);
 		for (auto it = range.first, end = range.second; it != end; ++it) {
-			client->response_bulk(*it);
+			reply.bulk(*it);
 		}
 		return true;
 	}
@@ -5,6 +5,23 @@
 
 namespace rediscpp
 {
+	///FLUSHALL, FLUSHDBのASYNC, SYNCの指定
+	static bool is_async_flush(client_type * client)
+	{
+		auto & arguments = client->get_arguments();
+		if (arguments.size() < 2) {
+			return false;
+		}
+		std::string mode = arguments[1];
+		std::transform(mode.begin(), mode.end(), mode.begin(), toupper);
+		if (mode == "ASYNC") {
+			return true;
+		}
+		if (mode != "SYNC") {
+			throw std::runtime_error("ERR syntax error");
+		}
+		return false;
+	}
 	///データベースのキー数取得 
 	///@note Available since 1.0.0.
 	bool server_type::api_dbsize(client_type * client)
@@ -15,11 +32,13 @@ namespace rediscpp
 	}
 	///データベースの全キー消去 
 	///@note Available since 1.0.0.
+	///@note ASYNCではキーの辞書を切り離して、別スレッドで解放する
 	bool server_type::api_flushall(client_type * client)
 	{
+		const bool async = is_async_flush(client);
 		for (int i = 0, n = databases.size(); i < n; ++i) {
 			auto db = writable_db(i, client);
-			db->clear();
+			db->clear(async);
 		}
 		client->response_ok();
 		return true;
@@ -28,8 +47,9 @@ namespace rediscpp
 	///@note Available since 1.0.0.
 	bool server_type::api_flushdb(client_type * client)
 	{
+		const bool async = is_async_flush(client);
 		auto db = writable_db(client);
-		db->clear();
+		db->clear(async);
 		client->response_ok();
 		return true;
 	}
@@ -122,5 +142,133 @@ namespace rediscpp
 		append_client(client->get());
 		return true;
 	}
+	///サーバ情報
+	///@note server, memory, statsのセクションのみ対応
+	///@note Available since 1.0.0
+	bool server_type::api_information(client_type * client)
+	{
+		auto & arguments = client->get_arguments();
+		std::string section = "default";
+		if (1 < arguments.size()) {
+			section = arguments[1];
+			std::transform(section.begin(), section.end(), section.begin(), tolower);
+		}
+		const bool all = (section == "default" || section == "all");
+		std::string info;
+		if (all || section == "server") {
+			info += "# Server\r\n";
+			info += format("tcp_port:%u\r\n", listening_port);
+			info += format("thread_count:%zu\r\n", thread_pool.size());
+			info += format("poll_batch_size:%zu\r\n", poll_batch_size);
+			info += format("reactor_mode:%d\r\n", reactor_mode ? 1 : 0);
+			info += format("poll_engine:%s\r\n", poll->get_engine_name());
+			info += format("crlf_scanner:%s\r\n", get_scanner_name());
+			info += format("database_shards:%zu\r\n", databases.front()->get_shard_count());
+		}
+		if (all || section == "memory") {
+			if (!info.empty()) {
+				info += "\r\n";
+			}
+			info += "# Memory\r\n";
+			info += format("used_memory:%zu\r\n", get_used_memory());
+			info += format("used_memory_keys:%" PRId64 "\r\n", static_cast<int64_t>(dictionary_type::used_memory));
+			info += format("used_memory_values:%" PRId64 "\r\n", static_cast<int64_t>(type_interface::used_memory));
+			//RSSを論理的な使用量で割った値と、節のプールの切り出し済みの領域の使用率
+			const size_t used_memory = get_used_memory();
+			const size_t rss = get_used_memory_rss();
+			info += format("used_memory_rss:%zu\r\n", rss);
+			info += format("mem_fragmentation_ratio:%.2f\r\n", used_memory ? static_cast<double>(rss) / used_memory : 0.0);
+			std::vector<node_pool_type::statistics_type> pools;
+			node_pool_type::get_statistics(pools);
+			size_t pool_reserved = 0;
+			int64_t pool_used = 0;
+			std::string pool_classes;
+			for (auto it = pools.begin(), end = pools.end(); it != end; ++it) {
+				if (!it->reserved_blocks) {
+					continue;
+				}
+				pool_reserved += it->reserved_blocks * it->block_size;
+				pool_used += it->used_blocks * static_cast<int64_t>(it->block_size);
+				pool_classes += format("node_pool_class_%zu:reserved=%zu,used=%" PRId64 "\r\n", it->block_size, it->reserved_blocks, it->used_blocks);
+			}
+			info += format("node_pool_reserved:%zu\r\n", pool_reserved);
+			info += format("node_pool_used:%" PRId64 "\r\n", pool_used);
+			info += format("node_pool_occupancy:%.2f\r\n", pool_reserved ? static_cast<double>(pool_used) / pool_reserved : 0.0);
+			info += pool_classes;
+			info += format("maxmemory:%zu\r\n", maxmemory);
+			info += format("maxmemory_policy:%s\r\n", get_maxmemory_policy_name(maxmemory_policy));
+		}
+		if (all || section == "stats") {
+			const uint64_t commands = command_count;
+			//reactorモードではスレッド毎のpollの合計
+			uint64_t waits = poll->get_wait_count();
+			uint64_t events = poll->get_event_count();
+			uint64_t modifies = poll->get_modify_count();
+			uint64_t deferred = poll->get_deferred_count();
+			uint64_t poll_syscalls = poll->get_syscall_count();
+			for (auto it = reactors.begin(), end = reactors.end(); it != end; ++it) {
+				const poll_type & reactor_poll = (*it)->get_poll();
+				waits += reactor_poll.get_wait_count();
+				events += reactor_poll.get_event_count();
+				modifies += reactor_poll.get_modify_count();
+				deferred += reactor_poll.get_deferred_count();
+				poll_syscalls += reactor_poll.get_syscall_count();
+			}
+			const uint64_t recvs = socket_type::recv_call_count;
+			const uint64_t sends = socket_type::send_call_count;
+			if (!info.empty()) {
+				info += "\r\n";
+			}
+			info += "# Stats\r\n";
+			info += format("total_commands_processed:%" PRIu64 "\r\n", commands);
+			info += format("pipeline_batches:%" PRIu64 "\r\n", static_cast<uint64_t>(batch_count));
+			info += format("pipeline_batched_commands:%" PRIu64 "\r\n", static_cast<uint64_t>(batched_command_count));
+			const uint64_t rehash_total = dictionary_type::rehash_total_slots;
+			const uint64_t rehash_pending = dictionary_type::rehash_pending_slots;
+			info += format("rehash_started:%" PRIu64 "\r\n", static_cast<uint64_t>(dictionary_type::rehash_started));
+			info += format("rehash_active:%" PRIu64 "\r\n", static_cast<uint64_t>(dictionary_type::rehash_active));
+			info += format("rehash_progress:%.2f\r\n", rehash_total ? 100.0 * (rehash_total - rehash_pending) / rehash_total : 100.0);
+			info += format("rehash_max_step_usec:%" PRIu64 "\r\n", static_cast<uint64_t>(dictionary_type::rehash_max_step_ns) / 1000);
+			info += format("expired_keys:%" PRIu64 "\r\n", static_cast<uint64_t>(expired_key_count));
+			info += format("expired_keys_per_sec:%" PRIu64 "\r\n", static_cast<uint64_t>(expired_keys_per_sec));
+			info += format("lazy_expire_queued:%" PRIu64 "\r\n", static_cast<uint64_t>(database_type::lazy_expire_queued));
+			info += format("lazy_expire_pending:%" PRIu64 "\r\n", static_cast<uint64_t>(database_type::lazy_expire_pending));
+			info += format("lazy_expired_keys:%" PRIu64 "\r\n", static_cast<uint64_t>(database_type::lazy_expired_keys));
+			info += format("lazyfree_pending_objects:%" PRIu64 "\r\n", static_cast<uint64_t>(lazyfree_type::pending_objects));
+			info += format("lazyfree_pending_bytes:%" PRIu64 "\r\n", static_cast<uint64_t>(lazyfree_type::pending_bytes));
+			info += format("lazyfreed_objects:%" PRIu64 "\r\n", static_cast<uint64_t>(lazyfree_type::freed_objects));
+			info += format("expire_cycles:%" PRIu64 "\r\n", static_cast<uint64_t>(expire_cycle_count));
+			info += format("expire_cycle_last_usec:%" PRIu64 "\r\n", static_cast<uint64_t>(expire_cycle_last_ns) / 1000);
+			info += format("expire_cycle_max_usec:%" PRIu64 "\r\n", static_cast<uint64_t>(expire_cycle_max_ns) / 1000);
+			info += format("expire_cycle_interval_msec:%" PRIu64 "\r\n", static_cast<uint64_t>(expire_cycle_interval_ms));
+			const uint64_t evictions = eviction_count;
+			info += format("evicted_keys:%" PRIu64 "\r\n", static_cast<uint64_t>(evicted_keys));
+			info += format("eviction_commands:%" PRIu64 "\r\n", evictions);
+			info += format("eviction_usec:%" PRIu64 "\r\n", static_cast<uint64_t>(eviction_total_ns) / 1000);
+			info += format("eviction_max_usec:%" PRIu64 "\r\n", static_cast<uint64_t>(eviction_max_ns) / 1000);
+			info += format("eviction_usec_per_command:%.2f\r\n", evictions ? static_cast<double>(eviction_total_ns) / evictions / 1000 : 0.0);
+			info += format("oom_rejected_commands:%" PRIu64 "\r\n", static_cast<uint64_t>(oom_rejected_count));
+			info += format("poll_wait_calls:%" PRIu64 "\r\n", waits);
+			info += format("poll_events:%" PRIu64 "\r\n", events);
+			info += format("poll_events_per_wakeup:%.2f\r\n", waits ? static_cast<double>(events) / waits : 0.0);
+			info += format("poll_modify_calls:%" PRIu64 "\r\n", modifies);
+			info += format("poll_deferred_modify:%" PRIu64 "\r\n", deferred);
+			info += format("poll_syscalls:%" PRIu64 "\r\n", poll_syscalls);
+			info += format("recv_calls:%" PRIu64 "\r\n", recvs);
+			info += format("recv_completions:%" PRIu64 "\r\n", static_cast<uint64_t>(socket_type::recv_completion_count));
+			info += format("accept_completions:%" PRIu64 "\r\n", static_cast<uint64_t>(socket_type::accept_completion_count));
+			info += format("send_calls:%" PRIu64 "\r\n", sends);
+			info += format("send_submissions:%" PRIu64 "\r\n", static_cast<uint64_t>(socket_type::send_submission_count));
+			const uint64_t sent = socket_type::send_bytes;
+			info += format("send_bytes:%" PRIu64 "\r\n", sent);
+			info += format("send_bytes_per_call:%.2f\r\n", sends ? static_cast<double>(sent) / sends : 0.0);
+			info += format("send_partial_writes:%" PRIu64 "\r\n", static_cast<uint64_t>(socket_type::partial_send_count));
+			info += format("send_chunks_allocated:%" PRIu64 "\r\n", send_buffer_type::get_allocated_count());
+			info += format("send_chunks_reused:%" PRIu64 "\r\n", send_buffer_type::get_reused_count());
+			info += format("syscalls_per_command:%.2f\r\n", commands ? static_cast<double>(poll_syscalls + recvs + sends) / commands : 0.0);
+		}
+		client->response_bulk(info);
+		return true;
+	}
 	
 }
@@ -1,6 +1,7 @@
 #include "server.h"
 #include "client.h"
 #include "type_set.h"
+#include "glob_pattern.h"
 
 namespace rediscpp
 {
@@ -78,6 +79,37 @@ namespace rediscpp
 		}
 		return true;
 	}
+	///メンバーを少しずつ列挙する
+	///@note 集合は順序があるので、返した最後のメンバーを接続のカーソルに覚えて、その次から続ける
+	///@note Available since 2.8.0.
+	bool server_type::api_sscan(client_type * client)
+	{
+		auto & key = client->get_argument(1);
+		std::string after;
+		bool resume = client->load_scan_cursor(client->get_argument(2), after);
+		std::string pattern("*");
+		size_t count = 10;
+		parse_scan_options(client, 3, pattern, count, NULL);
+		glob_pattern_type matcher(pattern);
+		auto current = client->get_time();
+		auto db = readable_db(client);
+		std::shared_ptr<type_set> set = db->get_set(key, current);
+		if (!set) {
+			response_scan(client, 0, std::vector<std::string>());
+			return true;
+		}
+		std::vector<const std::string*> members;
+		members.reserve(count);
+		bool more = set->sscan(resume ? &after : NULL, count, members);
+		std::vector<std::string> items;
+		for (auto it = members.begin(), end = members.end(); it != end; ++it) {
+			if (matcher.match(**it)) {
+				items.push_back(**it);
+			}
+		}
+		response_scan(client, more && !members.empty() ? client->save_scan_cursor(*members.back()) : 0, items);
+		return true;
+	}
 	///メンバーを移動
 	///@note Available since 1.0.0.
 	bool server_type::api_smove(client_type * client)
@@ -137,7 +169,7 @@ namespace rediscpp
 			client->response_null();
 			return true;
 		}
-		std::vector<std::set<std::string>::const_iterator> randmember;
+		std::vector<type_set::container_type::const_iterator> randmember;
 		set->srandmember(1, randmember);
 		std::string member = *randmember[0];
 		set->erase(member);
@@ -167,7 +199,7 @@ namespace rediscpp
 			client->response_null();
 			return true;
 		}
-		std::vector<std::set<std::string>::const_iterator> randmembers;
+		std::vector<type_set::container_type::const_iterator> randmembers;
 		if (0 < count) {
 			set->srandmember_distinct(count, randmembers);
 		} else {
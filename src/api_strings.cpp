@@ -16,7 +16,11 @@ namespace rediscpp
 			client->response_null();
 			return true;
 		}
-		client->response_bulk(value->get());
+		if (value->is_int()) {
+			client->response_bulk(value->get());
+		} else {
+			client->response_bulk(value->get_shared());
+		}
 		return true;
 	}
 	///設定
@@ -109,14 +113,12 @@ namespace rediscpp
 				return true;
 			}
 		}
-		std::shared_ptr<type_string> str(new type_string(current));
-		str->set(value);
+		auto str = create_string(value, current);
 		expire_info info;
 		if (0 <= expire) {
 			timeval_type tv = current;
 			tv.add_msec(expire);
 			info.expire(tv);
-			db->regist_expiring_key(tv, key);
 		}
 		db->replace(key, info, str);
 		client->response_ok();
@@ -149,13 +151,12 @@ namespace rediscpp
 		auto current = client->get_time();
 		auto now = db->get_string(key, current);
 		if (now) {
+			now = unshare_string(db.get(), key, now, current);
 			int64_t len = now->append(value);
 			now->update(current);
 			client->response_integer(len);
 		} else {
-			std::shared_ptr<type_string> str(new type_string(current));
-			str->set(value);
-			db->replace(key, str);
+			db->replace(key, create_string(value, current));
 			client->response_integer(value.size());
 		}
 		return true;
@@ -209,6 +210,8 @@ namespace rediscpp
 		bool create = (!value);
 		if (create) {
 			value.reset(new type_string(current));
+		} else {
+			value = unshare_string(db.get(), key, value, current);
 		}
 		int64_t len = value->setrange(offset, newstr);
 		if (create) {
@@ -230,16 +233,12 @@ namespace rediscpp
 		auto current = client->get_time();
 		auto db = writable_db(client);
 		auto value = db->get_string(key, current);
-		bool create = (!value);
-		if (create) {
-			value.reset(new type_string(current));
-			value->set(newstr);
-			db->replace(key, value);
+		if (!value) {
+			db->replace(key, create_string(newstr, current));
 			client->response_null();
 		} else {
-			client->response_bulk(value->ref());
-			value->set(newstr);
-			value->update(current);
+			client->response_bulk(value->get_shared());
+			db->replace_value(key, create_string(newstr, current));
 		}
 		return true;
 	}
@@ -258,10 +257,13 @@ namespace rediscpp
 			auto value = std::dynamic_pointer_cast<type_string>(db->get(key, current));
 			if (!value) {
 				client->response_null();
-			} else {
+			} else if (value->is_int()) {
 				client->response_bulk(value->get());
+			} else {
+				client->response_bulk(value->get_shared());
 			}
 		}
+		return true;
 	}
 	///複数の値を設定する
 	///@param[in] key キー名
@@ -276,11 +278,10 @@ namespace rediscpp
 		for (auto kit = keys.begin(), kend = keys.end(), vit = values.begin(), vend = values.end(); kit != kend && vit != vend; ++kit, ++vit) {
 			auto & key = **kit;
 			auto & value = **vit;
-			std::shared_ptr<type_string> str(new type_string(current));
-			str->set(value);
-			db->replace(key, str);
+			db->replace(key, create_string(value, current));
 		}
 		client->response_ok();
+		return true;
 	}
 	///複数の値がすべて存在しない場合に設定する
 	///@param[in] key キー名
@@ -303,9 +304,7 @@ namespace rediscpp
 		for (auto kit = keys.begin(), kend = keys.end(), vit = values.begin(), vend = values.end(); kit != kend && vit != vend; ++kit, ++vit) {
 			auto & key = **kit;
 			auto & value = **vit;
-			std::shared_ptr<type_string> str(new type_string(current));
-			str->set(value);
-			db->replace(key, str);
+			db->replace(key, create_string(value, current));
 		}
 		client->response_integer1();
 		return true;
@@ -405,6 +404,40 @@ namespace rediscpp
 		}
 		return format("%Lg", newval);
 	}
+	///書き込む文字列の値を作る、共有の整数を使えればそれを返す
+	std::shared_ptr<type_string> server_type::create_string(const std::string & str, const timeval_type & current) const
+	{
+		int64_t value;
+		if (type_string::parse_integer(str, value)) {
+			return create_integer(value, current);
+		}
+		std::shared_ptr<type_string> result(new type_string(current));
+		result->set(str);
+		return result;
+	}
+	std::shared_ptr<type_string> server_type::create_integer(int64_t value, const timeval_type & current) const
+	{
+		if (is_sharing_integers()) {
+			auto shared = type_string::get_shared_integer(value);
+			if (shared) {
+				return shared;
+			}
+		}
+		std::shared_ptr<type_string> result(new type_string(current));
+		result->set_int(value);
+		return result;
+	}
+	///共有の整数の値を書き換える前に、有効期限を変えずにキー専用の値に置き換える
+	std::shared_ptr<type_string> server_type::unshare_string(database_type * db, const std::string & key, std::shared_ptr<type_string> value, const timeval_type & current)
+	{
+		if (!value->is_shared()) {
+			return value;
+		}
+		std::shared_ptr<type_string> result(new type_string(current));
+		result->set_int(value->get_int());
+		db->replace_value(key, result);
+		return result;
+	}
 	///加減算を実行する
 	bool server_type::api_incrdecr_internal(client_type * client, int64_t count)
 	{
@@ -412,17 +445,24 @@ namespace rediscpp
 		auto & key = client->get_argument(1);
 		auto current = client->get_time();
 		auto value = db->get_string(key, current);
-		bool created = false;
-		if (!value) {
-			value.reset(new type_string(current));
-			value->set("0");
-			created = true;
+		if (value && !value->is_shared()) {
+			int64_t newval = value->incrby(count);
+			//共有の整数にできれば、キー専用の値を解放する
+			auto shared = is_sharing_integers() ? type_string::get_shared_integer(newval) : std::shared_ptr<type_string>();
+			if (shared) {
+				db->replace_value(key, shared);
+			} else {
+				value->update(current);
+			}
+			client->response_integer(newval);
+			return true;
 		}
-		int64_t newval = value->incrby(count);
-		if (!created) {
-			value->update(current);
+		//共有の整数は書き換えずに、新しい値に置き換える
+		int64_t newval = type_string::add_integer(value ? value->get_int() : 0, count);
+		if (value) {
+			db->replace_value(key, create_integer(newval, current));
 		} else {
-			db->replace(key, value);
+			db->replace(key, create_integer(newval, current));
 		}
 		client->response_integer(newval);
 		return true;
@@ -441,10 +481,8 @@ namespace rediscpp
 		auto current = client->get_time();
 		auto value = db->get_string(key, current);
 		auto & increment = client->get_argument(2);
-		std::string newstr = incrbyfloat(value ? value->ref() : "0", increment);
-		std::shared_ptr<type_string> str(new type_string(current));
-		str->set(newstr);
-		db->replace(key, str);
+		std::string newstr = incrbyfloat(value ? value->get() : "0", increment);
+		db->replace(key, create_string(newstr, current));
 		client->response_bulk(newstr);
 		return true;
 	}
@@ -498,7 +536,7 @@ namespace rediscpp
 		}
 		auto current = client->get_time();
 		auto db = writable_db(client);
-		std::vector<const std::string*> srcvalues;
+		std::vector<std::shared_ptr<const std::string>> srcvalues;
 		srcvalues.reserve(keys.size() - 1);
 		size_t min_size = std::numeric_limits<size_t>::max();
 		size_t max_size = 0;
@@ -506,8 +544,8 @@ namespace rediscpp
 			auto & key = **it;
 			auto srcvalue = db->get_string(key, current);
 			if (srcvalue) {
-				srcvalues.push_back(&srcvalue->ref());
-				size_t size = srcvalue->ref().size();
+				srcvalues.push_back(srcvalue->get_shared());
+				size_t size = srcvalues.back()->size();
 				min_size = std::min(min_size, size);
 				max_size = std::max(max_size, size);
 			} else {
@@ -564,9 +602,7 @@ namespace rediscpp
 		if (max_size == 0) {
 			db->erase(destkey, current);
 		} else {
-			std::shared_ptr<type_string> str(new type_string(current));
-			str->set(deststrval);
-			db->replace(destkey, str);
+			db->replace(destkey, create_string(deststrval, current));
 		}
 		client->response_integer(max_size);
 		return true;
@@ -636,6 +672,7 @@ namespace rediscpp
 			client->response_integer0();
 			return true;
 		}
+		value = unshare_string(db.get(), key, value, current);
 		auto & string = value->ref();
 		if (string.size() <= offset_byte) {
 			string.resize(offset_byte + 1, '\0');
@@ -48,6 +48,60 @@ namespace rediscpp
 		client->response_ok();
 		return true;
 	}
+	///トランザクションで使うDB毎のshardを求める
+	///@note SELECTを辿って実行時のDBを決め、監視中のキーも含める
+	///@note 引数以外のキーを使うコマンドがあれば、すべてのDBのすべてのshardを使う
+	void client_type::get_transaction_shards(std::vector<shard_mask_type> & shards)
+	{
+		auto & databases = server.databases;
+		const int db_count = databases.size();
+		shards.assign(db_count, 0);
+		for (auto it = watching.begin(), end = watching.end(); it != end; ++it) {
+			int index = std::get<1>(*it);
+			shards[index] |= databases[index]->get_shard_mask(std::get<0>(*it));
+		}
+		int index = db_index;
+		for (auto it = transaction_arguments.begin(), end = transaction_arguments.end(); it != end; ++it) {
+			auto & args = *it;
+			const api_info * info = args.empty() ? NULL : server.api_map.find(args.front());
+			if (!info || args.size() < info->min_argc || info->max_argc < args.size()) {
+				continue;//実行時にエラーになる
+			}
+			if (info->dynamic_keys) {
+				for (int i = 0; i < db_count; ++i) {
+					shards[i] = databases[i]->get_all_shards();
+				}
+				return;
+			}
+			if (info->function == &server_type::api_select) {
+				int64_t selected = atoi64(args[1]);
+				if (0 <= selected && selected < db_count) {
+					index = selected;
+				}
+				continue;
+			}
+			//MOVEのように別のDBを指定するコマンドは、そのDBでも同じキーを使う
+			std::vector<int> indices(1, index);
+			for (size_t pos = 0, n = std::min(info->arg_types.size(), args.size()); pos < n; ++pos) {
+				if (info->arg_types[pos] == 'd') {
+					int64_t other = atoi64(args[pos]);
+					if (0 <= other && other < db_count) {
+						indices.push_back(other);
+					}
+				}
+			}
+			for (auto iit = indices.begin(), iend = indices.end(); iit != iend; ++iit) {
+				auto & database = *databases[*iit];
+				if (!info->plan.get_key_positions(args.size(), key_positions)) {
+					shards[*iit] = database.get_all_shards();
+					continue;
+				}
+				for (auto pit = key_positions.begin(), pend = key_positions.end(); pit != pend; ++pit) {
+					shards[*iit] |= database.get_shard_mask(args[*pit]);
+				}
+			}
+		}
+	}
 	bool client_type::unqueue()
 	{
 		if (transaction_arguments.empty()) {
@@ -64,10 +118,14 @@ namespace rediscpp
 		//監視していた値が変更されていないか確認する
 		auto & watching = client->get_watching();
 		auto current = client->get_time();
-		//全体ロックを行う
+		//トランザクションのキーのshardだけを、DBとshardの番号順にロックする
+		std::vector<shard_mask_type> shards;
+		client->get_transaction_shards(shards);
 		std::map<int,std::shared_ptr<database_write_locker>> dbs;
 		for (int i = 0; i < databases.size(); ++i) {
-			dbs[i].reset(new database_write_locker(writable_db(i, client, !client->writing_transaction)));
+			if (shards[i]) {
+				dbs[i].reset(new database_write_locker(writable_db(i, client, shards[i], !client->writing_transaction)));
+			}
 		}
 		for (auto it = watching.begin(), end = watching.end(); it != end; ++it) {
 			auto & watch = *it;
@@ -81,7 +139,7 @@ namespace rediscpp
 				return true;
 			}
 			auto watching_time = std::get<2>(watch);
-			if (watching_time < value->get_last_modified_time()) {
+			if (watching_time < value->get_last_modified_time() || value.get() != std::get<3>(watch)) {
 				client->response_null_multi_bulk();
 				client->discard();
 				return true;
@@ -118,17 +176,30 @@ namespace rediscpp
 		client->response_ok();
 		return true;
 	}
-	void client_type::watch(const std::string & key)
+	///@note 共有の整数の値は更新時間がキー毎に変わらないので、値そのものも覚えておく
+	void client_type::watch(const std::string & key, const type_interface * value)
 	{
-		watching.insert(std::tuple<std::string,int,timeval_type>(key, db_index, timeval_type()));
+		if (watching.empty()) {
+			++server.watching_clients;
+		}
+		watching.insert(std::tuple<std::string,int,timeval_type,const type_interface *>(key, db_index, timeval_type(), value));
+	}
+	void client_type::unwatch()
+	{
+		if (!watching.empty()) {
+			--server.watching_clients;
+			watching.clear();
+		}
 	}
 	///値の変更の監視
 	///@note Available since 2.2.0.
 	bool server_type::api_watch(client_type * client)
 	{
 		auto & arguments = client->get_arguments();
+		auto db = readable_db(client);
+		auto current = client->get_time();
 		for (int i = 1, n = arguments.size(); i < n; ++i) {
-			client->watch(arguments[i]);
+			client->watch(arguments[i], db->peek(arguments[i], current).get());
 		}
 		client->response_ok();
 		return true;
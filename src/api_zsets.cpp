@@ -1,6 +1,7 @@
 #include "server.h"
 #include "client.h"
 #include "type_zset.h"
+#include "glob_pattern.h"
 
 namespace rediscpp
 {
@@ -274,14 +275,16 @@ namespace rediscpp
 		if (count == 0) {
 			throw std::runtime_error("ERR zset structure corrupted");
 		}
-		client->response_start_multi_bulk(withscores ? count * 2 : count);
+		reply_type reply(client);
+		reply.multi_bulk(withscores ? count * 2 : count);
+		char score[32];
 		if (rev) {
 			auto it = range.second;
 			--it;
 			while (true) {
-				client->response_bulk((*it)->member);
+				reply.bulk((*it)->member);
 				if (withscores) {
-					client->response_bulk(format("%g", (*it)->score));
+					reply.bulk(score, snprintf(score, sizeof(score), "%g", (*it)->score));
 				}
 				if (range.first == it) {
 					break;
@@ -290,9 +293,9 @@ namespace rediscpp
 			}
 		} else {
 			for (auto it = range.first; it != range.second; ++it) {
-				client->response_bulk((*it)->member);
+				reply.bulk((*it)->member);
 				if (withscores) {
-					client->response_bulk(format("%g", (*it)->score));
+					reply.bulk(score, snprintf(score, sizeof(score), "%g", (*it)->score));
 				}
 			}
 		}
@@ -406,14 +409,16 @@ namespace rediscpp
 			client->response_null();
 			return true;
 		}
-		client->response_start_multi_bulk(withscores ? count * 2 : count);
+		reply_type reply(client);
+		reply.multi_bulk(withscores ? count * 2 : count);
+		char score[32];
 		if (rev) {
 			auto it = range.second;
 			--it;
 			while (true) {
-				client->response_bulk((*it)->member);
+				reply.bulk((*it)->member);
 				if (withscores) {
-					client->response_bulk(format("%g", (*it)->score));
+					reply.bulk(score, snprintf(score, sizeof(score), "%g", (*it)->score));
 				}
 				if (range.first == it) {
 					break;
@@ -422,9 +427,9 @@ namespace rediscpp
 			}
 		} else {
 			for (auto it = range.first; it != range.second; ++it) {
-				client->response_bulk((*it)->member);
+				reply.bulk((*it)->member);
 				if (withscores) {
-					client->response_bulk(format("%g", (*it)->score));
+					reply.bulk(score, snprintf(score, sizeof(score), "%g", (*it)->score));
 				}
 			}
 		}
@@ -484,6 +489,38 @@ namespace rediscpp
 		client->response_bulk(format("%g", score));
 		return true;
 	}
+	///要素とスコアを少しずつ列挙する
+	///@note メンバーの順に列挙し、返した最後のメンバーを接続のカーソルに覚えて、その次から続ける
+	///@note Available since 2.8.0.
+	bool server_type::api_zscan(client_type * client)
+	{
+		auto & key = client->get_argument(1);
+		std::string after;
+		bool resume = client->load_scan_cursor(client->get_argument(2), after);
+		std::string pattern("*");
+		size_t count = 10;
+		parse_scan_options(client, 3, pattern, count, NULL);
+		glob_pattern_type matcher(pattern);
+		auto current = client->get_time();
+		auto db = readable_db(client);
+		std::shared_ptr<type_zset> zset = db->get_zset(key, current);
+		if (!zset) {
+			response_scan(client, 0, std::vector<std::string>());
+			return true;
+		}
+		std::vector<std::pair<const std::string*,type_zset::score_type>> members;
+		members.reserve(count);
+		bool more = zset->zscan(resume ? &after : NULL, count, members);
+		std::vector<std::string> items;
+		for (auto it = members.begin(), end = members.end(); it != end; ++it) {
+			if (matcher.match(*it->first)) {
+				items.push_back(*it->first);
+				items.push_back(format("%g", it->second));
+			}
+		}
+		response_scan(client, more && !members.empty() ? client->save_scan_cursor(*members.back().first) : 0, items);
+		return true;
+	}
 	///要素を削除
 	///@note Available since 1.2.0.
 	bool server_type::api_zrem(client_type * client)
@@ -0,0 +1,163 @@
+#include "argument_plan.h"
+
+namespace rediscpp
+{
+	argument_plan_type::argument_plan_type()
+		: repeat(0)
+		, repeat_error("ERR command structure error")
+		, first_key(0)
+		, last_key(0)
+		, key_step(0)
+	{
+	}
+	///arg_typesを前方、繰り返し、後方に分ける
+	///@note 実行時にはarg_typesを読まず、ここで決めた位置だけを使う
+	void argument_plan_type::compile(const std::string & arg_types)
+	{
+		size_t first_star = arg_types.find('*');
+		if (first_star == std::string::npos) {
+			front = arg_types;
+			repeat = 0;
+			back.clear();
+			repeat_error = "ERR command structure error";//繰り返しが無いので、余分な引数は受け付けない
+		} else {
+			size_t last_star = arg_types.rfind('*');
+			front = arg_types.substr(0, first_star);
+			back = arg_types.substr(last_star + 1);
+			repeat = std::count(arg_types.begin() + first_star, arg_types.begin() + last_star + 1, '*');
+			repeat_error = NULL;
+			if (repeat != last_star + 1 - first_star) {
+				repeat_error = "ERR syntax error too few arguments";
+			} else if (front.size() < repeat) {
+				repeat_error = "ERR command structure error";
+			}
+		}
+		//キーの位置
+		first_key = last_key = key_step = 0;
+		std::vector<int> front_keys;
+		for (size_t i = 0; i < front.size(); ++i) {
+			if (front[i] == 'k') {
+				front_keys.push_back(i);
+			}
+		}
+		int repeat_key = -1;
+		if (!repeat_error) {
+			for (size_t s = 0; s < repeat; ++s) {
+				if (front[front.size() - repeat + s] == 'k') {
+					repeat_key = s;
+					break;
+				}
+			}
+		}
+		if (0 <= repeat_key) {
+			first_key = front_keys.front();
+			last_key = - static_cast<int>(back.size() + repeat - repeat_key);
+			key_step = repeat;
+		} else if (!front_keys.empty()) {
+			first_key = front_keys.front();
+			last_key = front_keys.back();
+			key_step = 1 < front_keys.size() ? front_keys[1] - front_keys[0] : 1;
+		} else {
+			size_t back_key = back.find('k');
+			if (back_key != std::string::npos) {
+				first_key = last_key = - static_cast<int>(back.size() - back_key);
+				key_step = 1;
+			}
+		}
+	}
+	void argument_plan_type::classify(char type, std::string & argument, argument_slices_type & slices, size_t db_count)
+	{
+		switch (type) {
+		case 'k'://key
+			slices.keys.push_back(&argument);
+			break;
+		case 'v'://value
+			slices.values.push_back(&argument);
+			break;
+		case 'f'://field
+			slices.fields.push_back(&argument);
+			break;
+		case 'm'://member
+			slices.members.push_back(&argument);
+			break;
+		case 's'://score
+			slices.scores.push_back(&argument);
+			break;
+		case 'd'://db index
+			{
+				int64_t index = atoi64(argument);
+				if (index < 0 || db_count <= static_cast<uint64_t>(index)) {
+					throw std::runtime_error("ERR db index is wrong range");
+				}
+			}
+			break;
+		}
+	}
+	///引数を種類毎に分ける
+	///@note 前方、繰り返し、後方の順に並べる
+	void argument_plan_type::apply(std::vector<std::string> & arguments, argument_slices_type & slices, size_t db_count) const
+	{
+		slices.clear();
+		const size_t argc = arguments.size();
+		const size_t front_size = front.size();
+		for (size_t i = 0, n = std::min(argc, front_size); i < n; ++i) {
+			classify(front[i], arguments[i], slices, db_count);
+		}
+		if (argc <= front_size) {
+			return;
+		}
+		//後方一致
+		const size_t back_count = repeat ? std::min(back.size(), argc) : 0;
+		const size_t repeat_end = argc - back_count;
+		if (front_size < repeat_end) {
+			if (repeat_error) {
+				throw std::runtime_error(repeat_error);
+			}
+			if ((repeat_end - front_size) % repeat != 0) {
+				throw std::runtime_error("ERR syntax error");
+			}
+			for (size_t s = 0; s < repeat; ++s) {
+				const char type = front[front_size - repeat + s];
+				if (!strchr("kvfmsc", type)) {
+					throw std::runtime_error("ERR command pattern error");
+				}
+				for (size_t pos = front_size + s; pos < repeat_end; pos += repeat) {
+					classify(type, arguments[pos], slices, db_count);
+				}
+			}
+		}
+		for (size_t i = 0; i < back_count; ++i) {
+			classify(back[back.size() - back_count + i], arguments[repeat_end + i], slices, db_count);
+		}
+	}
+	///コマンドを実行せずにキーの位置を求める
+	///@return 見つけたキーの数
+	size_t argument_plan_type::get_key_positions(size_t argc, std::vector<size_t> & positions) const
+	{
+		positions.clear();
+		const size_t front_size = front.size();
+		for (size_t i = 0, n = std::min(argc, front_size); i < n; ++i) {
+			if (front[i] == 'k') {
+				positions.push_back(i);
+			}
+		}
+		if (argc <= front_size) {
+			return positions.size();
+		}
+		const size_t back_count = repeat ? std::min(back.size(), argc) : 0;
+		const size_t repeat_end = argc - back_count;
+		if (front_size < repeat_end && !repeat_error && (repeat_end - front_size) % repeat == 0) {
+			for (size_t pos = front_size; pos < repeat_end; ++pos) {
+				if (front[front_size - repeat + (pos - front_size) % repeat] == 'k') {
+					positions.push_back(pos);
+				}
+			}
+		}
+		for (size_t i = 0; i < back_count; ++i) {
+			if (back[back.size() - back_count + i] == 'k') {
+				positions.push_back(repeat_end + i);
+			}
+		}
+		return positions.size();
+	}
+};
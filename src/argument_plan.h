@@ -0,0 +1,49 @@
+#ifndef INCLUDE_REDIS_CPP_ARGUMENT_PLAN_H
+#define INCLUDE_REDIS_CPP_ARGUMENT_PLAN_H
+
+#include "common.h"
+
+namespace rediscpp
+{
+	///種類毎の引数の位置
+	///@note clientが使い回すので、確保した領域はそのまま残る
+	struct argument_slices_type
+	{
+		std::vector<std::string*> keys;
+		std::vector<std::string*> values;
+		std::vector<std::string*> fields;
+		std::vector<std::string*> members;
+		std::vector<std::string*> scores;
+		void clear()
+		{
+			keys.clear();
+			values.clear();
+			fields.clear();
+			members.clear();
+			scores.clear();
+		}
+	};
+	///api_info::arg_typesを起動時に解釈した引数の分類
+	///@note arg_typesは前方の種類、'*'で前方の末尾を繰り返す部分、後方の種類からなる
+	class argument_plan_type
+	{
+		std::string front;///<'*'より前の種類
+		size_t repeat;///<'*'の数、前方の末尾のrepeat個を繰り返す
+		std::string back;///<'*'より後ろの種類
+		const char * repeat_error;///<繰り返し部分に引数がある場合のエラー
+		int first_key;///<最初のキーの位置、キーが無ければ0
+		int last_key;///<最後のキーの位置、負の場合は末尾からの位置
+		int key_step;
+		static void classify(char type, std::string & argument, argument_slices_type & slices, size_t db_count);
+	public:
+		argument_plan_type();
+		void compile(const std::string & arg_types);
+		void apply(std::vector<std::string> & arguments, argument_slices_type & slices, size_t db_count) const;
+		size_t get_key_positions(size_t argc, std::vector<size_t> & positions) const;
+		int get_first_key() const { return first_key; }
+		int get_last_key() const { return last_key; }
+		int get_key_step() const { return key_step; }
+	};
+};
+
+#endif
@@ -0,0 +1,269 @@
+#include "buffer.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define REDIS_CPP_X86_SCANNER 1
+#endif
+
+namespace rediscpp
+{
+	static const uint8_t * find_crlf_generic(const uint8_t * begin, const uint8_t * end)
+	{
+		while (begin + 1 < end) {
+			const uint8_t * cr = reinterpret_cast<const uint8_t *>(memchr(begin, '\r', end - begin - 1));
+			if (!cr) {
+				return NULL;
+			}
+			if (cr[1] == '\n') {
+				return cr;
+			}
+			begin = cr + 1;
+		}
+		return NULL;
+	}
+#ifdef REDIS_CPP_X86_SCANNER
+	///16バイトずつ'\r'と次の位置の'\n'を比較する
+	__attribute__((target("sse2")))
+	static const uint8_t * find_crlf_sse2(const uint8_t * begin, const uint8_t * end)
+	{
+		const __m128i cr = _mm_set1_epi8('\r');
+		const __m128i lf = _mm_set1_epi8('\n');
+		const uint8_t * p = begin;
+		for (; p + 17 <= end; p += 16) {
+			__m128i c0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+			__m128i c1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 1));
+			uint32_t mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(c0, cr), _mm_cmpeq_epi8(c1, lf)));
+			if (mask) {
+				return p + __builtin_ctz(mask);
+			}
+		}
+		return find_crlf_generic(p, end);
+	}
+	///32バイトずつ'\r'と次の位置の'\n'を比較する
+	__attribute__((target("avx2")))
+	static const uint8_t * find_crlf_avx2(const uint8_t * begin, const uint8_t * end)
+	{
+		const __m256i cr = _mm256_set1_epi8('\r');
+		const __m256i lf = _mm256_set1_epi8('\n');
+		const uint8_t * p = begin;
+		for (; p + 33 <= end; p += 32) {
+			__m256i c0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+			__m256i c1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + 1));
+			uint32_t mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(c0, cr), _mm256_cmpeq_epi8(c1, lf)));
+			if (mask) {
+				return p + __builtin_ctz(mask);
+			}
+		}
+		return find_crlf_sse2(p, end);
+	}
+#endif
+	typedef const uint8_t * (*find_crlf_function_type)(const uint8_t * begin, const uint8_t * end);
+	static find_crlf_function_type select_scanner(const char * & name)
+	{
+#ifdef REDIS_CPP_X86_SCANNER
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2")) {
+			name = "avx2";
+			return find_crlf_avx2;
+		}
+		if (__builtin_cpu_supports("sse2")) {
+			name = "sse2";
+			return find_crlf_sse2;
+		}
+#endif
+		name = "generic";
+		return find_crlf_generic;
+	}
+	static const char * scanner_name = "generic";
+	static const find_crlf_function_type scanner = select_scanner(scanner_name);
+	const uint8_t * find_crlf(const uint8_t * begin, const uint8_t * end)
+	{
+		return scanner(begin, end);
+	}
+	const char * get_scanner_name()
+	{
+		return scanner_name;
+	}
+	const size_t recv_buffer_type::default_capacity;
+	const size_t recv_buffer_type::max_idle_capacity;
+	recv_buffer_type::recv_buffer_type()
+		: read_offset(0)
+		, write_offset(0)
+	{
+	}
+	///少なくともlenバイトの書き込み領域を確保する
+	uint8_t * recv_buffer_type::prepare(size_t len)
+	{
+		if (len <= writable()) {
+			return &buffer[0] + write_offset;
+		}
+		const size_t used = size();
+		if (read_offset && len <= buffer.size() - used) {
+			memmove(&buffer[0], &buffer[0] + read_offset, used);
+		} else {
+			size_t new_capacity = std::max(default_capacity, buffer.size());
+			while (new_capacity < used + len) {
+				new_capacity *= 2;
+			}
+			std::vector<uint8_t> new_buffer(new_capacity);
+			if (used) {
+				memcpy(&new_buffer[0], &buffer[0] + read_offset, used);
+			}
+			buffer.swap(new_buffer);
+		}
+		read_offset = 0;
+		write_offset = used;
+		return &buffer[0] + write_offset;
+	}
+	void recv_buffer_type::consume(size_t len)
+	{
+		read_offset += std::min(len, size());
+		if (read_offset == write_offset) {
+			read_offset = write_offset = 0;
+			if (max_idle_capacity < buffer.size()) {
+				std::vector<uint8_t>().swap(buffer);
+			}
+		}
+	}
+	void recv_buffer_type::append(const void * data, size_t len)
+	{
+		if (len) {
+			memcpy(prepare(len), data, len);
+			commit(len);
+		}
+	}
+	void recv_buffer_type::clear()
+	{
+		consume(size());
+	}
+	static std::atomic<uint64_t> chunk_allocated_count(0);
+	static std::atomic<uint64_t> chunk_reused_count(0);
+	///スレッド毎の空きチャンク
+	struct send_chunk_pool_type
+	{
+		std::vector<send_chunk_type*> chunks;
+		~send_chunk_pool_type()
+		{
+			for (auto it = chunks.begin(), end = chunks.end(); it != end; ++it) {
+				delete *it;
+			}
+		}
+	};
+	static thread_local send_chunk_pool_type send_chunk_pool;
+	send_chunk_type * send_buffer_type::allocate_chunk()
+	{
+		send_chunk_type * chunk = NULL;
+		auto & pool = send_chunk_pool.chunks;
+		if (pool.empty()) {
+			chunk = new send_chunk_type;
+			++chunk_allocated_count;
+		} else {
+			chunk = pool.back();
+			pool.pop_back();
+			++chunk_reused_count;
+		}
+		chunk->begin = chunk->end = 0;
+		return chunk;
+	}
+	///解放したスレッドのプールに戻す
+	void send_buffer_type::release_chunk(send_chunk_type * chunk)
+	{
+		auto & pool = send_chunk_pool.chunks;
+		if (pool.size() < max_pooled_chunks) {
+			pool.push_back(chunk);
+		} else {
+			delete chunk;
+		}
+	}
+	uint64_t send_buffer_type::get_allocated_count()
+	{
+		return chunk_allocated_count;
+	}
+	uint64_t send_buffer_type::get_reused_count()
+	{
+		return chunk_reused_count;
+	}
+	send_buffer_type::send_buffer_type()
+		: total(0)
+	{
+	}
+	send_buffer_type::~send_buffer_type()
+	{
+		clear();
+	}
+	void send_buffer_type::append(const void * data, size_t len)
+	{
+		const uint8_t * src = reinterpret_cast<const uint8_t *>(data);
+		total += len;
+		while (len) {
+			if (segments.empty() || !segments.back().chunk || !segments.back().chunk->writable()) {
+				segments.push_back(send_segment_type(allocate_chunk()));
+			}
+			send_chunk_type & chunk = *segments.back().chunk;
+			size_t n = std::min(len, chunk.writable());
+			memcpy(chunk.data + chunk.end, src, n);
+			chunk.end += n;
+			src += n;
+			len -= n;
+		}
+	}
+	///末尾のチャンクに少なくともlenバイトの連続した書き込み領域を確保する
+	///@note lenはチャンクの容量以下であること、書き込んだ分はcommitする
+	uint8_t * send_buffer_type::prepare(size_t len)
+	{
+		if (segments.empty() || !segments.back().chunk || segments.back().chunk->writable() < len) {
+			segments.push_back(send_segment_type(allocate_chunk()));
+		}
+		send_chunk_type & chunk = *segments.back().chunk;
+		return chunk.data + chunk.end;
+	}
+	///値をコピーせずに追加する
+	void send_buffer_type::append(const std::shared_ptr<const std::string> & shared)
+	{
+		if (shared && !shared->empty()) {
+			total += shared->size();
+			segments.push_back(send_segment_type(shared));
+		}
+	}
+	///先頭から最大count個の送信領域を設定する
+	///@param[out] len 設定した合計バイト数
+	///@return 設定した数
+	size_t send_buffer_type::get_iovec(iovec * vectors, size_t count, size_t & len) const
+	{
+		size_t n = 0;
+		len = 0;
+		for (auto it = segments.begin(), end = segments.end(); it != end && n < count; ++it, ++n) {
+			vectors[n].iov_base = const_cast<uint8_t *>(it->data());
+			vectors[n].iov_len = it->size();
+			len += it->size();
+		}
+		return n;
+	}
+	///送信済みのlenバイトを取り除く
+	void send_buffer_type::consume(size_t len)
+	{
+		len = std::min(len, total);
+		total -= len;
+		while (len && !segments.empty()) {
+			send_segment_type & segment = segments.front();
+			size_t n = std::min(len, segment.size());
+			segment.consume(n);
+			len -= n;
+			if (!segment.size()) {
+				if (segment.chunk) {
+					release_chunk(segment.chunk);
+				}
+				segments.pop_front();
+			}
+		}
+	}
+	void send_buffer_type::clear()
+	{
+		for (auto it = segments.begin(), end = segments.end(); it != end; ++it) {
+			if (it->chunk) {
+				release_chunk(it->chunk);
+			}
+		}
+		segments.clear();
+		total = 0;
+	}
+};
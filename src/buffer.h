@@ -0,0 +1,100 @@
+#ifndef INCLUDE_REDIS_CPP_BUFFER_H
+#define INCLUDE_REDIS_CPP_BUFFER_H
+
+#include "common.h"
+#include <sys/uio.h>
+
+namespace rediscpp
+{
+	///"\r\n"の位置を探す、見つからなければNULL
+	///@note 実行時にAVX2, SSE2, 汎用の実装から選択する
+	const uint8_t * find_crlf(const uint8_t * begin, const uint8_t * end);
+	///選択されているスキャナの名前
+	const char * get_scanner_name();
+
+	///受信用の連続領域バッファ
+	///@note 読み込み済みの領域は先頭をずらすだけで、足りなくなった時に詰めるか拡張する
+	class recv_buffer_type
+	{
+		std::vector<uint8_t> buffer;
+		size_t read_offset;
+		size_t write_offset;
+		recv_buffer_type(const recv_buffer_type &);
+	public:
+		static const size_t default_capacity = 16 * 1024;
+		static const size_t max_idle_capacity = 1024 * 1024;
+		recv_buffer_type();
+		bool empty() const { return read_offset == write_offset; }
+		size_t size() const { return write_offset - read_offset; }
+		size_t capacity() const { return buffer.size(); }
+		const uint8_t * begin() const { return buffer.data() + read_offset; }
+		const uint8_t * end() const { return buffer.data() + write_offset; }
+		uint8_t * prepare(size_t len);
+		size_t writable() const { return buffer.size() - write_offset; }
+		void commit(size_t len) { write_offset += len; }
+		void consume(size_t len);
+		void append(const void * data, size_t len);
+		void clear();
+		///読み込み位置からoffsetバイト以降の"\r\n"の位置
+		const uint8_t * find_crlf(size_t offset = 0) const
+		{
+			if (size() <= offset) {
+				return NULL;
+			}
+			return rediscpp::find_crlf(begin() + offset, end());
+		}
+	};
+
+	///送信用の固定長チャンク
+	struct send_chunk_type
+	{
+		static const size_t capacity = 16 * 1024;
+		size_t begin;///<送信済みの位置
+		size_t end;///<書き込み済みの位置
+		uint8_t data[capacity];
+		size_t size() const { return end - begin; }
+		size_t writable() const { return capacity - end; }
+	};
+	///送信待ちの領域、コピーしたチャンクか参照している値のどちらか
+	struct send_segment_type
+	{
+		send_chunk_type * chunk;
+		std::shared_ptr<const std::string> shared;///<送信が終わるまで値を保持する
+		size_t offset;///<sharedの送信済みの位置
+		send_segment_type(send_chunk_type * chunk_) : chunk(chunk_), offset(0) {}
+		send_segment_type(const std::shared_ptr<const std::string> & shared_) : chunk(NULL), shared(shared_), offset(0) {}
+		const uint8_t * data() const { return chunk ? chunk->data + chunk->begin : reinterpret_cast<const uint8_t *>(shared->data()) + offset; }
+		size_t size() const { return chunk ? chunk->size() : shared->size() - offset; }
+		void consume(size_t len) { if (chunk) { chunk->begin += len; } else { offset += len; } }
+	};
+	///送信待ちのデータを持つ領域の列
+	///@note 小さな応答は末尾のチャンクに詰め、チャンクはスレッド毎のプールで使い回す
+	///@note 大きな値はコピーせずに参照を持つ
+	class send_buffer_type
+	{
+		std::deque<send_segment_type> segments;
+		size_t total;
+		send_buffer_type(const send_buffer_type &);
+	public:
+		static const size_t max_pooled_chunks = 64;///<スレッド毎に保持する空きチャンク数
+		send_buffer_type();
+		~send_buffer_type();
+		bool empty() const { return segments.empty(); }
+		size_t size() const { return total; }
+		size_t get_segment_count() const { return segments.size(); }
+		void append(const void * data, size_t len);
+		void append(const std::shared_ptr<const std::string> & shared);
+		uint8_t * prepare(size_t len);
+		void commit(size_t len) { segments.back().chunk->end += len; total += len; }
+		size_t get_iovec(iovec * vectors, size_t count, size_t & len) const;
+		void consume(size_t len);
+		void clear();
+		void swap(send_buffer_type & rhs) { segments.swap(rhs.segments); std::swap(total, rhs.total); }
+		static send_chunk_type * allocate_chunk();
+		static void release_chunk(send_chunk_type * chunk);
+		static uint64_t get_allocated_count();
+		static uint64_t get_reused_count();
+	};
+};
+
+#endif
@@ -9,12 +9,20 @@
 
 namespace rediscpp
 {
+	const int64_t client_type::max_multi_bulk_count;
+	const size_t client_type::max_reserved_arguments;
+	const size_t client_type::max_reserved_bulk;
 	client_type::client_type(server_type & server_, std::shared_ptr<socket_type> & client_, const std::string & password_)
 		: server(server_)
 		, client(client_)
 		, argument_count(0)
 		, argument_index(0)
 		, argument_size(argument_is_undefined)
+		, batch_database(NULL)
+		, batch_shards(0)
+		, batch_writing(false)
+		, out_of_memory(false)
+		, executing_api(NULL)
 		, password(password_)
 		, db_index(0)
 		, transaction(false)
@@ -25,12 +33,12 @@ namespace rediscpp
 		, events(0)
 		, blocked(false)
 		, blocked_till(0, 0)
+		, reactor(NULL)
 		, listening_port(0)
 		, slave(false)
 		, monitor(false)
 		, wrote(false)
 	{
-		write_cache.reserve(1500);
 	}
 	void client_type::process()
 	{
@@ -84,12 +92,36 @@ namespace rediscpp
 			}
 		}
 	}
+	///受信済みのコマンドをすべて解析してから実行する
+	///@note 連続するコマンドはget_batch_sizeでまとめ、DBのロックを一度だけ取る
 	bool client_type::parse()
 	{
-		bool time_updated = false;
+		bool result = true;
 		try {
-			while (true) {
+			execute_pending();//ブロックしていたコマンドから再開する
+			while (result) {
 				if (argument_count == 0) {
+					auto & buf = client->get_recv();
+					if (buf.empty()) {
+						break;
+					}
+					if (*buf.begin() == '*') {
+						int64_t count = 0;
+						bool is_valid = false;
+						if (!parse_header(count, is_valid)) {
+							break;
+						}
+						if (!is_valid || count <= 0 || max_multi_bulk_count < count) {
+							lprintf(__FILE__, __LINE__, info_level, "unsupported protocol multi bulk count %" PRId64, count);
+							result = false;
+							break;
+						}
+						argument_count = count;
+						argument_index = 0;
+						arguments.clear();
+						arguments.reserve(std::min<size_t>(argument_count, max_reserved_arguments));
+						continue;
+					}
 					std::string arg_count;
 					if (!parse_line(arg_count)) {
 						break;
@@ -98,154 +130,293 @@ namespace rediscpp
 						continue;
 					}
 					char type = *arg_count.begin();
-					if (type == '*') {
-						argument_count = atoi(arg_count.c_str() + 1);
-						argument_index = 0;
-						if (argument_count <= 0) {
-							lprintf(__FILE__, __LINE__, info_level, "unsupported protocol %s", arg_count.c_str());
-							flush();
-							return false;
-						}
-						arguments.clear();
-						arguments.resize(argument_count);
-					} else if (type == '+' || type == '-') {//response from slave
+					if (type == '+' || type == '-') {//response from slave
 						continue;
 					} else {
 						inline_command_parser(arg_count);
-						argument_index = argument_count = arg_count.size();
-						if (!time_updated) {
-							time_updated = true;
-							current_time.update();
-						}
-						if (!execute()) {
-							response_error("ERR unknown");
-						}
-						arguments.clear();
-						argument_count = 0;
-						argument_index = 0;
-						argument_size = argument_is_undefined;
+						push_pending();
 					}
 				} else if (argument_index < argument_count) {
 					if (argument_size == argument_is_undefined) {
-						std::string arg_size;
-						if (!parse_line(arg_size)) {
+						auto & buf = client->get_recv();
+						if (buf.empty()) {
 							break;
 						}
-						if (!arg_size.empty() && *arg_size.begin() == '$') {
-							argument_size = atoi(arg_size.c_str() + 1);
-							if (argument_size < -1) {
-								lprintf(__FILE__, __LINE__, info_level, "unsupported protocol %s", arg_size.c_str());
-								flush();
-								return false;
-							}
-							if (argument_size < 0) {
-								argument_size = argument_is_undefined;
-								++argument_index;
-							}
-						} else {
-							lprintf(__FILE__, __LINE__, info_level, "unsupported protocol %s", arg_size.c_str());
-							flush();
-							return false;
+						if (*buf.begin() != '$') {
+							lprintf(__FILE__, __LINE__, info_level, "unsupported protocol %c", *buf.begin());
+							result = false;
+							break;
+						}
+						int64_t size = 0;
+						bool is_valid = false;
+						if (!parse_header(size, is_valid)) {
+							break;
+						}
+						if (!is_valid || size < -1) {
+							lprintf(__FILE__, __LINE__, info_level, "unsupported protocol bulk size %" PRId64, size);
+							result = false;
+							break;
+						}
+						if (static_cast<int64_t>(server.get_proto_max_bulk_len()) < size) {
+							lprintf(__FILE__, __LINE__, info_level, "too large bulk size %" PRId64, size);
+							response_error("ERR Protocol error: invalid bulk length");
+							result = false;
+							break;
+						}
+						argument_size = size;
+						arguments.resize(argument_index + 1);
+						if (argument_size < 0) {
+							argument_size = argument_is_undefined;
+							++argument_index;
 						}
 					} else {
-						std::string arg_data;
-						if (!parse_data(arg_data, argument_size)) {
+						if (!parse_data(arguments[argument_index], argument_size)) {
 							break;
 						}
-						auto & arg = arguments[argument_index];
-						arg = arg_data;
 						argument_size = argument_is_undefined;
 						++argument_index;
 					}
 				} else {
-					if (!time_updated) {
-						time_updated = true;
-						current_time.update();
-					}
-					if (!execute()) {
-						response_error("ERR unknown");
-					}
-					arguments.clear();
-					argument_count = 0;
-					argument_index = 0;
-					argument_size = argument_is_undefined;
+					push_pending();
 				}
 			}
+			execute_pending();
 		} catch (blocked_exception e) {
 		}
 		flush();
+		return result;
+	}
+	///解析したコマンドを実行待ちに移す
+	void client_type::push_pending()
+	{
+		pending.push_back(arguments_type());
+		pending.back().swap(arguments);
+		arguments.clear();
+		argument_count = 0;
+		argument_index = 0;
+		argument_size = argument_is_undefined;
+		if (max_pending_commands <= pending.size()) {
+			execute_pending();
+		}
+	}
+	///実行中はargumentsを実行するコマンドに使うので、解析途中のコマンドを退避する
+	struct parsing_arguments_saver
+	{
+		arguments_type & arguments;
+		arguments_type saved;
+		parsing_arguments_saver(arguments_type & arguments_) : arguments(arguments_) { saved.swap(arguments); }
+		~parsing_arguments_saver() { arguments.swap(saved); }
+	};
+	///実行待ちのコマンドを受信順に実行する
+	///@note 解析途中のコマンドは実行後に戻し、次のparseで続きを解析する
+	void client_type::execute_pending()
+	{
+		if (pending.empty()) {
+			return;
+		}
+		parsing_arguments_saver saver(arguments);
+		current_time.update();
+		while (!pending.empty()) {
+			if (is_writing_front()) {
+				out_of_memory = !server.evict();//ロックを取る前に追い出す
+			}
+			size_t count = get_batch_size();
+			if (count < 2) {
+				execute_front();
+				continue;
+			}
+			std::shared_ptr<database_write_locker> locker;
+			try {
+				locker.reset(new database_write_locker(server.writable_db(db_index, this, batch_shards, !batch_writing)));
+			} catch (std::exception & e) {//slaveでの書き込みなど、個別に実行してエラーを返す
+				execute_front();
+				continue;
+			}
+			batch_database = locker->get();
+			++server.batch_count;
+			server.batched_command_count += count;
+			try {
+				for (size_t i = 0; i < count; ++i) {
+					execute_front();
+				}
+			} catch (...) {
+				batch_database = NULL;
+				throw;
+			}
+			batch_database = NULL;
+		}
+	}
+	///先頭のコマンドを実行する
+	///@note ブロックした場合は実行待ちに残し、次のparseで再実行する
+	void client_type::execute_front()
+	{
+		arguments.swap(pending.front());
+		try {
+			if (!execute()) {
+				response_error("ERR unknown");
+			}
+		} catch (blocked_exception & e) {
+			arguments.swap(pending.front());
+			arguments.clear();
+			throw;
+		}
+		arguments.clear();
+		pending.pop_front();
+	}
+	///先頭のコマンドが書き込みか
+	///@note まとめて実行するグループは、先頭と同じく全て書き込みか全て読み込み
+	bool client_type::is_writing_front() const
+	{
+		if (pending.front().empty()) {
+			return false;
+		}
+		const api_info * info = server.api_map.find(pending.front().front());
+		return info && info->writing;
+	}
+	///先頭から同じロックでまとめて実行できるコマンド数
+	///@note トランザクション中やブロックするコマンド、他のDBを使うコマンドはまとめない
+	///@note まとめたコマンドのキーのshardをbatch_shardsに求める
+	size_t client_type::get_batch_size()
+	{
+		if (transaction || is_monitor() || is_blocked()) {
+			return 0;
+		}
+		const database_type & database = *server.databases.at(db_index);
+		const shard_mask_type all_shards = database.get_all_shards();
+		batch_shards = 0;
+		size_t count = 0;
+		for (auto it = pending.begin(), end = pending.end(); it != end; ++it, ++count) {
+			if (it->empty()) {
+				break;
+			}
+			const api_info * info = server.api_map.find(it->front());
+			if (!info || !info->batching || require_auth(info->name)) {
+				break;
+			}
+			if (count == 0) {
+				batch_writing = info->writing;
+			} else if (batch_writing != info->writing) {
+				break;
+			}
+			if (batch_shards == all_shards) {
+				continue;
+			}
+			if (info->dynamic_keys || !info->plan.get_key_positions(it->size(), key_positions)) {
+				batch_shards = all_shards;
+				continue;
+			}
+			for (auto pit = key_positions.begin(), pend = key_positions.end(); pit != pend; ++pit) {
+				batch_shards |= database.get_shard_mask((*it)[*pit]);
+			}
+		}
+		return count;
+	}
+	///パイプラインのグループでdatabaseのロックを保持しているか
+	bool client_type::in_batch(database_type * database, shard_mask_type shards, bool writing) const
+	{
+		if (!batch_database || batch_database != database) {
+			return false;
+		}
+		if ((writing && !batch_writing) || (shards & ~batch_shards)) {
+			throw std::runtime_error("ERR batch lock mismatch");
+		}
 		return true;
 	}
+	///実行中のコマンドがロックするshard
+	///@note キーを持たないコマンドや、引数以外のキーを使うコマンドはすべてのshardを使う
+	shard_mask_type client_type::get_shard_mask(const database_type & database) const
+	{
+		if (!executing_api || executing_api->dynamic_keys || slices.keys.empty()) {
+			return database.get_all_shards();
+		}
+		shard_mask_type shards = 0;
+		for (auto it = slices.keys.begin(), end = slices.keys.end(); it != end; ++it) {
+			shards |= database.get_shard_mask(**it);
+		}
+		return shards;
+	}
 	void client_type::response_status(const std::string & state)
 	{
-		response_raw("+" + state + "\r\n");
+		reply_type reply(this);
+		reply.raw("+", 1);
+		reply.raw(state);
+		reply.raw("\r\n", 2);
 	}
 	void client_type::response_error(const std::string & state)
 	{
-		response_raw("-" + state + "\r\n");
+		reply_type reply(this);
+		reply.raw("-", 1);
+		reply.raw(state);
+		reply.raw("\r\n", 2);
 	}
 	void client_type::response_ok()
 	{
-		response_raw("+OK\r\n");
+		reply_type(this).raw("+OK\r\n", 5);
 	}
 	void client_type::response_pong()
 	{
-		response_raw("+PONG\r\n");
+		reply_type(this).raw("+PONG\r\n", 7);
 	}
 	void client_type::response_queued()
 	{
-		response_raw("+QUEUED\r\n");
+		reply_type(this).raw("+QUEUED\r\n", 9);
 	}
 	void client_type::response_integer0()
 	{
-		response_raw(":0\r\n");
+		reply_type(this).integer(0);
 	}
 	void client_type::response_integer1()
 	{
-		response_raw(":1\r\n");
+		reply_type(this).integer(1);
 	}
 	void client_type::response_integer(int64_t value)
 	{
-		response_raw(format(":%"PRId64"\r\n", value));
+		reply_type(this).integer(value);
 	}
 	void client_type::response_bulk(const std::string & bulk, bool not_null)
 	{
 		if (not_null) {
-			response_raw(format("$%zd\r\n", bulk.size()));
-			response_raw(bulk);
-			response_raw("\r\n");
+			reply_type(this).bulk(bulk);
 		} else {
 			response_null();
 		}
 	}
+	///保存されている値を参照したまま応答する
+	///@note 小さな値や、ファイル送信中はコピーする
+	void client_type::response_bulk(const std::shared_ptr<const std::string> & bulk)
+	{
+		reply_type(this).bulk(bulk);
+	}
 	void client_type::response_null()
 	{
-		response_raw("$-1\r\n");
+		reply_type(this).null();
 	}
 	void client_type::response_null_multi_bulk()
 	{
-		response_raw("*-1\r\n");
+		reply_type(this).null_multi_bulk();
 	}
 	void client_type::response_start_multi_bulk(size_t count)
 	{
-		response_raw(format("*%zd\r\n", count));
+		reply_type(this).multi_bulk(count);
 	}
 	void client_type::response_raw(const std::string & raw)
 	{
-		mutex_locker locker(write_mutex);
+		reply_type(this).raw(raw);
+	}
+	///送信バッファへの書き込み先、ファイル送信中は書き込みキャッシュに溜める
+	///@note write_mutexを保持して呼ぶ
+	reply_encoder_type client_type::get_reply_encoder()
+	{
 		if (client->is_sendfile()) {
-			write_cache.insert(write_cache.end(), raw.begin(), raw.end());
-			return;
-		}
-		if (raw.size() <= write_cache.capacity() - write_cache.size()) {
-			write_cache.insert(write_cache.end(), raw.begin(), raw.end());
-		} else if (raw.size() <= write_cache.capacity()) {
-			flush();
-			write_cache.insert(write_cache.end(), raw.begin(), raw.end());
-		} else {
-			flush();
-			client->send(raw.c_str(), raw.size());
+			return reply_encoder_type(write_cache);
 		}
+		flush_cache();
+		return reply_encoder_type(client->get_send_buffer());
+	}
+	reply_type::reply_type(client_type * client)
+		: mutex_locker(client->write_mutex)
+		, reply_encoder_type(client->get_reply_encoder())
+	{
 	}
 	void client_type::request(const arguments_type & args)
 	{
@@ -259,7 +430,8 @@ namespace rediscpp
 			response_null_multi_bulk();
 		}
 	}
-	void client_type::flush()
+	///書き込みキャッシュを送信バッファに移す
+	void client_type::flush_cache()
 	{
 		if (!client->is_sendfile()) {
 			mutex_locker locker(write_mutex);
@@ -268,38 +440,69 @@ namespace rediscpp
 				write_cache.clear();
 			}
 		}
+	}
+	void client_type::flush()
+	{
+		flush_cache();
 		client->send();
 	}
 	bool client_type::parse_line(std::string & line)
 	{
 		auto & buf = client->get_recv();
-		if (buf.size() < 2) {
+		const uint8_t * crlf = buf.find_crlf();
+		if (!crlf) {
 			return false;
 		}
-		auto begin = buf.begin();
-		auto end = buf.end();
-		--end;
-		auto it = std::find(begin, end, '\r');
-		if (it != end) {
-			line.assign(begin, it);
-			std::advance(it, 2);
-			buf.erase(begin, it);
-			return true;
+		line.assign(reinterpret_cast<const char *>(buf.begin()), reinterpret_cast<const char *>(crlf));
+		buf.consume(crlf + 2 - buf.begin());
+		return true;
+	}
+	///"*"や"$"で始まる行の数値を読み取る
+	///@retval false 行が揃っていない
+	///@note 数値として不正な場合はis_validがfalseになる
+	bool client_type::parse_header(int64_t & value, bool & is_valid)
+	{
+		auto & buf = client->get_recv();
+		const uint8_t * crlf = buf.find_crlf();
+		if (!crlf) {
+			return false;
 		}
-		return false;
+		const uint8_t * it = buf.begin() + 1;
+		bool minus = false;
+		if (it < crlf && *it == '-') {
+			minus = true;
+			++it;
+		}
+		value = 0;
+		is_valid = (it < crlf && crlf - it <= 18);
+		for (; is_valid && it < crlf; ++it) {
+			uint8_t digit = *it - '0';
+			if (9 < digit) {
+				is_valid = false;
+				break;
+			}
+			value = value * 10 + digit;
+		}
+		if (minus) {
+			value = - value;
+		}
+		buf.consume(crlf + 2 - buf.begin());
+		return true;
 	}
 	bool client_type::parse_data(std::string & data, int size)
 	{
 		auto & buf = client->get_recv();
-		if (buf.size() < size + 2) {
+		const size_t total = static_cast<size_t>(size) + 2;
+		if (buf.size() < total) {
+			//大きな値は一度に受信できるように領域を確保しておく、宣言だけの長さで大きく確保しないように上限までにする
+			const size_t reserved = std::min(total, max_reserved_bulk);
+			if (buf.size() < reserved) {
+				buf.prepare(reserved - buf.size());
+			}
 			return false;
 		}
-		auto begin = buf.begin();
-		auto end = begin;
-		std::advance(end, size);
-		data.assign(begin, end);
-		std::advance(end, 2);
-		buf.erase(begin, end);
+		data.assign(reinterpret_cast<const char *>(buf.begin()), size);
+		buf.consume(total);
 		return true;
 	}
 	bool client_type::execute()
@@ -314,17 +517,26 @@ namespace rediscpp
 			}
 			auto & command = arguments.front();
 			//lprintf(__FILE__, __LINE__, debug_level, "command %s", command.c_str());
-			std::transform(command.begin(), command.end(), command.begin(), toupper);
-			if (require_auth(command)) {
+			const api_info * info = server.api_map.find(command);
+			if (require_auth(info ? info->name : command)) {
 				throw std::runtime_error("NOAUTH Authentication required.");
 			}
-			auto it = server.api_map.find(command);
-			if (it != server.api_map.end()) {
-				if (queuing(command, it->second)) {
+			if (info) {
+				++server.command_count;
+				//追い出す場合は、グループの途中で超えても次のグループの前に追い出すので断らない
+				if (info->writing && !info->shrinking && !is_master() && (server.maxmemory_policy == noeviction_policy ? server.is_over_maxmemory() : out_of_memory)) {
+					++server.oom_rejected_count;
+					throw std::runtime_error("OOM command not allowed when used memory > 'maxmemory'.");
+				}
+				if (queuing(info->name, *info)) {
 					response_queued();
 					return true;
 				}
-				return execute(it->second);
+				bool result = execute(*info);
+				if (info->writing) {
+					server.notify_written();
+				}
+				return result;
 			}
 			//lprintf(__FILE__, __LINE__, info_level, "not supported command %s", command.c_str());
 		} catch (blocked_exception & e) {
@@ -349,153 +561,11 @@ namespace rediscpp
 			response_error("ERR syntax error too much arguments");
 			return true;
 		}
+		const api_info * parent_api = executing_api;//EXECから実行する場合は戻す
 		try
 		{
-			size_t argc = arguments.size();
-			size_t pattern_length = info.arg_types.size();
-			size_t arg_pos = 0;
-			keys.clear();
-			values.clear();
-			members.clear();
-			fields.clear();
-			scores.clear();
-			keys.reserve(argc);
-			values.reserve(argc);
-			members.reserve(argc);
-			fields.reserve(argc);
-			scores.reserve(argc);
-			for (; arg_pos < pattern_length && arg_pos < argc; ++arg_pos) {
-				if (info.arg_types[arg_pos] == '*') {
-					break;
-				}
-				switch (info.arg_types[arg_pos]) {
-				case 'c'://command
-				case 't'://time
-				case 'n'://numeric
-				case 'p'://pattern
-					break;
-				case 'k'://key
-					keys.push_back(&arguments[arg_pos]);
-					break;
-				case 'v'://value
-					values.push_back(&arguments[arg_pos]);
-					break;
-				case 'f'://field
-					fields.push_back(&arguments[arg_pos]);
-					break;
-				case 'm'://member
-					members.push_back(&arguments[arg_pos]);
-					break;
-				case 's'://scre
-					scores.push_back(&arguments[arg_pos]);
-					break;
-				case 'd'://db index
-					{
-						int64_t index = atoi64(arguments[arg_pos]);
-						if (index < 0 || server.databases.size() <= index) {
-							throw std::runtime_error("ERR db index is wrong range");
-						}
-					}
-					break;
-				}
-			}
-			//後方一致
-			std::list<std::string*> back_keys;
-			std::list<std::string*> back_values;
-			std::list<std::string*> back_fields;
-			std::list<std::string*> back_members;
-			std::list<std::string*> back_scores;
-			if (arg_pos < argc && arg_pos < pattern_length && info.arg_types[arg_pos] == '*') {
-				for (; 0 < argc && arg_pos < pattern_length; --argc, --pattern_length) {
-					if (info.arg_types[pattern_length-1] == '*') {
-						break;
-					}
-					switch (info.arg_types[pattern_length-1]) {
-					case 'c'://command
-					case 't'://time
-					case 'n'://numeric
-					case 'p'://pattern
-						break;
-					case 'k'://key
-						back_keys.push_front(&arguments[argc-1]);
-						break;
-					case 'v'://value
-						back_values.push_front(&arguments[argc-1]);
-						break;
-					case 'f'://field
-						back_fields.push_back(&arguments[argc-1]);
-						break;
-					case 'm'://member
-						back_members.push_back(&arguments[argc-1]);
-						break;
-					case 's'://scre
-						back_scores.push_back(&arguments[argc-1]);
-						break;
-					case 'd'://db index
-						{
-							int64_t index = atoi64(arguments[argc-1]);
-							if (index < 0 || server.databases.size() <= index) {
-								throw std::runtime_error("ERR db index is wrong range");
-							}
-						}
-						break;
-					}
-				}
-			}
-			if (arg_pos < argc) {
-				size_t star_count = 0;
-				for (size_t i = arg_pos; i < pattern_length; ++i) {
-					if (info.arg_types[i] == '*') {
-						++star_count;
-					} else {
-						throw std::runtime_error("ERR syntax error too few arguments");
-					}
-				}
-				if (!star_count || arg_pos < star_count) {
-					throw std::runtime_error("ERR command structure error");
-				}
-				if ((argc - arg_pos) % star_count != 0) {
-					throw std::runtime_error("ERR syntax error");
-				}
-				for (size_t s = 0; s < star_count; ++s) {
-					switch (info.arg_types[arg_pos+s-star_count]) {
-					case 'k':
-						for (size_t pos = arg_pos + s; pos < argc; pos += star_count) {
-							keys.push_back(&arguments[pos]);
-						}
-						break;
-					case 'v':
-						for (size_t pos = arg_pos + s; pos < argc; pos += star_count) {
-							values.push_back(&arguments[pos]);
-						}
-						break;
-					case 'f':
-						for (size_t pos = arg_pos + s; pos < argc; pos += star_count) {
-							fields.push_back(&arguments[pos]);
-						}
-						break;
-					case 'm':
-						for (size_t pos = arg_pos + s; pos < argc; pos += star_count) {
-							members.push_back(&arguments[pos]);
-						}
-						break;
-					case 's':
-						for (size_t pos = arg_pos + s; pos < argc; pos += star_count) {
-							scores.push_back(&arguments[pos]);
-						}
-						break;
-					case 'c':
-						break;
-					default:
-						throw std::runtime_error("ERR command pattern error");
-					}
-				}
-			}
-			if (!back_keys.empty()) keys.insert(keys.end(), back_keys.begin(), back_keys.end());
-			if (!back_values.empty()) values.insert(values.end(), back_values.begin(), back_values.end());
-			if (!back_fields.empty()) fields.insert(fields.end(), back_fields.begin(), back_fields.end());
-			if (!back_members.empty()) members.insert(members.end(), back_members.begin(), back_members.end());
-			if (!back_scores.empty()) scores.insert(scores.end(), back_scores.begin(), back_scores.end());
+			info.plan.apply(arguments, slices, server.databases.size());
+			executing_api = &info;
 			wrote = info.writing;
 			bool result = (server.*(info.function))(this);
 			if (server.monitoring) {
@@ -511,18 +581,12 @@ namespace rediscpp
 					server.propagete(arguments);
 				}
 			}
-			keys.clear();
-			values.clear();
-			fields.clear();
-			members.clear();
-			scores.clear();
+			slices.clear();
+			executing_api = parent_api;
 			return result;
 		} catch (...) {
-			keys.clear();
-			values.clear();
-			fields.clear();
-			members.clear();
-			scores.clear();
+			slices.clear();
+			executing_api = parent_api;
 			throw;
 		}
 	}
@@ -4,6 +4,9 @@
 #include "network.h"
 #include "thread.h"
 #include "type_interface.h"
+#include "reply.h"
+#include "argument_plan.h"
+#include "database.h"
 
 namespace rediscpp
 {
@@ -11,21 +14,27 @@ namespace rediscpp
 	class server_type;
 	struct api_info;
 	class file_type;
+	class reactor_type;
 	class client_type
 	{
 		friend class server_type;
+		friend class reactor_type;
+		friend class reply_type;
 	protected:
 		server_type & server;
 		std::shared_ptr<socket_type> client;
 		arguments_type arguments;
-		std::vector<std::string*> keys;
-		std::vector<std::string*> values;
-		std::vector<std::string*> fields;
-		std::vector<std::string*> members;
-		std::vector<std::string*> scores;
+		argument_slices_type slices;
 		int argument_count;
 		int argument_index;
 		int argument_size;
+		std::deque<arguments_type> pending;///<解析済みで未実行のコマンド
+		database_type * batch_database;///<パイプラインのグループで保持しているロック
+		shard_mask_type batch_shards;///<パイプラインのグループでロックしているshard
+		bool batch_writing;
+		bool out_of_memory;///<直前の追い出しでmaxmemory以下にできなかった
+		std::vector<size_t> key_positions;
+		const api_info * executing_api;///<実行中のコマンド
 		std::string password;
 		static const int argument_is_null = -1;
 		static const int argument_is_undefined = -2;
@@ -34,7 +43,7 @@ namespace rediscpp
 		bool writing_transaction;
 		bool multi_executing;
 		std::list<arguments_type> transaction_arguments;
-		std::set<std::tuple<std::string,int,timeval_type>> watching;
+		std::set<std::tuple<std::string,int,timeval_type,const type_interface *>> watching;///<キー、DB、監視を始めた時間と、その時の値
 		mutex_type write_mutex;
 		std::vector<uint8_t> write_cache;
 		timeval_type current_time;
@@ -42,22 +51,28 @@ namespace rediscpp
 		bool blocked;//for list
 		timeval_type blocked_till;
 		std::weak_ptr<client_type> self;
+		reactor_type * reactor;///<受け付けたスレッドのreactor、共有pollの場合はNULL
 		uint16_t listening_port;
 		bool slave;
 		bool monitor;
 		bool wrote;
 		std::shared_ptr<file_type> sending_file;
+		std::unordered_map<uint64_t,std::string> scan_cursors;///<SSCAN, ZSCANのカーソルと、次に続けるメンバー
+		std::deque<uint64_t> scan_cursor_order;///<古いカーソルから捨てる
+		static const size_t max_scan_cursors = 64;///<接続毎に覚えておくカーソルの数
+		void flush_cache();
+		reply_encoder_type get_reply_encoder();
 	public:
 		client_type(server_type & server_, std::shared_ptr<socket_type> & client_, const std::string & password_);
-		virtual ~client_type(){}
+		virtual ~client_type() { unwatch(); }
 		bool parse();
 		const arguments_type & get_arguments() const { return arguments; }
 		const std::string & get_argument(int index) const { return arguments[index]; }
-		const std::vector<std::string*> & get_keys() const { return keys; }
-		const std::vector<std::string*> & get_values() const { return values; }
-		const std::vector<std::string*> & get_fields() const { return fields; }
-		const std::vector<std::string*> & get_members() const { return members; }
-		const std::vector<std::string*> & get_scores() const { return scores; }
+		const std::vector<std::string*> & get_keys() const { return slices.keys; }
+		const std::vector<std::string*> & get_values() const { return slices.values; }
+		const std::vector<std::string*> & get_fields() const { return slices.fields; }
+		const std::vector<std::string*> & get_members() const { return slices.members; }
+		const std::vector<std::string*> & get_scores() const { return slices.scores; }
 		void response_status(const std::string & state);
 		void response_error(const std::string & state);
 		void response_ok();
@@ -67,6 +82,7 @@ namespace rediscpp
 		void response_integer0();
 		void response_integer1();
 		void response_bulk(const std::string & bulk, bool not_null = true);
+		void response_bulk(const std::shared_ptr<const std::string> & bulk);
 		void response_null();
 		void response_null_multi_bulk();
 		void response_start_multi_bulk(size_t count);
@@ -74,6 +90,10 @@ namespace rediscpp
 		void response_file(const std::string & path);
 		void request(const arguments_type & args);
 		void flush();
+		static const size_t max_pending_commands = 1024;///<これ以上溜まったら解析の途中でも実行する
+		static const int64_t max_multi_bulk_count = 1024 * 1024;
+		static const size_t max_reserved_arguments = 1024;///<引数の数の宣言だけで確保する上限
+		static const size_t max_reserved_bulk = 4 * 1024 * 1024;///<値の長さの宣言だけで確保する上限、超える分は受信に合わせて広げる
 		void close_after_send() { client->close_after_send(); }
 		bool require_auth(const std::string & auth);
 		bool auth(const std::string & password_);
@@ -83,16 +103,21 @@ namespace rediscpp
 		bool exec();
 		void discard();
 		bool in_exec() const;
+		bool in_batch(database_type * database, shard_mask_type shards, bool writing) const;
+		shard_mask_type get_shard_mask(const database_type & database) const;
 		bool queuing(const std::string & command, const api_info & info);
-		void unwatch() { watching.clear(); }
-		void watch(const std::string & key);
-		std::set<std::tuple<std::string,int,timeval_type>> & get_watching() { return watching; }
+		void unwatch();
+		void watch(const std::string & key, const type_interface * value);
+		std::set<std::tuple<std::string,int,timeval_type,const type_interface *>> & get_watching() { return watching; }
 		size_t get_transaction_size() { return transaction_arguments.size(); }
+		void get_transaction_shards(std::vector<shard_mask_type> & shards);
 		bool unqueue();
 		timeval_type get_time() const { return current_time; }
 		virtual void process();
 		void set(std::shared_ptr<client_type> self_) { self = self_; }
 		std::shared_ptr<client_type> get() { return self.lock(); }
+		void set_reactor(reactor_type * reactor_) { reactor = reactor_; }
+		reactor_type * get_reactor() const { return reactor; }
 		bool is_blocked() const { return blocked; }
 		timeval_type get_blocked_till() const { return blocked_till; }
 		void start_blocked(int64_t sec)
@@ -115,12 +140,28 @@ namespace rediscpp
 		bool is_slave() const { return slave; }
 		void set_monitor() { monitor = true; }
 		bool is_monitor() const { return monitor; }
+		uint64_t save_scan_cursor(const std::string & member);
+		bool load_scan_cursor(const std::string & cursor, std::string & member);
 	protected:
 		void inline_command_parser(const std::string & line);
 		bool parse_line(std::string & line);
+		bool parse_header(int64_t & value, bool & is_valid);
 		bool parse_data(std::string & data, int size);
 		bool execute();
 		bool execute(const api_info & info);
+		void push_pending();
+		void execute_pending();
+		void execute_front();
+		bool is_writing_front() const;
+		size_t get_batch_size();
+	};
+	///client_typeのwrite_mutexを保持したまま応答を書き込む
+	///@note 複数要素の応答は一つのreply_typeで書き、要素毎のロックを避ける
+	class reply_type : private mutex_locker, public reply_encoder_type
+	{
+		reply_type(const reply_type &);
+	public:
+		explicit reply_type(client_type * client);
 	};
 };
 
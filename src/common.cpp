@@ -55,6 +55,19 @@ namespace rediscpp
 		is_valid = (endptr == end && errno == 0 && 0 <= result && result <= 0xFFFF);
 		return static_cast<uint16_t>(result);
 	}
+	uint64_t atou64(const std::string & str, bool & is_valid)
+	{
+		if (str.empty() || !isdigit(static_cast<unsigned char>(str[0]))) {
+			is_valid = false;
+			return 0;
+		}
+		char * endptr = NULL;
+		errno = 0;
+		uint64_t result = strtoull(str.c_str(), &endptr, 10);
+		const char * end = str.c_str() + str.size();
+		is_valid = (endptr == end && errno == 0);
+		return result;
+	}
 	long double atold(const std::string & str, bool & is_valid)
 	{
 		if (str.empty()) {
@@ -20,6 +20,7 @@
 #include <unordered_set>
 #include <tuple>
 #include <memory>
+#include <atomic>
 #include <exception>
 #include <stdexcept>
 #include <limits>
@@ -37,9 +38,18 @@ namespace rediscpp
 	int64_t atoi64(const std::string & str);
 	int64_t atoi64(const std::string & str, bool & is_valid);
 	uint16_t atou16(const std::string & str, bool & is_valid);
+	uint64_t atou64(const std::string & str, bool & is_valid);
 	long double atold(const std::string & str, bool & is_valid);
 	double atod(const std::string & str, bool & is_valid);
 	bool pattern_match(const std::string & pattern, const std::string & target, bool nocase = false);
+	///ビットの並びを逆にする、SCANのカーソルを逆順のビットで進めるのに使う
+	inline uint64_t reverse_bits(uint64_t v)
+	{
+		v = ((v >> 1) & 0x5555555555555555ULL) | ((v & 0x5555555555555555ULL) << 1);
+		v = ((v >> 2) & 0x3333333333333333ULL) | ((v & 0x3333333333333333ULL) << 2);
+		v = ((v >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((v & 0x0F0F0F0F0F0F0F0FULL) << 4);
+		return __builtin_bswap64(v);
+	}
 };
 
 #endif
@@ -6,55 +6,248 @@
 #include "type_set.h"
 #include "type_string.h"
 #include "type_zset.h"
+#include "lazyfree.h"
+#include "glob_pattern.h"
 
 namespace rediscpp
 {
+	shard_locker_type::shard_locker_type(database_type & database_, shard_mask_type shards_, rwlock_types type_)
+		: database(database_)
+		, shards(shards_ & database_.get_all_shards())
+		, type(type_)
+	{
+		if (type == no_lock_type) {
+			return;
+		}
+		for (size_t i = 0, n = database.shards.size(); i < n; ++i) {
+			if (!(shards & (static_cast<shard_mask_type>(1) << i))) {
+				continue;
+			}
+			try {
+				if (type == write_lock_type) {
+					database.shards[i]->rwlock.wrlock();
+				} else {
+					database.shards[i]->rwlock.rdlock();
+				}
+			} catch (...) {
+				//取得済みのロックだけを解放する
+				shards &= (static_cast<shard_mask_type>(1) << i) - 1;
+				unlock();
+				throw;
+			}
+		}
+		if (type == write_lock_type) {
+			try {
+				database.reclaim_expired(shards);
+			} catch (...) {
+				unlock();
+				throw;
+			}
+		}
+	}
+	shard_locker_type::~shard_locker_type()
+	{
+		unlock();
+	}
+	///取得と逆の順に解放する
+	void shard_locker_type::unlock()
+	{
+		if (type == no_lock_type) {
+			return;
+		}
+		for (size_t i = database.shards.size(); 0 < i; --i) {
+			if (shards & (static_cast<shard_mask_type>(1) << (i - 1))) {
+				database.shards[i - 1]->rwlock.unlock();
+			}
+		}
+	}
+	///clientが実行中のコマンドのキーのshardだけをロックする
 	database_write_locker::database_write_locker(database_type * database_, client_type * client, bool rdlock)
 		: database(database_)
-		, locker(new rwlock_locker(database_->rwlock, client && client->in_exec() ? no_lock_type : (rdlock ? read_lock_type : write_lock_type)))
+	{
+		shard_mask_type shards = client ? client->get_shard_mask(*database_) : database_->get_all_shards();
+		locker.reset(new shard_locker_type(*database_, shards, client && (client->in_exec() || client->in_batch(database_, shards, !rdlock)) ? no_lock_type : (rdlock ? read_lock_type : write_lock_type)));
+	}
+	///指定したshardをロックする
+	database_write_locker::database_write_locker(database_type * database_, shard_mask_type shards, bool rdlock)
+		: database(database_)
+		, locker(new shard_locker_type(*database_, shards, rdlock ? read_lock_type : write_lock_type))
 	{
 	}
 	database_read_locker::database_read_locker(database_type * database_, client_type * client)
 		: database(database_)
-		, locker(new rwlock_locker(database_->rwlock, client && client->in_exec() ? no_lock_type : read_lock_type))
 	{
+		shard_mask_type shards = client ? client->get_shard_mask(*database_) : database_->get_all_shards();
+		locker.reset(new shard_locker_type(*database_, shards, client && (client->in_exec() || client->in_batch(database_, shards, false)) ? no_lock_type : read_lock_type));
+	}
+	reclaim_queue_type::~reclaim_queue_type()
+	{
+		for (node_type * node = head.exchange(NULL); node; ) {
+			node_type * next = node->next;
+			delete node;
+			node = next;
+		}
+	}
+	void reclaim_queue_type::push(const std::string & key)
+	{
+		node_type * node = new node_type(key);
+		node_type * top = head.load(std::memory_order_relaxed);
+		do {
+			node->next = top;
+		} while (!head.compare_exchange_weak(top, node, std::memory_order_release, std::memory_order_relaxed));
+	}
+	///積まれたキーをすべて取り出す
+	///@return 取り出した数
+	size_t reclaim_queue_type::pop_all(std::vector<std::string> & keys)
+	{
+		size_t count = 0;
+		for (node_type * node = head.exchange(NULL, std::memory_order_acquire); node; ++count) {
+			node_type * next = node->next;
+			keys.push_back(std::move(node->key));
+			delete node;
+			node = next;
+		}
+		return count;
+	}
+	std::atomic<uint64_t> database_type::lazy_expire_queued(0);
+	std::atomic<uint64_t> database_type::lazy_expire_pending(0);
+	std::atomic<uint64_t> database_type::lazy_expired_keys(0);
+	///指定したshardを読み込みロックする
+	database_read_locker::database_read_locker(database_type * database_, client_type * client, shard_mask_type shards)
+		: database(database_)
+		, locker(new shard_locker_type(*database_, shards, client && (client->in_exec() || client->in_batch(database_, shards, false)) ? no_lock_type : read_lock_type))
+	{
+	}
+	database_type::database_type(size_t shard_count, std::shared_ptr<lazyfree_type> lazyfree_)
+		: shard_shift(0)
+		, lazyfree(lazyfree_)
+	{
+		size_t count = 1;
+		while (count < shard_count && count < max_shard_count) {
+			count *= 2;
+		}
+		shards.resize(count);
+		for (auto it = shards.begin(), end = shards.end(); it != end; ++it) {
+			it->reset(new shard_type());
+		}
+		for (shard_shift = 64; 1 < count; count /= 2) {
+			--shard_shift;
+		}
 	}
-	database_type::database_type()
+	///キーのshardの番号
+	///@note unordered_mapのバケットと偏らないように、ハッシュの上位ビットを使う
+	size_t database_type::get_shard(const std::string & key) const
 	{
+		if (shards.size() == 1) {
+			return 0;
+		}
+		uint64_t hash = static_cast<uint64_t>(std::hash<std::string>()(key)) * 0x9E3779B97F4A7C15ULL;
+		return static_cast<size_t>(hash >> shard_shift);
 	}
 	size_t database_type::get_dbsize() const
 	{
-		return values.size();
+		size_t size = 0;
+		for (auto it = shards.begin(), end = shards.end(); it != end; ++it) {
+			size += (*it)->values.size();
+		}
+		return size;
+	}
+	///@param async 各shardの辞書を空の辞書と入れ替えて、解放を別スレッドに任せる
+	void database_type::clear(bool async)
+	{
+		for (auto it = shards.begin(), end = shards.end(); it != end; ++it) {
+			auto & values = (*it)->values;
+			if (async && lazyfree) {
+				std::unique_ptr<values_type> detached(new values_type());
+				detached->swap(values);
+				lazyfree->free_dictionary(std::move(detached));
+			} else {
+				values.clear();
+			}
+		}
 	}
-	void database_type::clear()
+	///大きな値は別スレッドで解放する
+	void database_type::release_value(std::shared_ptr<type_interface> & value)
 	{
-		values.clear();
+		if (lazyfree) {
+			lazyfree->free_value(value);
+		}
 	}
+	///参照した時間と回数を記録して値を返す
 	std::shared_ptr<type_interface> database_type::get(const std::string & key, const timeval_type & current) const
 	{
-		auto it = values.find(key);
-		if (it == values.end()) {
+		std::shared_ptr<type_interface> value = peek(key, current);
+		if (value) {
+			value->touch(current);
+		}
+		return value;
+	}
+	///参照を記録せずに値を返す
+	///@note 期限切れを見つけても読み込みロックでは消せないので、回収待ちに積む
+	std::shared_ptr<type_interface> database_type::peek(const std::string & key, const timeval_type & current) const
+	{
+		auto & shard = get_shard_of(key);
+		auto entry = shard.values.find(key);
+		if (!entry) {
 			return std::shared_ptr<type_interface>();
 		}
-		auto & value = it->second;
-		if (value.first->is_expired(current)) {
-			//values.erase(it);
+		if (shard.values.is_expired(*entry, current)) {
+			defer_expired(shard, *entry);
 			return std::shared_ptr<type_interface>();
 		}
-		return value.second;
+		return entry->value;
 	}
-	std::pair<std::shared_ptr<expire_info>,std::shared_ptr<type_interface>> database_type::get_with_expire(const std::string & key, const timeval_type & current) const
+	std::pair<expire_info,std::shared_ptr<type_interface>> database_type::get_with_expire(const std::string & key, const timeval_type & current) const
 	{
-		auto it = values.find(key);
-		if (it == values.end()) {
-			return std::make_pair(std::shared_ptr<expire_info>(), std::shared_ptr<type_interface>());
+		auto & shard = get_shard_of(key);
+		auto entry = shard.values.find(key);
+		if (!entry) {
+			return std::make_pair(expire_info(), std::shared_ptr<type_interface>());
 		}
-		auto & value = it->second;
-		if (value.first->is_expired(current)) {
-			//values.erase(it);
-			return std::make_pair(std::shared_ptr<expire_info>(), std::shared_ptr<type_interface>());
+		if (shard.values.is_expired(*entry, current)) {
+			defer_expired(shard, *entry);
+			return std::make_pair(expire_info(), std::shared_ptr<type_interface>());
+		}
+		entry->value->touch(current);
+		return std::make_pair(shard.values.get_expire(*entry), entry->value);
+	}
+	///期限切れの要素を回収待ちに積む
+	///@note 積んだ要素には印を付け、回収するまで同じキーを重ねて積まない
+	void database_type::defer_expired(const shard_type & shard, const dictionary_entry_type & entry) const
+	{
+		if (entry.reclaiming.exchange(true, std::memory_order_relaxed)) {
+			return;
+		}
+		shard.reclaims.push(entry.key);
+		++lazy_expire_queued;
+		++lazy_expire_pending;
+	}
+	///書き込みロックを取ったshardの回収待ちのキーを消す
+	///@note 積んだ後に期限が更新されていれば残す
+	void database_type::reclaim_expired(shard_mask_type mask)
+	{
+		std::vector<std::string> keys;
+		timeval_type current;
+		for (size_t i = 0, n = shards.size(); i < n; ++i) {
+			if (!(mask & (static_cast<shard_mask_type>(1) << i)) || shards[i]->reclaims.empty()) {
+				continue;
+			}
+			keys.clear();
+			lazy_expire_pending -= shards[i]->reclaims.pop_all(keys);
+			auto & values = shards[i]->values;
+			for (auto it = keys.begin(), end = keys.end(); it != end; ++it) {
+				auto entry = values.find(*it);
+				if (!entry) {
+					continue;
+				}
+				entry->reclaiming = false;
+				if (values.is_expired(*entry, current)) {
+					release_value(entry->value);
+					values.erase(entry);
+					++lazy_expired_keys;
+				}
+			}
 		}
-		return value;
 	}
 	template<typename T>
 	std::shared_ptr<T> get_as(const database_type & db, const std::string & key, const timeval_type & current)
@@ -70,11 +263,11 @@ namespace rediscpp
 		return value;
 	}
 	template<typename T>
-	std::pair<std::shared_ptr<expire_info>,std::shared_ptr<T>> get_as_with_expire(const database_type & db, const std::string & key, const timeval_type & current)
+	std::pair<expire_info,std::shared_ptr<T>> get_as_with_expire(const database_type & db, const std::string & key, const timeval_type & current)
 	{
-		std::pair<std::shared_ptr<expire_info>,std::shared_ptr<type_interface>> val = db.get_with_expire(key, current);
+		std::pair<expire_info,std::shared_ptr<type_interface>> val = db.get_with_expire(key, current);
 		if (!val.second) {
-			return std::make_pair(std::shared_ptr<expire_info>(), std::shared_ptr<T>());
+			return std::make_pair(expire_info(), std::shared_ptr<T>());
 		}
 		std::shared_ptr<T> value = std::dynamic_pointer_cast<T>(val.second);
 		if (!value) {
@@ -87,119 +280,259 @@ namespace rediscpp
 	std::shared_ptr<type_hash> database_type::get_hash(const std::string & key, const timeval_type & current) const { return get_as<type_hash>(*this, key, current); }
 	std::shared_ptr<type_set> database_type::get_set(const std::string & key, const timeval_type & current) const { return get_as<type_set>(*this, key, current); }
 	std::shared_ptr<type_zset> database_type::get_zset(const std::string & key, const timeval_type & current) const { return get_as<type_zset>(*this, key, current); }
-	std::pair<std::shared_ptr<expire_info>,std::shared_ptr<type_string>> database_type::get_string_with_expire(const std::string & key, const timeval_type & current) const { return get_as_with_expire<type_string>(*this, key, current); }
-	std::pair<std::shared_ptr<expire_info>,std::shared_ptr<type_list>> database_type::get_list_with_expire(const std::string & key, const timeval_type & current) const { return get_as_with_expire<type_list>(*this, key, current); }
-	std::pair<std::shared_ptr<expire_info>,std::shared_ptr<type_hash>> database_type::get_hash_with_expire(const std::string & key, const timeval_type & current) const { return get_as_with_expire<type_hash>(*this, key, current); }
-	std::pair<std::shared_ptr<expire_info>,std::shared_ptr<type_set>> database_type::get_set_with_expire(const std::string & key, const timeval_type & current) const { return get_as_with_expire<type_set>(*this, key, current); }
-	std::pair<std::shared_ptr<expire_info>,std::shared_ptr<type_zset>> database_type::get_zset_with_expire(const std::string & key, const timeval_type & current) const { return get_as_with_expire<type_zset>(*this, key, current); }
+	std::pair<expire_info,std::shared_ptr<type_string>> database_type::get_string_with_expire(const std::string & key, const timeval_type & current) const { return get_as_with_expire<type_string>(*this, key, current); }
+	std::pair<expire_info,std::shared_ptr<type_list>> database_type::get_list_with_expire(const std::string & key, const timeval_type & current) const { return get_as_with_expire<type_list>(*this, key, current); }
+	std::pair<expire_info,std::shared_ptr<type_hash>> database_type::get_hash_with_expire(const std::string & key, const timeval_type & current) const { return get_as_with_expire<type_hash>(*this, key, current); }
+	std::pair<expire_info,std::shared_ptr<type_set>> database_type::get_set_with_expire(const std::string & key, const timeval_type & current) const { return get_as_with_expire<type_set>(*this, key, current); }
+	std::pair<expire_info,std::shared_ptr<type_zset>> database_type::get_zset_with_expire(const std::string & key, const timeval_type & current) const { return get_as_with_expire<type_zset>(*this, key, current); }
 	bool database_type::erase(const std::string & key, const timeval_type & current)
 	{
-		auto it = values.find(key);
-		if (it == values.end()) {
+		auto & values = get_values(key);
+		auto entry = values.find(key);
+		if (!entry) {
 			return false;
 		}
-		auto value = it->second;
-		if (value.first->is_expired(current)) {
-			values.erase(it);
+		bool expired = values.is_expired(*entry, current);
+		release_value(entry->value);
+		values.erase(entry);
+		return !expired;
+	}
+	///有効期限を設定する
+	///@return キーが無ければfalse
+	bool database_type::expire(const std::string & key, const timeval_type & at, const timeval_type & current)
+	{
+		auto & values = get_values(key);
+		auto entry = values.find(key);
+		if (!entry || values.is_expired(*entry, current)) {
+			return false;
+		}
+		expire_info info;
+		info.expire(at);
+		values.set_expire(*entry, info);
+		return true;
+	}
+	bool database_type::persist(const std::string & key, const timeval_type & current)
+	{
+		auto & values = get_values(key);
+		auto entry = values.find(key);
+		if (!entry || values.is_expired(*entry, current)) {
 			return false;
 		}
-		values.erase(it);
+		values.persist(*entry);
 		return true;
 	}
 	bool database_type::insert(const std::string & key, const expire_info & expire, std::shared_ptr<type_interface> value, const timeval_type & current)
 	{
-		auto it = values.find(key);
-		if (it == values.end()) {
-			bool result = values.insert(std::make_pair(key, std::make_pair(std::shared_ptr<expire_info>(new expire_info(expire)), value))).second;
-			if (result && expire.is_expiring()) {
-				regist_expiring_key(expire.at(), key);
-			}
-			return result;
-		} else {
-			if (it->second.first->is_expired(current)) {
-				it->second.first->set(expire);
-				it->second.second = value;
-				if (expire.is_expiring()) {
-					regist_expiring_key(expire.at(), key);
-				}
-				return true;
-			}
+		auto & values = get_values(key);
+		auto result = values.insert(key);
+		auto entry = result.first;
+		if (!result.second && !values.is_expired(*entry, current)) {
 			return false;
 		}
+		values.set_expire(*entry, expire);
+		release_value(entry->value);
+		entry->value = value;
+		value->account();
+		return true;
 	}
 	void database_type::replace(const std::string & key, const expire_info & expire, std::shared_ptr<type_interface> value)
 	{
-		auto & dst = values[key];
-		dst.first.reset(new expire_info(expire));
-		dst.second = value;
-		if (expire.is_expiring()) {
-			regist_expiring_key(expire.at(), key);
-		}
+		auto & values = get_values(key);
+		auto entry = values.insert(key).first;
+		values.set_expire(*entry, expire);
+		release_value(entry->value);
+		entry->value = value;
+		value->account();
 	}
 	bool database_type::insert(const std::string & key, std::shared_ptr<type_interface> value, const timeval_type & current)
 	{
-		auto it = values.find(key);
-		if (it == values.end()) {
-			return values.insert(std::make_pair(key, std::make_pair(std::shared_ptr<expire_info>(new expire_info()), value))).second;
-		} else {
-			if (it->second.first->is_expired(current)) {
-				it->second.first->persist();
-				it->second.second = value;
-				return true;
-			}
+		auto & values = get_values(key);
+		auto result = values.insert(key);
+		auto entry = result.first;
+		if (!result.second && !values.is_expired(*entry, current)) {
 			return false;
 		}
+		values.persist(*entry);
+		release_value(entry->value);
+		entry->value = value;
+		value->account();
+		return true;
 	}
 	void database_type::replace(const std::string & key, std::shared_ptr<type_interface> value)
 	{
-		auto & dst = values[key];
-		dst.first.reset(new expire_info());
-		dst.second = value;
+		auto & values = get_values(key);
+		auto entry = values.insert(key).first;
+		values.persist(*entry);
+		release_value(entry->value);
+		entry->value = value;
+		value->account();
+	}
+	///有効期限を変えずに、既にあるキーの値を置き換える
+	void database_type::replace_value(const std::string & key, std::shared_ptr<type_interface> value)
+	{
+		auto entry = get_values(key).find(key);
+		if (!entry) {
+			return;
+		}
+		release_value(entry->value);
+		entry->value = value;
+		value->account();
 	}
-	std::string database_type::randomkey(const timeval_type & current)
+	///@note shardの大きさに比例して選び、shardの辞書の中から一様に選ぶので、キー全体から一様に選ぶ
+	///@note 期限切れを引いたら回収待ちに積んで選び直し、続く場合は先頭から探す
+	std::string database_type::randomkey(const timeval_type & current) const
 	{
-		while (!values.empty()) {
-			auto it = values.begin();
-			std::advance(it, rand() % values.size());
-			if (it->second.first->is_expired(current)) {
-				values.erase(it);
+		const size_t size = get_dbsize();
+		if (!size) {
+			return std::string();
+		}
+		for (size_t tries = 0; tries < randomkey_max_tries; ++tries) {
+			const uint64_t random = (static_cast<uint64_t>(rand()) << 31) ^ rand();
+			size_t index = random % size;
+			auto sit = shards.begin();
+			for (; index >= (*sit)->values.size(); ++sit) {
+				index -= (*sit)->values.size();
+			}
+			auto & shard = **sit;
+			auto entry = shard.values.sample(random);
+			if (shard.values.is_expired(*entry, current)) {
+				defer_expired(shard, *entry);
 				continue;
 			}
-			return it->first;
+			return entry->key;
+		}
+		for (auto sit = shards.begin(), send = shards.end(); sit != send; ++sit) {
+			auto & shard = **sit;
+			for (auto it = shard.values.begin(), end = shard.values.end(); it != end; ++it) {
+				if (!shard.values.is_expired(*it, current)) {
+					return it->key;
+				}
+				defer_expired(shard, *it);
+			}
 		}
 		return std::string();
 	}
-	void database_type::regist_expiring_key(timeval_type tv, const std::string & key) const
+	///shardの期限の切れたキーを最大count個消す
+	///@note shardの書き込みロックを保持して呼ぶ
+	///@return 消した数
+	size_t database_type::expire_keys(size_t shard, const timeval_type & current, size_t count)
 	{
-		mutex_locker locker(expire_mutex);
-		expires.insert(std::make_pair(tv, key));
+		auto & values = shards[shard]->values;
+		size_t erased = 0;
+		for (; erased < count; ++erased) {
+			auto entry = values.front_expired(current);
+			if (!entry) {
+				break;
+			}
+			release_value(entry->value);
+			values.erase(entry);
+		}
+		return erased;
 	}
-	void database_type::flush_expiring_key(const timeval_type & current)
+	///無作為に選んだキーを、スコアの高い順に並べた追い出す候補に加える
+	///@note スコアはLRUなら参照していない秒数、LFUなら参照回数の少なさで、候補に残した後は更新しない
+	namespace
 	{
-		mutex_locker locker(expire_mutex);
-		if (expires.empty()) {
-			return;
+		bool compare_score(const std::pair<uint32_t,std::string> & lhs, const std::pair<uint32_t,std::string> & rhs)
+		{
+			return lhs.first < rhs.first;
+		}
+	}
+	void database_type::populate_eviction_pool(shard_type & shard, maxmemory_policies policy, const timeval_type & current)
+	{
+		auto & pool = shard.eviction_pool;
+		const uint64_t random = (static_cast<uint64_t>(rand()) << 31) ^ rand();
+		for (size_t i = 0; i < eviction_samples; ++i) {
+			const uint64_t seed = random + i * 0x9E3779B97F4A7C15ULL;
+			const dictionary_entry_type * entry = policy == volatile_lfu_policy ? shard.values.sample_expiring(seed) : shard.values.sample(seed);
+			if (!entry) {
+				break;
+			}
+			const uint32_t score = policy == allkeys_lru_policy ? entry->value->get_idle(current) : 255 - entry->value->get_freq(current);
+			if (pool.size() == eviction_pool_size && score <= pool.front().first) {
+				continue;
+			}
+			//同じ点数の候補だけを比べて、同じキーを二度入れない
+			auto range = std::equal_range(pool.begin(), pool.end(), std::make_pair(score, std::string()), compare_score);
+			bool found = false;
+			for (auto it = range.first; it != range.second; ++it) {
+				if (it->second == entry->key) {
+					found = true;
+					break;
+				}
+			}
+			if (found) {
+				continue;
+			}
+			if (pool.size() < eviction_pool_size) {
+				pool.insert(range.second, std::make_pair(score, entry->key));
+				continue;
+			}
+			//満杯なら最も消しにくい先頭を捨てて詰め、キーの領域は使い回す
+			auto position = range.second - 1;
+			std::rotate(pool.begin(), pool.begin() + 1, range.second);
+			position->first = score;
+			position->second.assign(entry->key);
 		}
-		auto it = expires.begin(), end = expires.end();
-		for (; it != end && it->first < current; ++it) {
-			auto vit = values.find(it->second);
-			if (vit != values.end() && vit->second.first->is_expired(current)) {
-				values.erase(vit);
+	}
+	///shardからpolicyに従ってキーを一つ消す
+	///@note shardの書き込みロックを保持して呼ぶ
+	///@return 消せるキーが無ければfalse
+	bool database_type::evict(size_t shard, maxmemory_policies policy, const timeval_type & current)
+	{
+		auto & values = shards[shard]->values;
+		if (values.empty()) {
+			return false;
+		}
+		dictionary_entry_type * victim = NULL;
+		switch (policy) {
+		case allkeys_random_policy:
+			victim = values.sample((static_cast<uint64_t>(rand()) << 31) ^ rand());
+			break;
+		case allkeys_lru_policy:
+		case allkeys_lfu_policy:
+		case volatile_lfu_policy:
+			{
+				//候補のキーが既に消えていれば次の候補を使う
+				auto & pool = shards[shard]->eviction_pool;
+				populate_eviction_pool(*shards[shard], policy, current);
+				while (!victim && !pool.empty()) {
+					victim = values.find(pool.back().second);
+					pool.pop_back();
+					if (victim && policy == volatile_lfu_policy && !victim->is_expiring()) {
+						victim = NULL;
+					}
+				}
 			}
+			break;
+		case volatile_ttl_policy:
+			victim = values.soonest_expiring(eviction_samples);
+			break;
+		default:
+			break;
 		}
-		expires.erase(expires.begin(), it);
+		if (!victim) {
+			return false;
+		}
+		release_value(victim->value);
+		values.erase(victim);
+		return true;
+	}
+	///移行中のshardの辞書をbudget_nsの間だけ進める
+	///@note shardの書き込みロックを保持して呼ぶ
+	///@return まだ移行中ならtrue
+	bool database_type::rehash(size_t shard, uint64_t budget_ns)
+	{
+		return shards[shard]->values.rehash(budget_ns);
 	}
 	void database_type::match(std::unordered_set<std::string> & result, const std::string & pattern) const
 	{
-		if (pattern == "*") {
-			for (auto it = values.begin(), end = values.end(); it != end; ++it) {
-				auto & key = it->first;
-				result.insert(key);
-			}
-		} else {
+		glob_pattern_type matcher(pattern);
+		for (auto sit = shards.begin(), send = shards.end(); sit != send; ++sit) {
+			auto & values = (*sit)->values;
 			for (auto it = values.begin(), end = values.end(); it != end; ++it) {
-				auto & key = it->first;
-				if (pattern_match(pattern, key)) {
+				auto & key = it->key;
+				if (matcher.match(key)) {
 					result.insert(key);
 				}
 			}
@@ -5,65 +5,151 @@
 #include "thread.h"
 #include "type_interface.h"
 #include "expire_info.h"
+#include "dictionary.h"
 
 namespace rediscpp
 {
 	class client_type;
 	class database_type;
+	class lazyfree_type;
+	///maxmemoryを超えた時に消すキーの選び方
+	enum maxmemory_policies
+	{
+		noeviction_policy,///<消さずに書き込みを断る
+		allkeys_random_policy,
+		volatile_ttl_policy,///<有効期限の最も早いキー
+		allkeys_lru_policy,///<数個を選び、最も長く参照していないキー
+		allkeys_lfu_policy,///<数個を選び、最も参照回数の少ないキー
+		volatile_lfu_policy,///<有効期限のあるキーから数個を選び、最も参照回数の少ないキー
+	};
+	///shardの集合をビット毎に表す
+	typedef uint64_t shard_mask_type;
+	///database_typeのshardのロック
+	///@note 番号の小さいshardから順にロックするので、複数のshardを取っても互いに待ち合わない
+	class shard_locker_type
+	{
+		database_type & database;
+		shard_mask_type shards;
+		rwlock_types type;
+		shard_locker_type(const shard_locker_type &);
+		void unlock();
+	public:
+		shard_locker_type(database_type & database_, shard_mask_type shards_, rwlock_types type_);
+		~shard_locker_type();
+	};
 	class database_write_locker
 	{
 		database_type * database;
-		std::shared_ptr<rwlock_locker> locker;
+		std::shared_ptr<shard_locker_type> locker;
 	public:
 		database_write_locker(database_type * database_, client_type * client, bool rdlock);
+		database_write_locker(database_type * database_, shard_mask_type shards, bool rdlock);
 		database_type * get() { return database; }
 		database_type * operator->() { return database; }
 	};
 	class database_read_locker
 	{
 		database_type * database;
-		std::shared_ptr<rwlock_locker> locker;
+		std::shared_ptr<shard_locker_type> locker;
 	public:
 		database_read_locker(database_type * database_, client_type * client);
+		database_read_locker(database_type * database_, client_type * client, shard_mask_type shards);
 		const database_type * get() { return database; }
 		const database_type * operator->() { return database; }
 	};
+	///読み込みロックで見つけた期限切れのキーを、書き込みロックを取った側に渡すスタック
+	///@note 複数のスレッドから積み、取り出す側は全体を一度に取るので、ABAの問題が起きない
+	class reclaim_queue_type
+	{
+		struct node_type
+		{
+			std::string key;
+			node_type * next;
+			node_type(const std::string & key_) : key(key_), next(NULL) {}
+		};
+		std::atomic<node_type *> head;
+		reclaim_queue_type(const reclaim_queue_type &);
+		reclaim_queue_type & operator=(const reclaim_queue_type &);
+	public:
+		reclaim_queue_type() : head(NULL) {}
+		~reclaim_queue_type();
+		bool empty() const { return head.load(std::memory_order_relaxed) == NULL; }
+		void push(const std::string & key);
+		size_t pop_all(std::vector<std::string> & keys);
+	};
+	///キーのハッシュで分けたshard毎にロックを持つデータベース
+	///@note キーを指定する操作は、そのキーのshardのロックを保持して呼ぶ
+	///@note 全体を走査する操作は、すべてのshardのロックを保持して呼ぶ
 	class database_type
 	{
-		friend class database_write_locker;
-		friend class database_read_locker;
-		std::unordered_map<std::string,std::pair<std::shared_ptr<expire_info>,std::shared_ptr<type_interface>>> values;
-		mutable mutex_type expire_mutex;
-		mutable std::multimap<timeval_type,std::string> expires;
-		rwlock_type rwlock;
+		friend class shard_locker_type;
+		typedef dictionary_type values_type;
+		struct shard_type
+		{
+			values_type values;
+			rwlock_type rwlock;
+			mutable reclaim_queue_type reclaims;
+			std::vector<std::pair<uint32_t,std::string>> eviction_pool;///<追い出す候補のスコアとキー、スコアの昇順
+		};
+		std::vector<std::unique_ptr<shard_type>> shards;
+		int shard_shift;
+		std::shared_ptr<lazyfree_type> lazyfree;
 		database_type(const database_type &);
+		values_type & get_values(const std::string & key) { return shards[get_shard(key)]->values; }
+		const values_type & get_values(const std::string & key) const { return shards[get_shard(key)]->values; }
+		const shard_type & get_shard_of(const std::string & key) const { return *shards[get_shard(key)]; }
+		void defer_expired(const shard_type & shard, const dictionary_entry_type & entry) const;
+		void reclaim_expired(shard_mask_type mask);
+		void release_value(std::shared_ptr<type_interface> & value);
+		void populate_eviction_pool(shard_type & shard, maxmemory_policies policy, const timeval_type & current);
 	public:
-		typedef std::unordered_map<std::string,std::pair<std::shared_ptr<expire_info>,std::shared_ptr<type_interface>>>::const_iterator const_iterator;
-		database_type();
+		typedef values_type::const_iterator const_iterator;
+		static const size_t default_shard_count = 16;
+		static const size_t max_shard_count = 64;
+		static const size_t randomkey_max_tries = 100;///<期限切れのキーを引いた場合に選び直す回数
+		static const size_t eviction_samples = 5;///<追い出す候補に加えるキーの数と、有効期限で比べるキーの数
+		static const size_t eviction_pool_size = 16;///<shard毎に残しておく追い出す候補の数
+		static std::atomic<uint64_t> lazy_expire_queued;///<読み込みで回収待ちに積んだキー数
+		static std::atomic<uint64_t> lazy_expire_pending;///<まだ回収していないキー数
+		static std::atomic<uint64_t> lazy_expired_keys;///<回収待ちから消したキー数
+		database_type(size_t shard_count = default_shard_count, std::shared_ptr<lazyfree_type> lazyfree_ = std::shared_ptr<lazyfree_type>());
+		size_t get_shard_count() const { return shards.size(); }
+		size_t get_shard(const std::string & key) const;
+		shard_mask_type get_shard_mask(const std::string & key) const { return static_cast<shard_mask_type>(1) << get_shard(key); }
+		shard_mask_type get_all_shards() const { return shards.size() == max_shard_count ? ~static_cast<shard_mask_type>(0) : (static_cast<shard_mask_type>(1) << shards.size()) - 1; }
 		size_t get_dbsize() const;
-		void clear();
+		void clear(bool async = false);
 		std::shared_ptr<type_interface> get(const std::string & key, const timeval_type & current) const;
-		std::pair<std::shared_ptr<expire_info>,std::shared_ptr<type_interface>> get_with_expire(const std::string & key, const timeval_type & current) const;
+		std::shared_ptr<type_interface> peek(const std::string & key, const timeval_type & current) const;
+		std::pair<expire_info,std::shared_ptr<type_interface>> get_with_expire(const std::string & key, const timeval_type & current) const;
 		std::shared_ptr<type_string> get_string(const std::string & key, const timeval_type & current) const;
 		std::shared_ptr<type_list> get_list(const std::string & key, const timeval_type & current) const;
 		std::shared_ptr<type_hash> get_hash(const std::string & key, const timeval_type & current) const;
 		std::shared_ptr<type_set> get_set(const std::string & key, const timeval_type & current) const;
 		std::shared_ptr<type_zset> get_zset(const std::string & key, const timeval_type & current) const;
-		std::pair<std::shared_ptr<expire_info>,std::shared_ptr<type_string>> get_string_with_expire(const std::string & key, const timeval_type & current) const;
-		std::pair<std::shared_ptr<expire_info>,std::shared_ptr<type_list>> get_list_with_expire(const std::string & key, const timeval_type & current) const;
-		std::pair<std::shared_ptr<expire_info>,std::shared_ptr<type_hash>> get_hash_with_expire(const std::string & key, const timeval_type & current) const;
-		std::pair<std::shared_ptr<expire_info>,std::shared_ptr<type_set>> get_set_with_expire(const std::string & key, const timeval_type & current) const;
-		std::pair<std::shared_ptr<expire_info>,std::shared_ptr<type_zset>> get_zset_with_expire(const std::string & key, const timeval_type & current) const;
+		std::pair<expire_info,std::shared_ptr<type_string>> get_string_with_expire(const std::string & key, const timeval_type & current) const;
+		std::pair<expire_info,std::shared_ptr<type_list>> get_list_with_expire(const std::string & key, const timeval_type & current) const;
+		std::pair<expire_info,std::shared_ptr<type_hash>> get_hash_with_expire(const std::string & key, const timeval_type & current) const;
+		std::pair<expire_info,std::shared_ptr<type_set>> get_set_with_expire(const std::string & key, const timeval_type & current) const;
+		std::pair<expire_info,std::shared_ptr<type_zset>> get_zset_with_expire(const std::string & key, const timeval_type & current) const;
 		bool erase(const std::string & key, const timeval_type & current);
+		bool expire(const std::string & key, const timeval_type & at, const timeval_type & current);
+		bool persist(const std::string & key, const timeval_type & current);
 		bool insert(const std::string & key, const expire_info & expire, std::shared_ptr<type_interface> value, const timeval_type & current);
 		void replace(const std::string & key, const expire_info & expire, std::shared_ptr<type_interface> value);
 		bool insert(const std::string & key, std::shared_ptr<type_interface> value, const timeval_type & current);
 		void replace(const std::string & key, std::shared_ptr<type_interface> value);
-		std::string randomkey(const timeval_type & current);
-		void regist_expiring_key(timeval_type tv, const std::string & key) const;
-		void flush_expiring_key(const timeval_type & current);
+		void replace_value(const std::string & key, std::shared_ptr<type_interface> value);
+		std::string randomkey(const timeval_type & current) const;
+		size_t expire_keys(size_t shard, const timeval_type & current, size_t count);
+		bool evict(size_t shard, maxmemory_policies policy, const timeval_type & current);
+		size_t get_expiring_count(size_t shard) const { return shards[shard]->values.get_expiring_count(); }
+		int64_t get_expire_ms(size_t shard, const dictionary_entry_type & entry) const { return shards[shard]->values.get_expire_ms(entry); }
+		bool is_expired(size_t shard, const dictionary_entry_type & entry, const timeval_type & current) const { return shards[shard]->values.is_expired(entry, current); }
+		bool rehash(size_t shard, uint64_t budget_ns);
 		void match(std::unordered_set<std::string> & result, const std::string & pattern) const;
-		std::pair<const_iterator,const_iterator> range() const { return std::make_pair(values.begin(), values.end()); }
+		uint64_t scan(size_t shard, uint64_t cursor, const std::function<void(const dictionary_entry_type &)> & callback) const { return shards[shard]->values.scan(cursor, callback); }
+		std::pair<const_iterator,const_iterator> range(size_t shard) const { return std::make_pair(shards[shard]->values.begin(), shards[shard]->values.end()); }
 	};
 };
 
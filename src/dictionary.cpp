@@ -0,0 +1,530 @@
+#include "dictionary.h"
+#include "type_interface.h"
+#include <time.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace rediscpp
+{
+	namespace
+	{
+		///16個の制御バイト
+		///@note matchは条件に合う位置をビットで返す
+#if defined(__SSE2__)
+		struct group_type
+		{
+			__m128i controls;
+			explicit group_type(const int8_t * position) : controls(_mm_loadu_si128(reinterpret_cast<const __m128i *>(position))) {}
+			uint32_t match(int8_t h2) const { return _mm_movemask_epi8(_mm_cmpeq_epi8(controls, _mm_set1_epi8(h2))); }
+			uint32_t match_empty(int8_t empty) const { return _mm_movemask_epi8(_mm_cmpeq_epi8(controls, _mm_set1_epi8(empty))); }
+			uint32_t match_free() const { return _mm_movemask_epi8(controls); }
+		};
+#else
+		struct group_type
+		{
+			const int8_t * controls;
+			explicit group_type(const int8_t * position) : controls(position) {}
+			uint32_t match(int8_t h2) const
+			{
+				uint32_t result = 0;
+				for (size_t i = 0; i < dictionary_type::group_size; ++i) {
+					result |= static_cast<uint32_t>(controls[i] == h2) << i;
+				}
+				return result;
+			}
+			uint32_t match_empty(int8_t empty) const { return match(empty); }
+			uint32_t match_free() const
+			{
+				uint32_t result = 0;
+				for (size_t i = 0; i < dictionary_type::group_size; ++i) {
+					result |= static_cast<uint32_t>(controls[i] < 0) << i;
+				}
+				return result;
+			}
+		};
+#endif
+		inline int8_t get_h2(size_t h) { return static_cast<int8_t>(h & 0x7F); }
+		inline size_t get_h1(size_t h) { return h >> 7; }
+		inline size_t lowest_bit(uint32_t bits) { return __builtin_ctz(bits); }
+		///maskより上のビットを立ててから、逆順のビットで1を足す
+		inline uint64_t next_cursor(uint64_t cursor, uint64_t mask)
+		{
+			return reverse_bits(reverse_bits(cursor | ~mask) + 1);
+		}
+	}
+	const size_t dictionary_type::group_size;
+	const int8_t dictionary_type::empty_control;
+	const int8_t dictionary_type::deleted_control;
+	std::atomic<uint64_t> dictionary_type::rehash_started(0);
+	std::atomic<uint64_t> dictionary_type::rehash_active(0);
+	std::atomic<uint64_t> dictionary_type::rehash_total_slots(0);
+	std::atomic<uint64_t> dictionary_type::rehash_pending_slots(0);
+	std::atomic<uint64_t> dictionary_type::rehash_max_step_ns(0);
+	std::atomic<int64_t> dictionary_type::used_memory(0);
+	dictionary_type::table_type::table_type()
+		: controls(NULL)
+		, slots(NULL)
+		, capacity(0)
+		, count(0)
+		, growth_left(0)
+	{
+	}
+	///制御バイトと要素を一つの領域に確保する
+	void dictionary_type::table_type::allocate(size_t capacity_)
+	{
+		char * block = static_cast<char *>(::operator new(capacity_ * (sizeof(int8_t) + sizeof(entry_type))));
+		controls = reinterpret_cast<int8_t *>(block);
+		slots = reinterpret_cast<entry_type *>(block + capacity_);
+		memset(controls, empty_control, capacity_);
+		capacity = capacity_;
+		count = 0;
+		growth_left = get_max_count(capacity_);
+	}
+	void dictionary_type::table_type::release()
+	{
+		for (size_t i = 0; count && i < capacity; ++i) {
+			if (0 <= controls[i]) {
+				slots[i].~entry_type();
+			}
+		}
+		::operator delete(controls);
+		controls = NULL;
+		slots = NULL;
+		capacity = count = growth_left = 0;
+	}
+	///キーの位置、無ければcapacity
+	///@note グループ単位の三角数の順で探し、空きのあるグループで止める
+	size_t dictionary_type::table_type::find_position(const std::string & key, size_t h) const
+	{
+		if (!capacity) {
+			return capacity;
+		}
+		const size_t group_mask = capacity / group_size - 1;
+		const int8_t h2 = get_h2(h);
+		size_t group = get_h1(h) & group_mask;
+		for (size_t step = 1; ; ++step) {
+			const size_t base = group * group_size;
+			group_type g(controls + base);
+			for (uint32_t bits = g.match(h2); bits; bits &= bits - 1) {
+				const size_t position = base + lowest_bit(bits);
+				if (slots[position].key == key) {
+					return position;
+				}
+			}
+			if (g.match_empty(empty_control)) {
+				return capacity;
+			}
+			group = (group + step) & group_mask;
+		}
+	}
+	///空きか削除済みの最初の位置
+	size_t dictionary_type::table_type::find_insert_position(size_t h) const
+	{
+		const size_t group_mask = capacity / group_size - 1;
+		size_t group = get_h1(h) & group_mask;
+		for (size_t step = 1; ; ++step) {
+			const size_t base = group * group_size;
+			uint32_t bits = group_type(controls + base).match_free();
+			if (bits) {
+				return base + lowest_bit(bits);
+			}
+			group = (group + step) & group_mask;
+		}
+	}
+	///空きがある前提で要素を置く
+	dictionary_type::entry_type * dictionary_type::table_type::emplace(size_t h, entry_type && entry)
+	{
+		const size_t position = find_insert_position(h);
+		if (controls[position] == empty_control) {
+			--growth_left;
+		}
+		controls[position] = get_h2(h);
+		++count;
+		return new (slots + position) entry_type(std::move(entry));
+	}
+	///@note 空きのあるグループは探索がそこで止まるので、削除済みにせず空きに戻せる
+	void dictionary_type::table_type::erase(size_t position)
+	{
+		const size_t base = position - position % group_size;
+		slots[position].~entry_type();
+		--count;
+		if (group_type(controls + base).match_empty(empty_control)) {
+			controls[position] = empty_control;
+			++growth_left;
+		} else {
+			controls[position] = deleted_control;
+		}
+	}
+	///移した要素を取り除く
+	///@note 残りの要素の探索を続けられるように、常に削除済みにする
+	void dictionary_type::table_type::discard(size_t position)
+	{
+		slots[position].~entry_type();
+		--count;
+		controls[position] = deleted_control;
+	}
+	///最初のグループがhomeのキーを列挙する
+	///@note 空きのあるグループで探索が止まるので、そこまでにhomeから溢れたキーがすべてある
+	void dictionary_type::table_type::scan_group(size_t home, const std::function<void(const entry_type &)> & callback) const
+	{
+		const size_t group_mask = capacity / group_size - 1;
+		size_t group = home;
+		for (size_t step = 1; ; ++step) {
+			const size_t base = group * group_size;
+			for (size_t position = base; position < base + group_size; ++position) {
+				if (0 <= controls[position] && (get_h1(hash(slots[position].key)) & group_mask) == home) {
+					callback(slots[position]);
+				}
+			}
+			if (group_type(controls + base).match_empty(empty_control)) {
+				break;
+			}
+			group = (group + step) & group_mask;
+		}
+	}
+	dictionary_type::dictionary_type()
+		: rehash_position(0)
+		, rehash_released(0)
+		, key_memory(0)
+		, accounted(0)
+	{
+	}
+	dictionary_type::~dictionary_type()
+	{
+		clear();
+		used_memory -= accounted;
+	}
+	///前回からの表とキーの大きさの差をused_memoryに反映する
+	void dictionary_type::account()
+	{
+		const size_t now = get_memory_usage();
+		used_memory += static_cast<int64_t>(now) - static_cast<int64_t>(accounted);
+		accounted = now;
+	}
+	uint64_t dictionary_type::get_time_ns()
+	{
+		timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+	}
+	void dictionary_type::update_max_step(uint64_t ns)
+	{
+		uint64_t current = rehash_max_step_ns;
+		while (current < ns && !rehash_max_step_ns.compare_exchange_weak(current, ns)) {
+		}
+	}
+	dictionary_type::entry_type * dictionary_type::find(const std::string & key)
+	{
+		const size_t h = hash(key);
+		size_t position = table.find_position(key, h);
+		if (position < table.capacity) {
+			return table.slots + position;
+		}
+		position = rehashing.find_position(key, h);
+		return position < rehashing.capacity ? rehashing.slots + position : NULL;
+	}
+	const dictionary_type::entry_type * dictionary_type::find(const std::string & key) const
+	{
+		return const_cast<dictionary_type *>(this)->find(key);
+	}
+	///キーの要素を返す、無ければ値の無い要素を追加する
+	///@return 要素と、追加したかどうか
+	///@note 追加すると、他の要素のポインタは無効になる
+	std::pair<dictionary_type::entry_type *, bool> dictionary_type::insert(const std::string & key)
+	{
+		rehash_step();
+		const size_t h = hash(key);
+		size_t position = table.find_position(key, h);
+		if (position < table.capacity) {
+			return std::make_pair(table.slots + position, false);
+		}
+		position = rehashing.find_position(key, h);
+		if (position < rehashing.capacity) {
+			return std::make_pair(rehashing.slots + position, false);
+		}
+		if (!table.growth_left) {
+			if (is_rehashing()) {//移行が追いつかない場合は、ここで終える
+				rehash_groups(rehashing.capacity / group_size);
+			}
+			//削除済みが多ければ同じ大きさで作り直す
+			start_rehash(table.capacity && table.count < get_max_count(table.capacity) / 2 ? table.capacity : std::max(table.capacity * 2, group_size));
+		}
+		entry_type * entry = table.emplace(h, entry_type(key));
+		key_memory += type_interface::get_string_memory(key.size());
+		account();
+		return std::make_pair(entry, true);
+	}
+	bool dictionary_type::erase(const std::string & key)
+	{
+		entry_type * entry = find(key);
+		if (!entry) {
+			return false;
+		}
+		erase(entry);
+		return true;
+	}
+	void dictionary_type::erase(entry_type * entry)
+	{
+		if (entry->expire_handle) {
+			expires.erase(entry->expire_handle);
+		}
+		key_memory -= type_interface::get_string_memory(entry->key.size());
+		if (table.contains(entry)) {
+			table.erase(entry - table.slots);
+		} else {
+			rehashing.discard(entry - rehashing.slots);
+		}
+		rehash_step();
+		shrink();
+		account();
+	}
+	///使用率が下がった表を1/4の大きさに移す
+	///@note 移行中は移行を先に終えるまで待つ
+	void dictionary_type::shrink()
+	{
+		if (is_rehashing() || table.capacity < min_shrink_capacity || table.capacity / 16 <= table.count) {
+			return;
+		}
+		start_rehash(table.capacity / 4);
+	}
+	void dictionary_type::clear()
+	{
+		if (is_rehashing()) {
+			finish_rehash();
+		}
+		table.release();
+		expires.clear();
+		key_memory = 0;
+		account();
+	}
+	void dictionary_type::reserve(size_t size)
+	{
+		size_t new_capacity = group_size;
+		while (get_max_count(new_capacity) < size) {
+			new_capacity *= 2;
+		}
+		if (table.capacity < new_capacity) {
+			if (is_rehashing()) {
+				rehash_groups(rehashing.capacity / group_size);
+			}
+			start_rehash(new_capacity);
+			rehash_groups(rehashing.capacity / group_size);
+			account();
+		}
+	}
+	///新しい表を作り、今の表を移行中にする
+	void dictionary_type::start_rehash(size_t new_capacity)
+	{
+		rehashing = table;
+		table.allocate(new_capacity);
+		rehash_position = 0;
+		rehash_released = 0;
+		if (!rehashing.count) {
+			rehashing.release();
+			return;
+		}
+		++rehash_started;
+		++rehash_active;
+		rehash_total_slots += rehashing.capacity;
+		rehash_pending_slots += rehashing.capacity;
+	}
+	///古い表を解放する
+	void dictionary_type::finish_rehash()
+	{
+		if (!rehashing.controls) {
+			return;
+		}
+		--rehash_active;
+		rehash_total_slots -= rehashing.capacity;
+		rehash_pending_slots -= rehashing.capacity - rehash_position;
+		rehashing.release();
+		rehash_position = 0;
+		rehash_released = 0;
+	}
+	///古い表のgroups個のグループを新しい表に移す
+	void dictionary_type::rehash_groups(size_t groups)
+	{
+		if (!is_rehashing()) {
+			return;
+		}
+		const size_t end = std::min(rehashing.capacity, rehash_position + groups * group_size);
+		for (size_t position = rehash_position; position < end; ++position) {
+			if (rehashing.controls[position] < 0) {
+				continue;
+			}
+			entry_type & entry = rehashing.slots[position];
+			entry_type * moved = table.emplace(hash(entry.key), std::move(entry));
+			if (moved->expire_handle) {
+				expires.move(moved->expire_handle, moved);
+			}
+			rehashing.discard(position);
+		}
+		rehash_pending_slots -= end - rehash_position;
+		rehash_position = end;
+		if (rehash_position == rehashing.capacity || !rehashing.count) {
+			finish_rehash();
+		} else {
+			release_migrated();
+		}
+	}
+	///移し終えた要素の領域をページ単位でOSに返す
+	///@note 大きな表を最後にまとめて解放すると、その操作だけが長くなるため
+	void dictionary_type::release_migrated()
+	{
+		static const size_t min_release = 1024 * 1024;
+		static const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+		const uintptr_t base = reinterpret_cast<uintptr_t>(rehashing.slots);
+		const uintptr_t begin = (base + rehash_released + page_size - 1) & ~(page_size - 1);
+		const uintptr_t end = (base + rehash_position * sizeof(entry_type)) & ~(page_size - 1);
+		if (end < begin + min_release) {
+			return;
+		}
+		madvise(reinterpret_cast<void *>(begin), end - begin, MADV_DONTNEED);
+		rehash_released = end - base;
+	}
+	expire_info dictionary_type::get_expire(const entry_type & entry) const
+	{
+		expire_info result;
+		const int64_t expire_ms = get_expire_ms(entry);
+		if (expire_ms) {
+			result.expire(timeval_type(expire_ms / 1000, (expire_ms % 1000) * 1000));
+		}
+		return result;
+	}
+	///期限を付け替える、既にあれば同じ番号のまま置き直す
+	void dictionary_type::set_expire(entry_type & entry, const expire_info & expire)
+	{
+		if (!expire.is_expiring()) {
+			persist(entry);
+			return;
+		}
+		const int64_t expire_ms = std::max<int64_t>(1, expire.at().get_ms());
+		if (entry.expire_handle) {
+			expires.update(entry.expire_handle, expire_ms);
+		} else {
+			entry.expire_handle = expires.insert(&entry, expire_ms);
+			account();
+		}
+	}
+	void dictionary_type::persist(entry_type & entry)
+	{
+		if (entry.expire_handle) {
+			expires.erase(entry.expire_handle);
+			entry.expire_handle = 0;
+		}
+	}
+	///@note 要素の領域は動かないので、期限の番号はそのまま使える
+	void dictionary_type::swap(dictionary_type & rhs)
+	{
+		std::swap(table, rhs.table);
+		std::swap(rehashing, rhs.rehashing);
+		std::swap(rehash_position, rhs.rehash_position);
+		std::swap(rehash_released, rhs.rehash_released);
+		expires.swap(rhs.expires);
+		std::swap(key_memory, rhs.key_memory);
+		account();
+		rhs.account();
+	}
+	///カーソルの位置の最初のグループを持つキーを列挙し、次のカーソルを返す
+	///@note カーソルはグループ番号を逆順のビットで進めるので、間で表の大きさが変わっても、その間ずっとあるキーは一度以上列挙する
+	///@note 移行中は小さい表のグループと、それに対応する大きい表のグループをすべて見る
+	///@return 次のカーソル、0なら終わり
+	uint64_t dictionary_type::scan(uint64_t cursor, const std::function<void(const entry_type &)> & callback) const
+	{
+		if (!table.capacity) {
+			return 0;
+		}
+		if (!is_rehashing()) {
+			const uint64_t mask = table.capacity / group_size - 1;
+			table.scan_group(cursor & mask, callback);
+			return next_cursor(cursor, mask);
+		}
+		const table_type * small = &table;
+		const table_type * large = &rehashing;
+		if (large->capacity < small->capacity) {
+			std::swap(small, large);
+		}
+		const uint64_t small_mask = small->capacity / group_size - 1;
+		const uint64_t large_mask = large->capacity / group_size - 1;
+		small->scan_group(cursor & small_mask, callback);
+		//大きい表の上位のビットも逆順のビットで進め、カーソルの上位のビットから桁上がりするまで見る
+		uint64_t position = cursor;
+		do {
+			large->scan_group(position & large_mask, callback);
+			position = next_cursor(position, large_mask);
+			position = (position & ~small_mask) | (cursor & small_mask);
+		} while (position & (small_mask ^ large_mask));
+		return next_cursor(cursor, small_mask);
+	}
+	///tableの後にrehashingが続く位置の要素、無ければNULL
+	const dictionary_type::entry_type * dictionary_type::get_entry(size_t position) const
+	{
+		if (position < table.capacity) {
+			return 0 <= table.controls[position] ? table.slots + position : NULL;
+		}
+		position -= table.capacity;
+		return 0 <= rehashing.controls[position] ? rehashing.slots + position : NULL;
+	}
+	///無作為な要素を一つ選ぶ
+	///@note 両方の表の位置から一様に選び、空なら選び直すので、要素は一様に選ばれる
+	///@note 使用率は縮める前でも1/16以上あるので、普通は数回で当たる
+	///@note 当たらない場合は、最後の位置から次の要素を探す
+	///@return 空ならNULL
+	const dictionary_type::entry_type * dictionary_type::sample(uint64_t seed) const
+	{
+		if (empty()) {
+			return NULL;
+		}
+		const size_t total = table.capacity + rehashing.capacity;
+		size_t position = 0;
+		for (size_t tries = 0; tries < sample_max_tries; ++tries) {
+			//splitmix64
+			seed += 0x9E3779B97F4A7C15ULL;
+			uint64_t z = seed;
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+			position = (z ^ (z >> 31)) % total;
+			const entry_type * entry = get_entry(position);
+			if (entry) {
+				return entry;
+			}
+		}
+		for (size_t i = 1; i < total; ++i) {
+			const entry_type * entry = get_entry((position + i) % total);
+			if (entry) {
+				return entry;
+			}
+		}
+		return NULL;
+	}
+	///追加と削除の度の移行
+	void dictionary_type::rehash_step()
+	{
+		if (!is_rehashing()) {
+			return;
+		}
+		const uint64_t start = get_time_ns();
+		rehash_groups(table.capacity < rehashing.capacity ? shrink_step_groups : rehash_step_groups);
+		update_max_step(get_time_ns() - start);
+	}
+	///budget_nsの間だけ移行を進める
+	///@return まだ移行中ならtrue
+	bool dictionary_type::rehash(uint64_t budget_ns)
+	{
+		if (!is_rehashing()) {
+			return false;
+		}
+		const uint64_t start = get_time_ns();
+		uint64_t elapsed = 0;
+		do {
+			rehash_groups(64);
+			elapsed = get_time_ns() - start;
+		} while (is_rehashing() && elapsed < budget_ns);
+		update_max_step(elapsed);
+		account();
+		return is_rehashing();
+	}
+};
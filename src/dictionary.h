@@ -0,0 +1,168 @@
+#ifndef INCLUDE_REDIS_CPP_DICTIONARY_H
+#define INCLUDE_REDIS_CPP_DICTIONARY_H
+
+#include "common.h"
+#include "timeval.h"
+#include "expire_info.h"
+#include "expire_wheel.h"
+
+namespace rediscpp
+{
+	class type_interface;
+	///辞書の要素
+	///@note 有効期限は辞書のタイミングホイールにあり、要素はその番号だけを持つ
+	struct dictionary_entry_type
+	{
+		std::string key;
+		std::shared_ptr<type_interface> value;
+		expire_wheel_type::handle_type expire_handle;///<有効期限の番号、0なら有効期限無し
+		mutable std::atomic<bool> reclaiming;///<読み込み中に期限切れを見つけて、回収待ちに積んだ
+		dictionary_entry_type(const std::string & key_)
+			: key(key_)
+			, expire_handle(0)
+			, reclaiming(false)
+		{
+		}
+		dictionary_entry_type(dictionary_entry_type && rhs)
+			: key(std::move(rhs.key))
+			, value(std::move(rhs.value))
+			, expire_handle(rhs.expire_handle)
+			, reclaiming(rhs.reclaiming.load(std::memory_order_relaxed))
+		{
+		}
+		bool is_expiring() const { return expire_handle != 0; }
+	};
+	///開番地法のキーの辞書
+	///@note 制御バイトを16個ずつのグループで探し、SSE2があれば一度に比較する
+	///@note 制御バイトは空き、削除済み、ハッシュの下位7ビットのどれか
+	///@note 大きさを変える時は新しい表を作り、追加と削除の度と、rehashの呼び出しで古い表から少しずつ移す
+	///@note 要素を移す時は、有効期限の番号の指す先を付け替える
+	///@note 使用率が1/16を下回ると1/4の大きさに縮めるので、無作為な位置の要素は数回で引ける
+	class dictionary_type
+	{
+	public:
+		typedef dictionary_entry_type entry_type;
+		static const size_t group_size = 16;
+		static const size_t rehash_step_groups = 1;///<追加と削除の度に移すグループ数
+		static const size_t shrink_step_groups = 4;///<縮める時に追加と削除の度に移すグループ数、削除が続いても次に縮めるまでに移し終える
+		static const size_t min_shrink_capacity = 128;///<これより小さい表は縮めない
+		static const size_t sample_max_tries = 64;///<無作為な位置が空だった時に引き直す回数、超えたら次の要素を探す
+	private:
+		///一つの表
+		struct table_type
+		{
+			int8_t * controls;///<capacity個の制御バイト
+			entry_type * slots;///<capacity個の要素、使用中の位置だけ構築済み
+			size_t capacity;
+			size_t count;
+			size_t growth_left;///<再構築までに使える空き
+			table_type();
+			void allocate(size_t capacity_);
+			void release();
+			size_t find_position(const std::string & key, size_t h) const;
+			size_t find_insert_position(size_t h) const;
+			entry_type * emplace(size_t h, entry_type && entry);
+			void erase(size_t position);
+			void discard(size_t position);
+			void scan_group(size_t home, const std::function<void(const entry_type &)> & callback) const;
+			bool contains(const entry_type * entry) const { return slots <= entry && entry < slots + capacity; }
+		};
+		table_type table;///<追加する表
+		table_type rehashing;///<移行中の古い表、移行中でなければ空
+		size_t rehash_position;///<rehashingの次に移す位置
+		size_t rehash_released;///<rehashingの要素の領域のうち、OSに返したバイト数
+		expire_wheel_type expires;
+		size_t key_memory;///<キーの文字列が確保した大きさの合計
+		size_t accounted;///<used_memoryに加えた大きさ
+		static const int8_t empty_control = -128;
+		static const int8_t deleted_control = -2;
+		dictionary_type(const dictionary_type &);
+		dictionary_type & operator=(const dictionary_type &);
+		static size_t hash(const std::string & key) { return std::hash<std::string>()(key); }
+		static size_t get_max_count(size_t capacity) { return capacity - capacity / 8; }
+		void start_rehash(size_t new_capacity);
+		void finish_rehash();
+		void rehash_groups(size_t groups);
+		void release_migrated();
+		void rehash_step();
+		void shrink();
+		const entry_type * get_entry(size_t position) const;
+		void account();
+		static void update_max_step(uint64_t ns);
+	public:
+		static std::atomic<int64_t> used_memory;///<すべての辞書の表とキーの大きさの合計
+		static std::atomic<uint64_t> rehash_started;///<開始した移行の数
+		static std::atomic<uint64_t> rehash_active;///<移行中の表の数
+		static std::atomic<uint64_t> rehash_total_slots;///<移行中の古い表の大きさの合計
+		static std::atomic<uint64_t> rehash_pending_slots;///<まだ移していない位置の合計
+		static std::atomic<uint64_t> rehash_max_step_ns;///<一度の移行でロックを保持した最大時間
+		class const_iterator
+		{
+			const dictionary_type * dictionary;
+			size_t position;///<tableの後にrehashingが続く位置
+			const int8_t * get_control() const
+			{
+				const size_t capacity = dictionary->table.capacity;
+				return position < capacity ? dictionary->table.controls + position : dictionary->rehashing.controls + (position - capacity);
+			}
+			void skip()
+			{
+				const size_t end = dictionary->table.capacity + dictionary->rehashing.capacity;
+				while (position < end && *get_control() < 0) {
+					++position;
+				}
+			}
+		public:
+			typedef std::forward_iterator_tag iterator_category;
+			typedef const entry_type value_type;
+			typedef ptrdiff_t difference_type;
+			typedef const entry_type * pointer;
+			typedef const entry_type & reference;
+			const_iterator() : dictionary(NULL), position(0) {}
+			const_iterator(const dictionary_type * dictionary_, size_t position_) : dictionary(dictionary_), position(position_) { skip(); }
+			const entry_type & operator*() const { return *operator->(); }
+			const entry_type * operator->() const
+			{
+				const size_t capacity = dictionary->table.capacity;
+				return position < capacity ? dictionary->table.slots + position : dictionary->rehashing.slots + (position - capacity);
+			}
+			const_iterator & operator++() { ++position; skip(); return *this; }
+			const_iterator operator++(int) { const_iterator result = *this; ++*this; return result; }
+			bool operator==(const const_iterator & rhs) const { return position == rhs.position; }
+			bool operator!=(const const_iterator & rhs) const { return position != rhs.position; }
+		};
+		dictionary_type();
+		~dictionary_type();
+		size_t size() const { return table.count + rehashing.count; }
+		bool empty() const { return size() == 0; }
+		size_t get_capacity() const { return table.capacity; }
+		size_t get_memory_usage() const { return (table.capacity + rehashing.capacity) * (sizeof(int8_t) + sizeof(entry_type)) + expires.get_memory_usage() + key_memory; }
+		bool is_rehashing() const { return rehashing.capacity != 0; }
+		const_iterator begin() const { return const_iterator(this, 0); }
+		const_iterator end() const { return const_iterator(this, table.capacity + rehashing.capacity); }
+		entry_type * find(const std::string & key);
+		const entry_type * find(const std::string & key) const;
+		std::pair<entry_type *, bool> insert(const std::string & key);
+		bool erase(const std::string & key);
+		void erase(entry_type * entry);
+		void clear();
+		void reserve(size_t size);
+		int64_t get_expire_ms(const entry_type & entry) const { return entry.expire_handle ? expires.get_expire_ms(entry.expire_handle) : 0; }
+		bool is_expired(const entry_type & entry, const timeval_type & current) const { return entry.expire_handle && expires.get_expire_ms(entry.expire_handle) <= static_cast<int64_t>(current.get_ms()); }
+		expire_info get_expire(const entry_type & entry) const;
+		void set_expire(entry_type & entry, const expire_info & expire);
+		void persist(entry_type & entry);
+		size_t get_expiring_count() const { return expires.size(); }
+		entry_type * front_expired(const timeval_type & current) { return expires.front(current.get_ms()); }
+		entry_type * soonest_expiring(size_t max_scan) { return expires.soonest(max_scan); }
+		entry_type * sample_expiring(uint64_t random) { return expires.sample(random); }
+		void swap(dictionary_type & rhs);
+		uint64_t scan(uint64_t cursor, const std::function<void(const entry_type &)> & callback) const;
+		const entry_type * sample(uint64_t seed) const;
+		entry_type * sample(uint64_t seed) { return const_cast<entry_type *>(static_cast<const dictionary_type *>(this)->sample(seed)); }
+		bool rehash(uint64_t budget_ns);
+		static uint64_t get_time_ns();
+	};
+};
+
+#endif
@@ -40,7 +40,7 @@ namespace rediscpp
 		void persist();
 		bool is_expiring() const;
 		timeval_type ttl(const timeval_type & current) const;
-		timeval_type at() const { expire_time; }
+		timeval_type at() const { return expire_time; }
 	};
 };
 
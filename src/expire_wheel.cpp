@@ -0,0 +1,266 @@
+#include "expire_wheel.h"
+
+namespace rediscpp
+{
+	namespace
+	{
+		inline uint64_t get_bit(size_t slot) { return static_cast<uint64_t>(1) << slot; }
+	}
+	expire_wheel_type::expire_wheel_type()
+		: allocated(0)
+		, free_list(0)
+		, count(0)
+		, current(0)
+	{
+		memset(occupied, 0, sizeof(occupied));
+	}
+	///番号を一つ確保する
+	///@note 最初の確保で、各リストの先頭を自分を指す空のリストにする
+	expire_wheel_type::handle_type expire_wheel_type::allocate()
+	{
+		if (free_list) {
+			handle_type handle = free_list;
+			free_list = get(handle).next;
+			return handle;
+		}
+		if (!allocated) {
+			blocks.push_back(std::unique_ptr<record_type[]>(new record_type[block_size]));
+			for (handle_type list = due_list; list < reserved_count; ++list) {
+				record_type & head = get(list);
+				head.entry = NULL;
+				head.expire_ms = 0;
+				head.prev = head.next = list;
+			}
+			allocated = reserved_count;
+		}
+		if (!(allocated & (block_size - 1))) {
+			blocks.push_back(std::unique_ptr<record_type[]>(new record_type[block_size]));
+		}
+		return allocated++;
+	}
+	///リストの末尾に繋ぐ
+	void expire_wheel_type::link(handle_type list, handle_type handle)
+	{
+		record_type & head = get(list);
+		record_type & record = get(handle);
+		record.prev = head.prev;
+		record.next = list;
+		get(head.prev).next = handle;
+		head.prev = handle;
+	}
+	///@note 循環リストなので、どのリストにあるかを知らなくても外せる
+	void expire_wheel_type::unlink(handle_type handle)
+	{
+		record_type & record = get(handle);
+		get(record.prev).next = record.next;
+		get(record.next).prev = record.prev;
+	}
+	///fromの要素をすべてtoの末尾に移す
+	void expire_wheel_type::splice(handle_type from, handle_type to)
+	{
+		record_type & source = get(from);
+		if (source.next == from) {
+			return;
+		}
+		record_type & target = get(to);
+		get(source.next).prev = target.prev;
+		get(target.prev).next = source.next;
+		get(source.prev).next = to;
+		target.prev = source.prev;
+		source.prev = source.next = from;
+	}
+	///期限と現在時刻が最初に異なる段の枠に置く
+	void expire_wheel_type::place(handle_type handle)
+	{
+		const int64_t expire_ms = get(handle).expire_ms;
+		if (expire_ms < current) {
+			link(due_list, handle);
+			return;
+		}
+		const uint64_t diff = static_cast<uint64_t>(expire_ms ^ current);
+		size_t level = diff ? (63 - __builtin_clzll(diff)) / slot_bits : 0;
+		size_t slot;
+		if (level < level_count) {
+			slot = (expire_ms >> (level * slot_bits)) & (slot_count - 1);
+		} else {
+			//表せないほど先の期限は最上段の最後の枠に置き、その枠を下ろす時に置き直す
+			level = level_count - 1;
+			slot = slot_count - 1;
+		}
+		link(get_slot_list(level, slot), handle);
+		occupied[level] |= get_bit(slot);
+	}
+	///枠の要素を現在時刻に合わせて置き直す
+	void expire_wheel_type::cascade(handle_type list)
+	{
+		record_type & head = get(list);
+		handle_type handle = head.next;
+		head.prev = head.next = list;
+		while (handle != list) {
+			handle_type next = get(handle).next;
+			place(handle);
+			handle = next;
+		}
+	}
+	///現在時刻より後で、要素がある最初の枠の開始時刻
+	///@note 上の段の枠は下の段の残りの枠より後なので、要素のある最も下の段で決まる
+	int64_t expire_wheel_type::get_next_time() const
+	{
+		for (size_t level = 0; level < level_count; ++level) {
+			const size_t shift = level * slot_bits;
+			const size_t index = (current >> shift) & (slot_count - 1);
+			const uint64_t later = index == slot_count - 1 ? 0 : occupied[level] & (~static_cast<uint64_t>(0) << (index + 1));
+			if (later) {
+				const size_t upper = shift + slot_bits;
+				return ((current >> upper) << upper) | (static_cast<int64_t>(__builtin_ctzll(later)) << shift);
+			}
+		}
+		return std::numeric_limits<int64_t>::max();
+	}
+	///現在時刻をtargetまで進め、targetを含む枠を下の段に下ろす
+	///@note targetは次に要素がある枠の開始時刻以前なので、途中の枠は空で、下ろす枠は上の段から順に一つずつになる
+	void expire_wheel_type::jump(int64_t target)
+	{
+		const int64_t previous = current;
+		current = target;
+		for (size_t level = level_count - 1; 0 < level; --level) {
+			const size_t shift = level * slot_bits;
+			if ((previous >> shift) == (target >> shift)) {
+				continue;
+			}
+			const size_t slot = (target >> shift) & (slot_count - 1);
+			if (occupied[level] & get_bit(slot)) {
+				occupied[level] &= ~get_bit(slot);
+				cascade(get_slot_list(level, slot));
+			}
+		}
+	}
+	///now以前に切れる要素をすべて期限切れのリストに移す
+	void expire_wheel_type::advance(int64_t now)
+	{
+		while (current <= now) {
+			const size_t slot = current & (slot_count - 1);
+			if (occupied[0] & get_bit(slot)) {
+				occupied[0] &= ~get_bit(slot);
+				splice(get_slot_list(0, slot), due_list);
+			}
+			jump(count ? std::min(now + 1, get_next_time()) : now + 1);
+		}
+	}
+	expire_wheel_type::handle_type expire_wheel_type::insert(dictionary_entry_type * entry, int64_t expire_ms)
+	{
+		handle_type handle = allocate();
+		record_type & record = get(handle);
+		record.entry = entry;
+		record.expire_ms = expire_ms;
+		place(handle);
+		++count;
+		return handle;
+	}
+	void expire_wheel_type::update(handle_type handle, int64_t expire_ms)
+	{
+		unlink(handle);
+		get(handle).expire_ms = expire_ms;
+		place(handle);
+	}
+	void expire_wheel_type::erase(handle_type handle)
+	{
+		unlink(handle);
+		record_type & record = get(handle);
+		record.entry = NULL;
+		record.next = free_list;
+		free_list = handle;
+		--count;
+	}
+	///now以前に切れた要素の一つ、無ければNULL
+	///@note 返した要素はeraseするまで残る
+	dictionary_entry_type * expire_wheel_type::front(int64_t now)
+	{
+		if (!count) {
+			return NULL;
+		}
+		advance(now);
+		const record_type & head = get(due_list);
+		return head.next == due_list ? NULL : get(head.next).entry;
+	}
+	///最も早く切れる枠から、最大max_scan個を見て最も期限の早い要素、無ければNULL
+	///@note 1段目は処理中の枠から、上の段は現在時刻の枠の次からで、要素のある最も下の段の最初の枠が最も早い
+	///@note 空だった枠のビットはここで落とす
+	dictionary_entry_type * expire_wheel_type::soonest(size_t max_scan)
+	{
+		if (!count) {
+			return NULL;
+		}
+		const record_type & due = get(due_list);
+		if (due.next != due_list) {
+			return get(due.next).entry;
+		}
+		for (size_t level = 0; level < level_count; ++level) {
+			const size_t index = (current >> (level * slot_bits)) & (slot_count - 1);
+			const size_t first = level ? index + 1 : index;
+			if (slot_count <= first) {
+				continue;
+			}
+			uint64_t later = occupied[level] & (~static_cast<uint64_t>(0) << first);
+			while (later) {
+				const size_t slot = __builtin_ctzll(later);
+				later &= later - 1;
+				const handle_type list = get_slot_list(level, slot);
+				handle_type handle = get(list).next;
+				if (handle == list) {
+					occupied[level] &= ~get_bit(slot);
+					continue;
+				}
+				const record_type * result = &get(handle);
+				for (size_t scanned = 1; scanned < max_scan && (handle = get(handle).next) != list; ++scanned) {
+					const record_type & record = get(handle);
+					if (record.expire_ms < result->expire_ms) {
+						result = &record;
+					}
+				}
+				return result->entry;
+			}
+		}
+		return NULL;
+	}
+	///無作為な番号から順に探した、最初の使用中の要素、無ければNULL
+	///@note 空いた番号は再利用するので、使用中の番号は密になる
+	dictionary_entry_type * expire_wheel_type::sample(uint64_t random) const
+	{
+		if (!count) {
+			return NULL;
+		}
+		const handle_type range = allocated - reserved_count;
+		handle_type handle = static_cast<handle_type>(reserved_count + random % range);
+		for (handle_type i = 0; i < range; ++i) {
+			const record_type & record = get(handle);
+			if (record.entry) {
+				return record.entry;
+			}
+			if (++handle == allocated) {
+				handle = reserved_count;
+			}
+		}
+		return NULL;
+	}
+	void expire_wheel_type::clear()
+	{
+		blocks.clear();
+		allocated = 0;
+		free_list = 0;
+		count = 0;
+		memset(occupied, 0, sizeof(occupied));
+	}
+	///@note 要素の領域は動かないので、辞書の要素を指したまま入れ替えられる
+	void expire_wheel_type::swap(expire_wheel_type & rhs)
+	{
+		blocks.swap(rhs.blocks);
+		std::swap(allocated, rhs.allocated);
+		std::swap(free_list, rhs.free_list);
+		std::swap(count, rhs.count);
+		std::swap(current, rhs.current);
+		for (size_t level = 0; level < level_count; ++level) {
+			std::swap(occupied[level], rhs.occupied[level]);
+		}
+	}
+};
@@ -0,0 +1,71 @@
+#ifndef INCLUDE_REDIS_CPP_EXPIRE_WHEEL_H
+#define INCLUDE_REDIS_CPP_EXPIRE_WHEEL_H
+
+#include "common.h"
+
+namespace rediscpp
+{
+	struct dictionary_entry_type;
+	///有効期限の階層タイミングホイール
+	///@note 要素は番号で参照し、辞書の要素はその番号だけを持つので、期限の変更は付け替えるだけで重複しない
+	///@note 各段は64個の枠を持ち、段が上がる毎に枠の幅が64倍になる、1段目の枠の幅は1ms
+	///@note 要素は現在時刻と最初に異なる段の枠に置き、その枠の時刻になったら下の段に移す
+	class expire_wheel_type
+	{
+	public:
+		typedef uint32_t handle_type;
+		static const size_t slot_bits = 6;
+		static const size_t slot_count = 1 << slot_bits;
+		static const size_t level_count = 8;///<48ビット分のmsを表す
+	private:
+		///要素と、各リストの先頭を兼ねる
+		struct record_type
+		{
+			dictionary_entry_type * entry;
+			int64_t expire_ms;
+			handle_type prev;///<循環リストの前後
+			handle_type next;
+		};
+		static const size_t block_bits = 10;
+		static const size_t block_size = 1 << block_bits;
+		static const handle_type due_list = 1;///<期限の過ぎた要素のリストの先頭の番号、0は無効な番号
+		static const handle_type first_slot_list = 2;///<段と枠毎のリストの先頭の番号
+		static const handle_type reserved_count = first_slot_list + slot_count * level_count;
+		std::vector<std::unique_ptr<record_type[]>> blocks;///<番号の領域、要素を移動しないようにblock_size個ずつ確保する
+		handle_type allocated;///<使用した番号の数
+		handle_type free_list;///<再利用する番号の単方向リスト、nextで繋ぐ
+		size_t count;
+		int64_t current;///<処理済みの時刻の次、置いてある要素はすべてこれ以降に切れる
+		uint64_t occupied[level_count];///<要素があるかもしれない枠のビット
+		expire_wheel_type(const expire_wheel_type &);
+		expire_wheel_type & operator=(const expire_wheel_type &);
+		record_type & get(handle_type handle) { return blocks[handle >> block_bits][handle & (block_size - 1)]; }
+		const record_type & get(handle_type handle) const { return blocks[handle >> block_bits][handle & (block_size - 1)]; }
+		static handle_type get_slot_list(size_t level, size_t slot) { return static_cast<handle_type>(first_slot_list + level * slot_count + slot); }
+		handle_type allocate();
+		void link(handle_type list, handle_type handle);
+		void unlink(handle_type handle);
+		void splice(handle_type from, handle_type to);
+		void place(handle_type handle);
+		void cascade(handle_type list);
+		int64_t get_next_time() const;
+		void jump(int64_t target);
+		void advance(int64_t now);
+	public:
+		expire_wheel_type();
+		size_t size() const { return count; }
+		size_t get_memory_usage() const { return blocks.size() * block_size * sizeof(record_type); }
+		handle_type insert(dictionary_entry_type * entry, int64_t expire_ms);
+		void update(handle_type handle, int64_t expire_ms);
+		void erase(handle_type handle);
+		void move(handle_type handle, dictionary_entry_type * entry) { get(handle).entry = entry; }
+		int64_t get_expire_ms(handle_type handle) const { return get(handle).expire_ms; }
+		dictionary_entry_type * front(int64_t now);
+		dictionary_entry_type * soonest(size_t max_scan);
+		dictionary_entry_type * sample(uint64_t random) const;
+		void clear();
+		void swap(expire_wheel_type & rhs);
+	};
+};
+
+#endif
@@ -0,0 +1,252 @@
+#include "glob_pattern.h"
+
+namespace rediscpp
+{
+	namespace
+	{
+		///pattern_matchの[]と同じ判定をする
+		///@param[in,out] pbegin '['の次から、終わりの']'の次まで進める
+		///@param[in] c nocaseなら大文字にした文字
+		bool match_class(const char *& pbegin, const char * pend, char c, bool nocase)
+		{
+			bool bend = false;
+			bool match = false;
+			bool should_not_match = false;
+			if (pbegin < pend && *pbegin == '^') {
+				should_not_match = true;
+				++pbegin;
+			}
+			const char * bfirst = pbegin;
+			for (; pbegin < pend && !bend; ++pbegin)
+			{
+				switch (*pbegin)
+				{
+				case ']':
+					bend = true;
+					break;
+				case '\\':
+					++pbegin;
+					if (pbegin == pend) {
+						return false;
+					}
+					if ((nocase ? toupper(*pbegin) : *pbegin) == c) {
+						match = true;
+					}
+					break;
+				case '-':
+					if (bfirst == pbegin || pbegin + 1 == pend || pbegin[1] == ']') {
+						if ('-' == c) {
+							match = true;
+						}
+					} else {
+						char start = pbegin[-1];
+						char end = pbegin[1];
+						if (nocase) {
+							start = toupper(start);
+							end = toupper(end);
+						}
+						if (end < start) std::swap(start, end);
+						if (start <= c && c <= end) {
+							match = true;
+						}
+					}
+					break;
+				default:
+					if ((nocase ? toupper(*pbegin) : *pbegin) == c) {
+						match = true;
+					}
+					break;
+				}
+			}
+			return should_not_match ? !match : match;
+		}
+	}
+	///pattern_matchがnocaseで比べる値
+	const uint8_t * glob_pattern_type::get_fold_table()
+	{
+		struct fold_table_type
+		{
+			uint8_t table[256];
+			fold_table_type()
+			{
+				for (int c = 0; c < 256; ++c) {
+					table[c] = static_cast<uint8_t>(toupper(static_cast<char>(c)));
+				}
+			}
+		};
+		static const fold_table_type fold;
+		return fold.table;
+	}
+	glob_pattern_type::glob_pattern_type(const std::string & pattern, bool nocase_)
+		: min_length(0)
+		, nocase(nocase_)
+		, all(false)
+	{
+		const uint8_t * fold = get_fold_table();
+		const char * pbegin = pattern.data();
+		const char * pend = pbegin + pattern.size();
+		segments.push_back(segment_type());
+		segments.back().begin = 0;
+		while (pbegin < pend) {
+			atom_type atom = { literal_atom, 0, 0 };
+			switch (*pbegin) {
+			case '*':
+				while (pbegin < pend && *pbegin == '*') {
+					++pbegin;
+				}
+				segments.back().end = atoms.size();
+				segments.push_back(segment_type());
+				segments.back().begin = atoms.size();
+				continue;
+			case '?':
+				atom.type = any_atom;
+				++pbegin;
+				break;
+			case '[':
+				{
+					atom.type = set_atom;
+					atom.set = static_cast<uint16_t>(sets.size());
+					const char * bbegin = pbegin + 1;
+					const char * bend = bbegin;
+					std::array<uint64_t,4> set = {{0, 0, 0, 0}};
+					for (int c = 0; c < 256; ++c) {
+						bend = bbegin;
+						if (match_class(bend, pend, static_cast<char>(nocase ? fold[c] : c), nocase)) {
+							set[c >> 6] |= static_cast<uint64_t>(1) << (c & 63);
+						}
+					}
+					sets.push_back(set);
+					pbegin = std::min(bend, pend);
+				}
+				break;
+			case '\\':
+				if (pbegin + 1 < pend) {
+					++pbegin;
+				}
+			default:
+				atom.value = nocase ? fold[static_cast<uint8_t>(*pbegin)] : static_cast<uint8_t>(*pbegin);
+				++pbegin;
+				break;
+			}
+			atoms.push_back(atom);
+		}
+		segments.back().end = atoms.size();
+		//nocaseでは、他の文字と同じ値にならない文字だけをmemchrで探せる
+		size_t folded_count[256] = {0};
+		for (int c = 0; c < 256; ++c) {
+			++folded_count[fold[c]];
+		}
+		for (auto it = segments.begin(), end = segments.end(); it != end; ++it) {
+			auto & segment = *it;
+			segment.literal = true;
+			segment.anchor = -1;
+			for (size_t i = segment.begin; i < segment.end; ++i) {
+				const atom_type & atom = atoms[i];
+				if (atom.type != literal_atom) {
+					segment.literal = false;
+					continue;
+				}
+				segment.text.push_back(static_cast<char>(atom.value));
+				if (segment.anchor < 0 && (!nocase || (folded_count[atom.value] == 1 && fold[atom.value] == atom.value))) {
+					segment.anchor = static_cast<int>(i - segment.begin);
+				}
+			}
+			if (!segment.literal) {
+				segment.text.clear();
+			}
+			min_length += segment.size();
+		}
+		all = segments.size() == 2 && atoms.empty();
+	}
+	bool glob_pattern_type::match_atom(const atom_type & atom, uint8_t c) const
+	{
+		switch (atom.type) {
+		case literal_atom:
+			return (nocase ? get_fold_table()[c] : c) == atom.value;
+		case any_atom:
+			return true;
+		default:
+			return (sets[atom.set][c >> 6] >> (c & 63)) & 1;
+		}
+	}
+	bool glob_pattern_type::match_segment(const segment_type & segment, const char * target) const
+	{
+		if (segment.literal && !nocase) {
+			return memcmp(segment.text.data(), target, segment.text.size()) == 0;
+		}
+		for (size_t i = segment.begin; i < segment.end; ++i, ++target) {
+			if (!match_atom(atoms[i], static_cast<uint8_t>(*target))) {
+				return false;
+			}
+		}
+		return true;
+	}
+	///[begin, end)の中で区間が一致する最も左の位置
+	///@return 無ければNULL
+	const char * glob_pattern_type::find_segment(const segment_type & segment, const char * begin, const char * end) const
+	{
+		const size_t size = segment.size();
+		if (end < begin + size) {
+			return NULL;
+		}
+		if (segment.literal && !nocase) {
+			if (size == 1) {
+				return static_cast<const char *>(memchr(begin, segment.text[0], end - begin));
+			}
+			//memmemは準備が重いので、短いキーでは先頭の文字をmemchrで探してから比べる
+			if (memmem_threshold <= static_cast<size_t>(end - begin)) {
+				return static_cast<const char *>(memmem(begin, end - begin, segment.text.data(), size));
+			}
+		}
+		const char * last = end - size;
+		if (0 <= segment.anchor) {
+			const size_t anchor = segment.anchor;
+			const char value = static_cast<char>(atoms[segment.begin + anchor].value);
+			for (const char * position = begin; position <= last; ++position) {
+				const char * hit = static_cast<const char *>(memchr(position + anchor, value, last - position + 1));
+				if (!hit) {
+					return NULL;
+				}
+				position = hit - anchor;
+				if (match_segment(segment, position)) {
+					return position;
+				}
+			}
+			return NULL;
+		}
+		for (const char * position = begin; position <= last; ++position) {
+			if (match_segment(segment, position)) {
+				return position;
+			}
+		}
+		return NULL;
+	}
+	bool glob_pattern_type::match(const char * target, size_t length) const
+	{
+		if (all) {
+			return true;
+		}
+		if (length < min_length) {
+			return false;
+		}
+		const segment_type & first = segments.front();
+		if (segments.size() == 1) {
+			return length == min_length && match_segment(first, target);
+		}
+		const segment_type & last = segments.back();
+		if (!match_segment(first, target) || !match_segment(last, target + length - last.size())) {
+			return false;
+		}
+		const char * position = target + first.size();
+		const char * end = target + length - last.size();
+		for (size_t i = 1, n = segments.size() - 1; i < n; ++i) {
+			const segment_type & segment = segments[i];
+			position = find_segment(segment, position, end);
+			if (!position) {
+				return false;
+			}
+			position += segment.size();
+		}
+		return true;
+	}
+};
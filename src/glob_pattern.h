@@ -0,0 +1,57 @@
+#ifndef INCLUDE_REDIS_CPP_GLOB_PATTERN_H
+#define INCLUDE_REDIS_CPP_GLOB_PATTERN_H
+
+#include "common.h"
+#include <array>
+
+namespace rediscpp
+{
+	///一度だけ解析するglobのパターン
+	///@note '*'で区切った区間の並びにし、各区間は1文字ずつの比較か、文字の集合を持つ
+	///@note 区間は固定長なので、先頭と末尾の区間を両端で比べ、途中の区間は最も左の一致を探せばよい
+	///@note 文字だけの区間はmemcmp, memchr, memmemで比べ、[]はパターン毎に256ビットの表にする
+	///@note 一致する文字列はpattern_matchと同じ
+	class glob_pattern_type
+	{
+		enum atom_types
+		{
+			literal_atom,
+			any_atom,
+			set_atom,
+		};
+		struct atom_type
+		{
+			uint8_t type;
+			uint8_t value;///<文字、nocaseなら大文字にしたもの
+			uint16_t set;///<setsの位置
+		};
+		///'*'の間の固定長の区間
+		struct segment_type
+		{
+			size_t begin;///<atomsの範囲
+			size_t end;
+			bool literal;///<文字だけ
+			std::string text;///<文字だけの時の内容
+			int anchor;///<nocaseでない文字の最初の位置、無ければ-1、探す時にmemchrで使う
+			size_t size() const { return end - begin; }
+		};
+		std::vector<atom_type> atoms;
+		std::vector<std::array<uint64_t,4>> sets;
+		std::vector<segment_type> segments;///<'*'が無ければ一つ、あれば'*'の数+1個
+		size_t min_length;
+		bool nocase;
+		bool all;///<"*"のみ
+		static const size_t memmem_threshold = 256;
+		static const uint8_t * get_fold_table();
+		bool match_atom(const atom_type & atom, uint8_t c) const;
+		bool match_segment(const segment_type & segment, const char * target) const;
+		const char * find_segment(const segment_type & segment, const char * begin, const char * end) const;
+	public:
+		glob_pattern_type(const std::string & pattern, bool nocase_ = false);
+		bool match(const char * target, size_t length) const;
+		bool match(const std::string & target) const { return match(target.data(), target.size()); }
+		bool match_all() const { return all; }
+	};
+};
+
+#endif
@@ -0,0 +1,84 @@
+#include "lazyfree.h"
+#include "type_string.h"
+#include "type_list.h"
+#include "type_set.h"
+#include "type_zset.h"
+#include "type_hash.h"
+
+namespace rediscpp
+{
+	std::atomic<uint64_t> lazyfree_type::pending_objects(0);
+	std::atomic<uint64_t> lazyfree_type::pending_bytes(0);
+	std::atomic<uint64_t> lazyfree_type::freed_objects(0);
+	lazyfree_type::lazyfree_type()
+		: running(false)
+	{
+	}
+	lazyfree_type::~lazyfree_type()
+	{
+		shutdown();
+		join();
+	}
+	void lazyfree_type::start()
+	{
+		if (!running) {
+			create();
+			running = true;
+		}
+	}
+	///解放にかかる手間としての要素数
+	size_t lazyfree_type::get_element_count(const type_interface & value)
+	{
+		switch (value.get_type()) {
+		case list_type: return dynamic_cast<const type_list &>(value).size();
+		case set_type: return dynamic_cast<const type_set &>(value).size();
+		case zset_type: return dynamic_cast<const type_zset &>(value).size();
+		case hash_type: return dynamic_cast<const type_hash &>(value).size();
+		default: return 1;
+		}
+	}
+	void lazyfree_type::push(std::shared_ptr<item_type> item)
+	{
+		pending_objects += item->objects;
+		pending_bytes += item->bytes;
+		items.push(item);
+	}
+	///要素数がthresholdより多ければ、値を切り離して解放を任せる
+	///@return 任せた場合はtrueで、valueは空になる
+	bool lazyfree_type::free_value(std::shared_ptr<type_interface> & value)
+	{
+		if (!running || !value || value.use_count() != 1 || get_element_count(*value) <= threshold) {
+			return false;
+		}
+		std::shared_ptr<item_type> item(new item_type());
+		item->objects = 1;
+		item->bytes = value->get_memory_usage();
+		item->value.swap(value);
+		push(item);
+		return true;
+	}
+	void lazyfree_type::free_dictionary(std::unique_ptr<dictionary_type> dictionary)
+	{
+		if (!running || dictionary->empty()) {
+			return;
+		}
+		std::shared_ptr<item_type> item(new item_type());
+		item->objects = dictionary->size();
+		item->bytes = dictionary->get_memory_usage();
+		item->dictionary = std::move(dictionary);
+		push(item);
+	}
+	///@note 終了を確かめられるように、待つ時間を区切る
+	void lazyfree_type::run()
+	{
+		std::shared_ptr<item_type> item = items.pop(100 * 1000);
+		if (!item) {
+			return;
+		}
+		item->value.reset();
+		item->dictionary.reset();
+		pending_objects -= item->objects;
+		pending_bytes -= item->bytes;
+		freed_objects += item->objects;
+	}
+};
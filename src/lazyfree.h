@@ -0,0 +1,39 @@
+#ifndef INCLUDE_REDIS_CPP_LAZYFREE_H
+#define INCLUDE_REDIS_CPP_LAZYFREE_H
+
+#include "thread.h"
+#include "type_interface.h"
+#include "dictionary.h"
+
+namespace rediscpp
+{
+	///大きな値と、切り離したキーの辞書を別スレッドで解放する
+	///@note ロックを保持したまま何百万もの要素を解放すると、その間すべてのクライアントが待つため
+	class lazyfree_type : public thread_type
+	{
+		struct item_type
+		{
+			std::shared_ptr<type_interface> value;
+			std::unique_ptr<dictionary_type> dictionary;
+			size_t objects;
+			size_t bytes;
+		};
+		sync_queue<std::shared_ptr<item_type>> items;
+		std::atomic<bool> running;
+		void push(std::shared_ptr<item_type> item);
+		virtual void run();
+	public:
+		static const size_t threshold = 64;///<これより多くの要素を持つ値は別スレッドで解放する
+		static std::atomic<uint64_t> pending_objects;///<解放待ちの値とキーの数
+		static std::atomic<uint64_t> pending_bytes;///<解放待ちの見積もりのバイト数
+		static std::atomic<uint64_t> freed_objects;
+		lazyfree_type();
+		virtual ~lazyfree_type();
+		void start();
+		static size_t get_element_count(const type_interface & value);
+		bool free_value(std::shared_ptr<type_interface> & value);
+		void free_dictionary(std::unique_ptr<dictionary_type> dictionary);
+	};
+};
+
+#endif
@@ -1,10 +1,30 @@
 #include "server.h"
 #include "crc64.h"
 
+///k, m, gの単位を付けられるバイト数
+static size_t parse_bytes(const char * str)
+{
+	char * unit = NULL;
+	size_t bytes = strtoull(str, &unit, 10);
+	switch (tolower(*unit)) {
+	case 'g': bytes *= 1024;
+	case 'm': bytes *= 1024;
+	case 'k': bytes *= 1024;
+	}
+	return bytes;
+}
+
 int main(int argc, char *argv[])
 {
 	rediscpp::crc64::initialize();
 	int thread = 3;
+	int batch = 64;
+	int shards = rediscpp::database_type::default_shard_count;
+	bool reactor = false;
+	bool uring = false;
+	size_t maxmemory = 0;
+	size_t max_bulk_len = rediscpp::server_type::default_proto_max_bulk_len;
+	rediscpp::maxmemory_policies policy = rediscpp::noeviction_policy;
 	std::string host = "127.0.0.1";
 	std::string port = "6379";
 	std::string config;
@@ -17,6 +37,43 @@ int main(int argc, char *argv[])
 					thread = atoi(argv[i]);
 				}
 				break;
+			case 'e':
+				++i;
+				if (i < argc) {
+					batch = atoi(argv[i]);
+				}
+				break;
+			case 's':
+				++i;
+				if (i < argc) {
+					shards = atoi(argv[i]);
+				}
+				break;
+			case 'r':
+				reactor = true;
+				break;
+			case 'u':
+				uring = true;
+				break;
+			case 'm':
+				++i;
+				if (i < argc) {
+					maxmemory = parse_bytes(argv[i]);
+				}
+				break;
+			case 'b':
+				++i;
+				if (i < argc) {
+					max_bulk_len = parse_bytes(argv[i]);
+				}
+				break;
+			case 'M':
+				++i;
+				if (i < argc && !rediscpp::server_type::parse_maxmemory_policy(argv[i], policy)) {
+					fprintf(stderr, "unknown maxmemory policy %s\n", argv[i]);
+					return -1;
+				}
+				break;
 			case 'h':
 				++i;
 				if (i < argc) {
@@ -35,6 +92,13 @@ int main(int argc, char *argv[])
 		}
 	}
 	rediscpp::server_type server;
+	server.set_poll_batch_size(batch);
+	server.set_shard_count(shards);
+	server.set_reactor_mode(reactor);
+	server.set_poll_engine(uring ? rediscpp::uring_engine : rediscpp::epoll_engine);
+	server.set_maxmemory(maxmemory);
+	server.set_proto_max_bulk_len(max_bulk_len);
+	server.set_maxmemory_policy(policy);
 	if (!server.start(host, port, thread)) {
 		return -1;
 	}
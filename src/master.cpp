@@ -195,11 +195,9 @@ namespace rediscpp
 					if (client->should_recv()) {
 						auto & buf = client->get_recv();
 						size_t size = std::min(sync_file_size, buf.size());
-						auto end = buf.begin() + size;
-						std::vector<uint8_t> tmp(buf.begin(), end);
-						sync_file->write(tmp);
+						sync_file->write(buf.begin(), size);
 						sync_file->flush();
-						buf.erase(buf.begin(), end);
+						buf.consume(size);
 						sync_file_size -= size;
 					}
 					if (sync_file_size == 0) {
@@ -1,4 +1,5 @@
 #include "network.h"
+#include "uring.h"
 #include <sys/types.h>
 #include <netdb.h>
 #include <unistd.h>
@@ -150,12 +151,23 @@ namespace rediscpp
 		}
 		return std::string();
 	}
+	std::atomic<uint64_t> socket_type::recv_call_count(0);
+	std::atomic<uint64_t> socket_type::recv_completion_count(0);
+	std::atomic<uint64_t> socket_type::accept_completion_count(0);
+	std::atomic<uint64_t> socket_type::send_call_count(0);
+	std::atomic<uint64_t> socket_type::send_submission_count(0);
+	std::atomic<uint64_t> socket_type::send_bytes(0);
+	std::atomic<uint64_t> socket_type::partial_send_count(0);
 	socket_type::socket_type(int fd_)
 		: pollable_type(fd_)
 		, finished_to_read(false)
 		, finished_to_write(false)
 		, shutdowning(-1)
 		, broken(false)
+		, external_recv(false)
+		, external_send(false)
+		, send_pending(false)
+		, send_completed(0)
 		, sending_file_id(-1)
 		, sending_file_size(0)
 		, sent_file_size(0)
@@ -203,6 +215,16 @@ namespace rediscpp
 		}
 		return true;
 	}
+	bool socket_type::set_reuseport(bool reuse)
+	{
+		int option = reuse ? 1 : 0;
+		int r = setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &option, sizeof(option));
+		if (r < 0) {
+			lputs(__FILE__, __LINE__, error_level, "::setsockopt(SO_REUSEPORT) failed : " + string_error(errno));
+			return false;
+		}
+		return true;
+	}
 	bool socket_type::set_nodelay(bool nodelay)
 	{
 		int option = nodelay ? 1 : 0;
@@ -291,22 +313,30 @@ namespace rediscpp
 		}
 		return true;
 	}
+	///@note pollがio_uringのacceptで受け付けていれば、そのソケットを取り出し、相手のアドレスはgetpeernameで得る
 	std::shared_ptr<socket_type> socket_type::accept()
 	{
 		std::shared_ptr<address_type> addr(new address_type());
 		addr->set_family(local->get_family());
 		socklen_t addr_len = static_cast<socklen_t>(addr->get_sockaddr_size());
-		int interupt_count = 0;
-		int cs = 0;
-		while (true) {
-			cs = ::accept(fd, addr->get_sockaddr(), &addr_len);
-			if (cs < 0 && errno == EINTR) {
-				if (interupt_count < 3) {
-					++interupt_count;
-					continue;
+		int cs = -1;
+		auto poll_ = get_poll();
+		if (poll_ && poll_->pop_accepted(this, cs)) {
+			if (0 <= cs && getpeername(cs, addr->get_sockaddr(), &addr_len) < 0) {
+				lprintf(__FILE__, __LINE__, info_level, "getpeername(%d) failed:%s", cs, string_error(errno).c_str());
+			}
+		} else {
+			int interupt_count = 0;
+			while (true) {
+				cs = ::accept(fd, addr->get_sockaddr(), &addr_len);
+				if (cs < 0 && errno == EINTR) {
+					if (interupt_count < 3) {
+						++interupt_count;
+						continue;
+					}
 				}
+				break;
 			}
-			break;
 		}
 		if (cs < 0) {
 			return std::shared_ptr<socket_type>();
@@ -316,6 +346,12 @@ namespace rediscpp
 		child->peer = addr;
 		return child;
 	}
+	///pollが受け付け済みで、まだacceptで取り出していないソケットがあるか
+	bool socket_type::has_accepted()
+	{
+		auto poll_ = get_poll();
+		return poll_ && poll_->has_accepted(this);
+	}
 	bool socket_type::send(const void * buf, size_t len)
 	{
 		if (len == 0) {
@@ -325,9 +361,17 @@ namespace rediscpp
 			lprintf(__FILE__, __LINE__, error_level, "failed to send on sending file");
 			return false;
 		}
-		send_buffers.push_back(std::make_pair<std::vector<uint8_t>, size_t>(std::vector<uint8_t>(), 0));
-		std::vector<uint8_t> & last = send_buffers.back().first;
-		last.assign(reinterpret_cast<const uint8_t*>(buf), reinterpret_cast<const uint8_t*>(buf) + len);
+		send_buffer.append(buf, len);
+		return true;
+	}
+	///値の参照を送信バッファに追加する
+	bool socket_type::send(const std::shared_ptr<const std::string> & shared)
+	{
+		if (is_sendfile()) {
+			lprintf(__FILE__, __LINE__, error_level, "failed to send on sending file");
+			return false;
+		}
+		send_buffer.append(shared);
 		return true;
 	}
 	bool socket_type::shutdown(bool reading, bool writing)
@@ -355,26 +399,34 @@ namespace rediscpp
 		}
 		return true;
 	}
+	///@note io_uringで送信している場合は、送り終えた分を除くだけで、残りは再登録時にpollが送る
 	bool socket_type::send()
 	{
 		if (fd < 0) {
 			return false;
 		}
-		if (!send_buffers.empty()) {
-#if 1
-			while (!send_buffers.empty()) {
-				auto & src = send_buffers.front();
-				auto & buf = src.first;
-				auto & offset = src.second;
-				if (buf.size() <= offset)
-				{
-					send_buffers.pop_front();
-					continue;
-				}
+		if (external_send) {
+			consume_sent();
+			if (send_pending) {
+				return true;
+			}
+		}
+		if (!send_buffer.empty()) {
+			if (external_send) {
+				return true;
+			}
+			iovec vectors[IOV_MAX];
+			while (!send_buffer.empty()) {
+				size_t len = 0;
+				msghdr message;
+				memset(&message, 0, sizeof(message));
+				message.msg_iov = vectors;
+				message.msg_iovlen = send_buffer.get_iovec(vectors, IOV_MAX, len);
 				int interupt_count = 0;
 				ssize_t r;
 				while (true) {
-					r = ::send(fd, &buf[offset], static_cast<int>(buf.size() - offset), MSG_NOSIGNAL);
+					r = ::sendmsg(fd, &message, MSG_NOSIGNAL);
+					++send_call_count;
 					if (r < 0 && errno == EINTR) {
 						if (interupt_count < 3) {
 							++interupt_count;
@@ -391,71 +443,25 @@ namespace rediscpp
 						close();
 						return false;
 					}
-					send_buffers.clear();
+					send_buffer.clear();
 					broken = true;
-					lprintf(__FILE__, __LINE__, error_level, "send(%d) failed:%s", fd, string_error(errno).c_str());
-					return false;
-				}
-				if (0 < r) {
-					auto len = buf.size() - offset;
-					if (r < len) {
-						offset += r;
-						break;
-					} else {
-						r -= len;
-						send_buffers.pop_front();
-					}
-				}
-			}
-#else
-			std::vector<iovec> send_vectors(std::min<size_t>(IOV_MAX, send_buffers.size()));
-			for (size_t i = 0, n = send_buffers.size(); i < n; ++i) {
-				auto & src = send_buffers[i];
-				iovec & iv = send_vectors[i];
-				iv.iov_base = & src.first[0] + src.second;
-				iv.iov_len = src.first.size() - src.second;
-			}
-			ssize_t r;
-			int interupt_count = 0;
-			while (true) {
-				r = ::writev(fd, &send_vectors[0], static_cast<int>(send_vectors.size()));
-				if (r < 0 && errno == EINTR) {
-					if (interupt_count < 3) {
-						++interupt_count;
-						continue;
-					}
-				}
-				break;
-			}
-			if (r < 0) {
-				if (errno == EAGAIN) {
+					lprintf(__FILE__, __LINE__, error_level, "sendmsg(%d) failed:%s", fd, string_error(errno).c_str());
 					return false;
 				}
-				broken = true;
-				lprintf(__FILE__, __LINE__, error_level, "writev(%d) failed:%s", fd, string_error(errno).c_str());
-				return false;
-			}
-			while (0 < r && ! send_buffers.empty()) {
-				auto & front_buffer = send_buffers.front();
-				auto & buf = front_buffer.first;
-				auto & offset = front_buffer.second;
-				auto len = buf.size() - offset;
+				send_bytes += r;
+				send_buffer.consume(r);
 				if (r < len) {
-					offset += r;
-					r = 0;
+					++partial_send_count;
 					break;
-				} else {
-					r -= len;
-					send_buffers.pop_front();
 				}
 			}
-#endif
 		} else if (is_sendfile()) {
 			ssize_t r;
 			int interupt_count = 0;
 			size_t count = sending_file_size - sent_file_size;
 			while (true) {
 				r = ::sendfile(fd, sending_file_id, NULL, count);
+				++send_call_count;
 				if (r < 0 && errno == EINTR) {
 					if (interupt_count < 3) {
 						++interupt_count;
@@ -474,7 +480,7 @@ namespace rediscpp
 			}
 			sent_file_size += r;
 		}
-		if (send_buffers.empty() && !is_sendfile()) {
+		if (send_buffer.empty() && !is_sendfile()) {
 			if (finished_to_write) {
 				shutdown(false, true);
 				return true;
@@ -482,20 +488,22 @@ namespace rediscpp
 		}
 		return true;
 	}
+	///@note io_uringで受信している場合は、既にrecv_bufferに入っているので何もしない
 	bool socket_type::recv()
 	{
 		if (fd < 0) {
 			return false;
 		}
-		if (finished_to_read) {
+		if (finished_to_read || external_recv) {
 			return true;
 		}
-		uint8_t buf[1500];
 		int interupt_count = 0;
 		while (true) {
-			ssize_t r = ::read(fd, buf, sizeof(buf));
+			uint8_t * buf = recv_buffer.prepare(recv_unit_size);
+			ssize_t r = ::read(fd, buf, recv_buffer.writable());
+			++recv_call_count;
 			if (0 < r) {
-				recv_buffer.insert(recv_buffer.end(), &buf[0], &buf[0] + r);
+				recv_buffer.commit(r);
 			} else if (r == 0) {
 				finished_to_read = true;
 				break;
@@ -511,6 +519,15 @@ namespace rediscpp
 		}
 		return true;
 	}
+	///pollが送信し終えた分をsend_bufferから除く
+	void socket_type::consume_sent()
+	{
+		size_t completed = send_completed.exchange(0);
+		if (completed) {
+			send_bytes += completed;
+			send_buffer.consume(completed);
+		}
+	}
 	void socket_type::close_after_send()
 	{
 		finished_to_write = true;
@@ -548,26 +565,51 @@ namespace rediscpp
 		auto poll_ = poll.lock();
 		if (poll_) {
 			auto self_ = self.lock();
-			if (self_) {
+			if (self_ && !poll_->defer(self_)) {
 				poll_->modify(self_);
 			}
 		}
 	}
-	std::shared_ptr<poll_type> poll_type::create()
+	///@note io_uringが使えない場合はepollにする
+	std::shared_ptr<poll_type> poll_type::create(poll_engine_types engine)
 	{
-		std::shared_ptr<poll_type> poll(new poll_type());
+		std::shared_ptr<poll_type> poll;
+		if (engine == uring_engine) {
+			poll = uring_poll_type::create();
+			if (!poll) {
+				lputs(__FILE__, __LINE__, info_level, "io_uring is not available, use epoll");
+			}
+		}
+		if (!poll) {
+			poll.reset(new poll_type());
+		}
 		poll->self = poll;
 		return poll;
 	}
 	poll_type::poll_type()
 		: fd(-1)
 		, count(0)
+		, wait_count(0)
+		, event_count(0)
+		, modify_count(0)
+		, deferred_count(0)
+		, syscall_count(0)
 	{
 		fd = ::epoll_create1(EPOLL_CLOEXEC);
 		if (fd < 0) {
 			throw std::runtime_error(std::string("poll_type::epoll_create failed:") + string_error(errno));
 		}
 	}
+	poll_type::poll_type(int fd_)
+		: fd(fd_)
+		, count(0)
+		, wait_count(0)
+		, event_count(0)
+		, modify_count(0)
+		, deferred_count(0)
+		, syscall_count(0)
+	{
+	}
 	poll_type::~poll_type()
 	{
 		close();
@@ -589,10 +631,7 @@ namespace rediscpp
 		auto & events = pollable->events;
 		auto newevents = pollable->get_events();
 		events.events = newevents;
-		int r = epoll_ctl(fd, op, pollable->get_handle(), op == EPOLL_CTL_DEL ? NULL : &events);
-		//lprintf(__FILE__, __LINE__, error_level, "epoll_ctl(%d,%s)", pollable->get_handle(), op == EPOLL_CTL_ADD ? "add" : (op == EPOLL_CTL_MOD ? "mod" : (op == EPOLL_CTL_DEL ? "del" : "unknown")));
-		if (r < 0) {
-			lprintf(__FILE__, __LINE__, error_level, "epoll_ctl(%d) failed:%s", pollable->get_handle(), string_error(errno).c_str());
+		if (!control(pollable.get(), op, newevents)) {
 			return false;
 		}
 		switch (op) {
@@ -608,9 +647,22 @@ namespace rediscpp
 			//lprintf(__FILE__, __LINE__, error_level, "epoll_ctl del %d", count);
 			pollable->set_poll(std::shared_ptr<poll_type>());
 			break;
-		//case EPOLL_CTL_MOD:
+		case EPOLL_CTL_MOD:
+			++modify_count;
 			//lputs(__FILE__, __LINE__, error_level, "epoll_ctl mod");
-			//break;
+			break;
+		}
+		return true;
+	}
+	///@param[in] op EPOLL_CTL_ADD, EPOLL_CTL_MOD, EPOLL_CTL_DEL
+	bool poll_type::control(pollable_type * pollable, int op, uint32_t events)
+	{
+		int r = epoll_ctl(fd, op, pollable->get_handle(), op == EPOLL_CTL_DEL ? NULL : &pollable->events);
+		++syscall_count;
+		//lprintf(__FILE__, __LINE__, error_level, "epoll_ctl(%d,%s)", pollable->get_handle(), op == EPOLL_CTL_ADD ? "add" : (op == EPOLL_CTL_MOD ? "mod" : (op == EPOLL_CTL_DEL ? "del" : "unknown")));
+		if (r < 0) {
+			lprintf(__FILE__, __LINE__, error_level, "epoll_ctl(%d) failed:%s", pollable->get_handle(), string_error(errno).c_str());
+			return false;
 		}
 		return true;
 	}
@@ -623,6 +675,8 @@ namespace rediscpp
 			return true;
 		}
 		int r = epoll_wait(fd,  &events[0], events.size(), timeout_milli_sec);
+		++wait_count;
+		++syscall_count;
 		if (r < 0) {
 			events.clear();
 			if (errno == EINTR) {
@@ -632,11 +686,17 @@ namespace rediscpp
 			lprintf(__FILE__, __LINE__, error_level, "epoll_wait failed:%s", string_error(errno).c_str());
 			return false;
 		}
+		event_count += r;
 		if (r < events.size()) {
 			events.resize(r);
 		}
+		send_ready(events);
+		return true;
+	}
+	///送信可能になったソケットの送信バッファを送る
+	void poll_type::send_ready(std::vector<epoll_event> & events)
+	{
 		for (auto it = events.begin(), end = events.end(); it != end; ++it) {
-			auto & event = *it;
 			auto pollable = reinterpret_cast<pollable_type*>(it->data.ptr);
 			if (pollable) {
 				auto socket = dynamic_cast<socket_type*>(pollable);
@@ -645,6 +705,64 @@ namespace rediscpp
 				}
 			}
 		}
+	}
+	///dispatch中のスレッドが処理しているpollと作業領域
+	static __thread poll_type * dispatching_poll = NULL;
+	static __thread poll_batch_type * dispatching_batch = NULL;
+	///dispatch中ならば再登録を処理後まで遅らせる
+	bool poll_type::defer(std::shared_ptr<pollable_type> pollable)
+	{
+		if (dispatching_poll != this || !dispatching_batch) {
+			return false;
+		}
+		auto & deferred = dispatching_batch->deferred;
+		if (deferred.empty() || deferred.back() != pollable) {
+			deferred.push_back(pollable);
+		}
+		return true;
+	}
+	///遅らせた再登録を行う
+	///@note 処理中に閉じられたり、別のpollに移ったものは除く
+	void poll_type::flush_deferred(poll_batch_type & batch)
+	{
+		for (auto it = batch.deferred.begin(), end = batch.deferred.end(); it != end; ++it) {
+			auto & pollable = *it;
+			if (0 <= pollable->get_handle() && pollable->poll.lock().get() == this) {
+				modify(pollable);
+				++deferred_count;
+			}
+		}
+		batch.deferred.clear();
+	}
+	bool poll_type::dispatch(poll_batch_type & batch, int timeout_milli_sec)
+	{
+		batch.events.resize(batch.limit);
+		if (!wait(batch.events, timeout_milli_sec)) {
+			return false;
+		}
+		if (batch.events.empty()) {
+			return true;
+		}
+		dispatching_poll = this;
+		dispatching_batch = &batch;
+		for (auto it = batch.events.begin(), end = batch.events.end(); it != end; ++it) {
+			auto pollable = reinterpret_cast<pollable_type*>(it->data.ptr);
+			if (!pollable) {
+				continue;
+			}
+			//EPOLLONESHOTのため、一つの失敗で残りのイベントを捨てると再登録されなくなる
+			try
+			{
+				pollable->trigger(it->events);
+			} catch (const std::exception & e) {
+				lprintf(__FILE__, __LINE__, info_level, "exception %s", e.what());
+			} catch (...) {
+				lprintf(__FILE__, __LINE__, info_level, "exception");
+			}
+		}
+		dispatching_poll = NULL;
+		dispatching_batch = NULL;
+		flush_deferred(batch);
 		return true;
 	}
 }
@@ -15,6 +15,7 @@
 #include "common.h"
 #include "thread.h"
 #include "log.h"
+#include "buffer.h"
 
 namespace rediscpp
 {
@@ -90,6 +91,7 @@ namespace rediscpp
 		{
 			poll = poll_;
 		}
+		std::shared_ptr<poll_type> get_poll() const { return poll.lock(); }
 		void set_extra(void * extra_) { extra = extra_; }
 		void * get_extra() { return extra; }
 		void set_extra2(void * extra2_) { extra2 = extra2_; }
@@ -108,8 +110,13 @@ namespace rediscpp
 		bool finished_to_write;
 		int shutdowning;
 		bool broken;
-		std::deque<uint8_t> recv_buffer;
-		std::deque<std::pair<std::vector<uint8_t>,size_t>> send_buffers;
+		bool external_recv;///<pollがrecv_bufferに受信するので、recvでreadしない
+		bool external_send;///<pollがsend_bufferを送信するので、sendでsendmsgしない
+		std::atomic<bool> send_pending;///<pollが送信中
+		std::atomic<size_t> send_completed;///<pollが送信し終えて、まだsend_bufferから除いていないバイト数
+		recv_buffer_type recv_buffer;
+		static const size_t recv_unit_size = 4096;///<readの前に最低限確保する領域
+		send_buffer_type send_buffer;
 		int sending_file_id;
 		size_t sending_file_size;
 		size_t sent_file_size;
@@ -122,23 +129,35 @@ namespace rediscpp
 		static std::shared_ptr<socket_type> create(const address_type & address, bool stream = true);
 		bool set_nonblocking(bool nonblocking = true);
 		bool set_reuse(bool reuse = true);
+		bool set_reuseport(bool reuse = true);
 		bool set_nodelay(bool nodelay = true);
 		bool set_keepalive(bool keepalive, int idle, int interval, int count);
 		bool bind(std::shared_ptr<address_type> address);
 		bool connect(std::shared_ptr<address_type> address);
 		bool listen(int queue_count);
 		std::shared_ptr<socket_type> accept();
+		bool has_accepted();
 		bool is_broken() const { return broken; }
 	public:
-		bool should_send() const { return (! send_buffers.empty() || is_sendfile()) && ! is_write_shutdowned(); }
+		bool should_send() const { return (! send_buffer.empty() || is_sendfile()) && ! is_write_shutdowned(); }
 		bool should_recv() const { return ! recv_buffer.empty() && ! is_read_shutdowned(); }
 		bool send();
 		bool recv();
 		bool send(const void * buf, size_t len);
+		bool send(const std::shared_ptr<const std::string> & shared);
 		void sendfile(int in_fd, size_t size);
 		bool is_sendfile() const { return sent_file_size < sending_file_size; }
-		std::deque<uint8_t> & get_recv() { return recv_buffer; }
+		recv_buffer_type & get_recv() { return recv_buffer; }
+		send_buffer_type & get_send_buffer() { return send_buffer; }
 		bool recv_done() const { return finished_to_read; }
+		bool is_listening() const { return local != NULL; }
+		void set_external_recv(bool external) { external_recv = external; }
+		void finish_recv() { finished_to_read = true; }
+		void set_external_send(bool external) { external_send = external; }
+		void start_external_send() { send_pending = true; }
+		void finish_external_send(size_t bytes) { send_completed += bytes; send_pending = false; }
+		void consume_sent();
+		bool is_closing() const { return finished_to_write; }
 		std::shared_ptr<socket_type> get() { return std::dynamic_pointer_cast<socket_type>(self.lock()); }
 		void close_after_send();
 		bool is_read_shutdowned() const { return shutdowning == SHUT_RD || shutdowning == SHUT_RDWR; }
@@ -146,6 +165,13 @@ namespace rediscpp
 		virtual uint32_t get_events();
 		bool done() const { return recv_done() && ! should_recv() && ! should_send(); }
 		std::string get_peer_info() { return peer ? peer->get_info() : std::string(); }
+		static std::atomic<uint64_t> recv_call_count;///<readの呼び出し回数
+		static std::atomic<uint64_t> recv_completion_count;///<io_uringのrecvで受け取った回数
+		static std::atomic<uint64_t> accept_completion_count;///<io_uringのacceptで受け付けた回数
+		static std::atomic<uint64_t> send_call_count;///<sendmsg, sendfileの呼び出し回数
+		static std::atomic<uint64_t> send_submission_count;///<io_uringに投入したsendmsgの数
+		static std::atomic<uint64_t> send_bytes;///<sendmsgで送信したバイト数
+		static std::atomic<uint64_t> partial_send_count;///<一部しか送信できなかった回数
 	};
 	class event_type : public pollable_type
 	{
@@ -387,16 +413,54 @@ namespace rediscpp
 		}
 	};
 
+	///poll_type::dispatchで使う作業領域
+	///@note スレッド毎に保持して使い回すことで、待機毎の確保を避ける
+	struct poll_batch_type
+	{
+		size_t limit;///<一度に受け取る最大イベント数
+		std::vector<epoll_event> events;
+		std::vector<std::shared_ptr<pollable_type>> deferred;///<処理後にまとめて再登録する対象
+		poll_batch_type(size_t limit_ = 1)
+			: limit(std::max<size_t>(1, limit_))
+		{
+			events.reserve(limit);
+			deferred.reserve(limit);
+		}
+	};
+	///poll_typeの待機方法
+	enum poll_engine_types
+	{
+		epoll_engine,
+		uring_engine,///<io_uringのPOLL_ADDで待つ
+	};
 	class poll_type
 	{
+		friend class pollable_type;
+	protected:
 		int fd;
 		int count;
 		std::weak_ptr<poll_type> self;
+		std::atomic<uint64_t> wait_count;///<待機の呼び出し回数
+		std::atomic<uint64_t> event_count;///<待機で受け取ったイベント数
+		std::atomic<uint64_t> modify_count;///<再登録の回数
+		std::atomic<uint64_t> deferred_count;///<dispatch後にまとめて再登録した回数
+		std::atomic<uint64_t> syscall_count;///<待機と登録操作のシステムコール数
 		poll_type();
+		explicit poll_type(int fd_);
+		bool defer(std::shared_ptr<pollable_type> pollable);
+		virtual void flush_deferred(poll_batch_type & batch);
+		virtual bool control(pollable_type * pollable, int op, uint32_t events);
+		void send_ready(std::vector<epoll_event> & events);
 	public:
-		static std::shared_ptr<poll_type> create();
-		~poll_type();
+		static std::shared_ptr<poll_type> create(poll_engine_types engine = epoll_engine);
+		virtual ~poll_type();
 		void close();
+		virtual const char * get_engine_name() const { return "epoll"; }
+		///pollが受け付け済みのソケットを取り出す
+		///@retval false pollは受け付けていないので、acceptを呼ぶ
+		///@note 受け付け済みのソケットが無ければfdは-1
+		virtual bool pop_accepted(pollable_type * pollable, int & fd) { return false; }
+		virtual bool has_accepted(pollable_type * pollable) { return false; }
 	private:
 		bool operation(std::shared_ptr<pollable_type> pollable, int op);
 	public:
@@ -404,7 +468,14 @@ namespace rediscpp
 		bool append(std::shared_ptr<pollable_type> pollable) { return operation(pollable, EPOLL_CTL_ADD); }
 		bool modify(std::shared_ptr<pollable_type> pollable) { return operation(pollable, EPOLL_CTL_MOD); }
 		bool remove(std::shared_ptr<pollable_type> pollable) { return operation(pollable, EPOLL_CTL_DEL); }
-		bool wait(std::vector<epoll_event> & events, int timeout_milli_sec = 0);
+		virtual bool wait(std::vector<epoll_event> & events, int timeout_milli_sec = 0);
+		///最大batch.limit個のイベントを待ち、全て処理してから再登録をまとめて行う
+		bool dispatch(poll_batch_type & batch, int timeout_milli_sec = 0);
+		uint64_t get_wait_count() const { return wait_count; }
+		uint64_t get_event_count() const { return event_count; }
+		uint64_t get_modify_count() const { return modify_count; }
+		uint64_t get_deferred_count() const { return deferred_count; }
+		uint64_t get_syscall_count() const { return syscall_count; }
 	};
 }
 
@@ -0,0 +1,199 @@
+#include "node_pool.h"
+#include "thread.h"
+
+namespace rediscpp
+{
+	namespace
+	{
+		struct free_block_type
+		{
+			free_block_type * next;
+		};
+		struct free_list_type
+		{
+			free_block_type * head;
+			size_t count;
+			free_list_type() : head(NULL), count(0) {}
+			void push(void * block)
+			{
+				free_block_type * node = static_cast<free_block_type *>(block);
+				node->next = head;
+				head = node;
+				++count;
+			}
+			void * pop()
+			{
+				free_block_type * node = head;
+				head = node->next;
+				--count;
+				return node;
+			}
+			///先頭から最大n個をdstに移す
+			void transfer(free_list_type & dst, size_t n)
+			{
+				for (; n && head; --n) {
+					dst.push(pop());
+				}
+			}
+		};
+		struct thread_cache_type;
+		///全スレッドで共有する空きリスト
+		///@note 終了時の解放の順番に関わらず使えるように、一度作ったら解放しない
+		struct central_type
+		{
+			mutex_type mutex;
+			free_list_type free[node_pool_type::class_count];
+			size_t reserved_blocks[node_pool_type::class_count];
+			int64_t retired_used[node_pool_type::class_count];///<終了したスレッドと、スレッド毎の空きリストを使わなかった分の使用数
+			std::set<thread_cache_type *> caches;
+			central_type()
+			{
+				std::fill(reserved_blocks, reserved_blocks + node_pool_type::class_count, 0);
+				std::fill(retired_used, retired_used + node_pool_type::class_count, 0);
+			}
+			///共有の空きリストが空ならslabを切り分ける
+			///@note mutexを保持して呼ぶ
+			void refill(size_t index)
+			{
+				if (free[index].head) {
+					return;
+				}
+				const size_t block_size = (index + 1) * node_pool_type::block_alignment;
+				const size_t blocks = node_pool_type::slab_size / block_size;
+				char * slab = static_cast<char *>(::operator new(node_pool_type::slab_size));
+				for (size_t i = blocks; i; --i) {
+					free[index].push(slab + (i - 1) * block_size);
+				}
+				reserved_blocks[index] += blocks;
+			}
+		};
+		central_type & get_central()
+		{
+			static central_type * central = new central_type;
+			return *central;
+		}
+		///スレッド毎の空きリスト
+		struct thread_cache_type
+		{
+			free_list_type free[node_pool_type::class_count];
+			std::atomic<int64_t> used[node_pool_type::class_count];///<このスレッドで確保した数から解放した数を引いたもの
+			thread_cache_type()
+			{
+				for (size_t i = 0; i < node_pool_type::class_count; ++i) {
+					used[i] = 0;
+				}
+				central_type & central = get_central();
+				mutex_locker locker(central.mutex);
+				central.caches.insert(this);
+			}
+			~thread_cache_type()
+			{
+				central_type & central = get_central();
+				mutex_locker locker(central.mutex);
+				for (size_t i = 0; i < node_pool_type::class_count; ++i) {
+					free[i].transfer(central.free[i], free[i].count);
+					central.retired_used[i] += used[i];
+				}
+				central.caches.erase(this);
+			}
+			void add_used(size_t index, int64_t delta)
+			{
+				used[index].store(used[index].load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+			}
+		};
+		static __thread thread_cache_type * thread_cache = NULL;
+		static __thread bool thread_exited = false;
+		///スレッドの終了時に空きリストを共有に戻す
+		struct thread_cache_holder_type
+		{
+			thread_cache_type * cache;
+			thread_cache_holder_type() : cache(NULL) {}
+			~thread_cache_holder_type()
+			{
+				thread_cache = NULL;
+				thread_exited = true;
+				delete cache;
+			}
+		};
+		static thread_local thread_cache_holder_type thread_cache_holder;
+		///@return 終了処理中のスレッドではNULL
+		thread_cache_type * get_thread_cache()
+		{
+			if (thread_cache) {
+				return thread_cache;
+			}
+			if (thread_exited) {
+				return NULL;
+			}
+			thread_cache = new thread_cache_type;
+			thread_cache_holder.cache = thread_cache;
+			return thread_cache;
+		}
+		size_t get_class_index(size_t size)
+		{
+			return (size - 1) / node_pool_type::block_alignment;
+		}
+	}
+	void * node_pool_type::allocate(size_t size)
+	{
+		const size_t index = get_class_index(size);
+		thread_cache_type * cache = get_thread_cache();
+		if (!cache) {
+			central_type & central = get_central();
+			mutex_locker locker(central.mutex);
+			central.refill(index);
+			++central.retired_used[index];
+			return central.free[index].pop();
+		}
+		free_list_type & list = cache->free[index];
+		if (!list.head) {
+			central_type & central = get_central();
+			mutex_locker locker(central.mutex);
+			central.refill(index);
+			central.free[index].transfer(list, transfer_blocks);
+		}
+		cache->add_used(index, 1);
+		return list.pop();
+	}
+	void node_pool_type::deallocate(void * block, size_t size)
+	{
+		if (!block) {
+			return;
+		}
+		const size_t index = get_class_index(size);
+		thread_cache_type * cache = get_thread_cache();
+		if (!cache) {
+			central_type & central = get_central();
+			mutex_locker locker(central.mutex);
+			central.free[index].push(block);
+			--central.retired_used[index];
+			return;
+		}
+		free_list_type & list = cache->free[index];
+		list.push(block);
+		cache->add_used(index, -1);
+		if (max_cached_blocks < list.count) {
+			central_type & central = get_central();
+			mutex_locker locker(central.mutex);
+			list.transfer(central.free[index], transfer_blocks);
+		}
+	}
+	///種類毎のslabから切り出した数と使用中の数
+	///@note 他のスレッドの使用数は少し古い値になることがある
+	void node_pool_type::get_statistics(std::vector<statistics_type> & result)
+	{
+		result.clear();
+		central_type & central = get_central();
+		mutex_locker locker(central.mutex);
+		for (size_t i = 0; i < class_count; ++i) {
+			statistics_type statistics;
+			statistics.block_size = (i + 1) * block_alignment;
+			statistics.reserved_blocks = central.reserved_blocks[i];
+			statistics.used_blocks = central.retired_used[i];
+			for (auto it = central.caches.begin(), end = central.caches.end(); it != end; ++it) {
+				statistics.used_blocks += (*it)->used[i].load(std::memory_order_relaxed);
+			}
+			result.push_back(statistics);
+		}
+	}
+};
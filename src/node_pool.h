@@ -0,0 +1,73 @@
+#ifndef INCLUDE_REDIS_CPP_NODE_POOL_H
+#define INCLUDE_REDIS_CPP_NODE_POOL_H
+
+#include "common.h"
+
+namespace rediscpp
+{
+	///固定長の節を大きさの種類毎に確保するプール
+	///@note 16バイト単位の種類毎に、64KBのslabを切り分けた空きブロックの単方向リストを持つ
+	///@note 確保と解放はスレッド毎の空きリストで行い、増えすぎたら共有の空きリストに戻すので、ロックは時々しか取らない
+	///@note 別のスレッドで確保したブロックも、解放したスレッドの空きリストに入る
+	///@note slabはOSに返さず、同じ大きさの節で使い回す
+	class node_pool_type
+	{
+	public:
+		static const size_t block_alignment = 16;
+		static const size_t max_block_size = 256;///<これより大きい確保はoperator newに任せる
+		static const size_t class_count = max_block_size / block_alignment;
+		static const size_t slab_size = 64 * 1024;
+		static const size_t max_cached_blocks = 1024;///<スレッド毎、種類毎に持つ空きブロックの上限
+		static const size_t transfer_blocks = 512;///<共有の空きリストと一度に移すブロック数
+		struct statistics_type
+		{
+			size_t block_size;
+			size_t reserved_blocks;///<slabから切り出したブロック数
+			int64_t used_blocks;///<使用中のブロック数
+		};
+		static bool is_pooled(size_t size) { return 0 < size && size <= max_block_size; }
+		static void * allocate(size_t size);
+		static void deallocate(void * block, size_t size);
+		static void get_statistics(std::vector<statistics_type> & result);
+	};
+	///node_pool_typeから確保するSTLのアロケータ
+	///@note 節のような小さな確保だけをプールから取り、unordered_mapのバケットの配列のような大きな確保はoperator newに任せる
+	template<typename T>
+	class node_allocator
+	{
+	public:
+		typedef T value_type;
+		typedef T * pointer;
+		typedef const T * const_pointer;
+		typedef T & reference;
+		typedef const T & const_reference;
+		typedef size_t size_type;
+		typedef ptrdiff_t difference_type;
+		template<typename U> struct rebind { typedef node_allocator<U> other; };
+		node_allocator() {}
+		template<typename U> node_allocator(const node_allocator<U> &) {}
+		pointer address(reference x) const { return &x; }
+		const_pointer address(const_reference x) const { return &x; }
+		size_type max_size() const { return static_cast<size_type>(-1) / sizeof(T); }
+		pointer allocate(size_type n, const void * = NULL)
+		{
+			const size_t size = n * sizeof(T);
+			return static_cast<pointer>(node_pool_type::is_pooled(size) ? node_pool_type::allocate(size) : ::operator new(size));
+		}
+		void deallocate(pointer p, size_type n)
+		{
+			const size_t size = n * sizeof(T);
+			if (node_pool_type::is_pooled(size)) {
+				node_pool_type::deallocate(p, size);
+			} else {
+				::operator delete(p);
+			}
+		}
+		template<typename U, typename... Args> void construct(U * p, Args &&... args) { ::new(static_cast<void *>(p)) U(std::forward<Args>(args)...); }
+		template<typename U> void destroy(U * p) { p->~U(); }
+		template<typename U> bool operator==(const node_allocator<U> &) const { return true; }
+		template<typename U> bool operator!=(const node_allocator<U> &) const { return false; }
+	};
+};
+
+#endif
@@ -0,0 +1,86 @@
+#include "perfect_hash.h"
+#include <strings.h>
+
+namespace rediscpp
+{
+	const uint8_t perfect_hash_type::empty_slot;
+	const size_t perfect_hash_type::max_count;
+	perfect_hash_type::perfect_hash_type()
+		: seed(0)
+		, mask(0)
+		, max_length(0)
+	{
+	}
+	///英字を小文字に畳み込んだFNV-1a
+	uint32_t perfect_hash_type::hash(const char * name, size_t length, uint32_t seed)
+	{
+		uint32_t h = 2166136261U ^ seed;
+		for (size_t i = 0; i < length; ++i) {
+			h = (h ^ static_cast<uint8_t>(name[i] | 0x20)) * 16777619U;
+		}
+		return h ^ (h >> 15);
+	}
+	///名前を登録して位置を返す、登録済みならその位置
+	///@note 登録後はbuildするまで検索できない
+	size_t perfect_hash_type::insert(const std::string & name)
+	{
+		std::string upper = name;
+		std::transform(upper.begin(), upper.end(), upper.begin(), toupper);
+		auto it = std::find(names.begin(), names.end(), upper);
+		if (it != names.end()) {
+			return it - names.begin();
+		}
+		if (max_count <= names.size()) {
+			throw std::runtime_error("perfect_hash_type: too many names");
+		}
+		names.push_back(upper);
+		max_length = std::max(max_length, upper.size());
+		slots.clear();
+		return names.size() - 1;
+	}
+	///すべての名前が別のスロットに入るseedを探す
+	///@note 名前の数の8倍以上の表から始め、見つからなければ表を広げる
+	void perfect_hash_type::build()
+	{
+		size_t slot_count = 16;
+		while (slot_count < names.size() * 8) {
+			slot_count *= 2;
+		}
+		for (;; slot_count *= 2) {
+			for (uint32_t s = 0; s < 65536; ++s) {
+				std::vector<uint8_t> candidate(slot_count, empty_slot);
+				bool collided = false;
+				for (size_t i = 0, n = names.size(); i < n; ++i) {
+					uint8_t & slot = candidate[hash(names[i].data(), names[i].size(), s) & (slot_count - 1)];
+					if (slot != empty_slot) {
+						collided = true;
+						break;
+					}
+					slot = static_cast<uint8_t>(i);
+				}
+				if (!collided) {
+					slots.swap(candidate);
+					seed = s;
+					mask = slot_count - 1;
+					return;
+				}
+			}
+		}
+	}
+	///@return 登録した位置、無ければ-1
+	int perfect_hash_type::find(const char * name, size_t length) const
+	{
+		if (slots.empty() || !length || max_length < length) {
+			return -1;
+		}
+		const uint8_t index = slots[hash(name, length, seed) & mask];
+		if (index == empty_slot) {
+			return -1;
+		}
+		const std::string & candidate = names[index];
+		if (candidate.size() != length || strncasecmp(candidate.data(), name, length) != 0) {
+			return -1;
+		}
+		return index;
+	}
+};
@@ -0,0 +1,33 @@
+#ifndef INCLUDE_REDIS_CPP_PERFECT_HASH_H
+#define INCLUDE_REDIS_CPP_PERFECT_HASH_H
+
+#include "common.h"
+
+namespace rediscpp
+{
+	///大文字小文字を区別しない名前の完全ハッシュ
+	///@note 登録後のbuildで衝突しないseedを探すので、検索は一度のハッシュと一度の比較で済む
+	class perfect_hash_type
+	{
+		std::vector<std::string> names;///<大文字で保持する
+		std::vector<uint8_t> slots;///<namesの位置、空きはempty_slot
+		uint32_t seed;
+		uint32_t mask;
+		size_t max_length;
+		static const uint8_t empty_slot = 0xFF;
+	public:
+		static const size_t max_count = empty_slot;
+		perfect_hash_type();
+		static uint32_t hash(const char * name, size_t length, uint32_t seed);
+		size_t insert(const std::string & name);
+		int find(const char * name, size_t length) const;
+		int find(const std::string & name) const { return find(name.data(), name.size()); }
+		void build();
+		size_t size() const { return names.size(); }
+		size_t get_slot_count() const { return slots.size(); }
+		uint32_t get_seed() const { return seed; }
+		const std::string & get_name(size_t index) const { return names[index]; }
+	};
+};
+
+#endif
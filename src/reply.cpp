@@ -0,0 +1,167 @@
+#include "reply.h"
+
+namespace rediscpp
+{
+	static const char digit_pairs[] =
+		"00010203040506070809"
+		"10111213141516171819"
+		"20212223242526272829"
+		"30313233343536373839"
+		"40414243444546474849"
+		"50515253545556575859"
+		"60616263646566676869"
+		"70717273747576777879"
+		"80818283848586878889"
+		"90919293949596979899";
+	static const uint64_t powers_of_10[] = {
+		1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+		10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+		1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL,
+	};
+	///桁数をビット長から求める
+	static inline size_t count_digits(uint64_t value)
+	{
+		const size_t t = ((64 - __builtin_clzll(value | 1)) * 1233) >> 12;
+		return t - ((value | 1) < powers_of_10[t]) + 1;
+	}
+	size_t write_decimal(char * dst, int64_t value)
+	{
+		size_t sign = 0;
+		uint64_t v = value;
+		if (value < 0) {
+			*dst++ = '-';
+			v = 0 - v;
+			sign = 1;
+		}
+		const size_t digits = count_digits(v);
+		char * p = dst + digits;
+		while (100 <= v) {
+			const size_t i = (v % 100) * 2;
+			v /= 100;
+			p -= 2;
+			memcpy(p, digit_pairs + i, 2);
+		}
+		if (10 <= v) {
+			memcpy(p - 2, digit_pairs + v * 2, 2);
+		} else {
+			p[-1] = static_cast<char>('0' + v);
+		}
+		return sign + digits;
+	}
+	///":", "*", "$"の小さな値のヘッダ
+	struct shared_header_table_type
+	{
+		static const size_t width = 8;
+		char data[3][reply_encoder_type::shared_header_count][width];
+		uint8_t length[3][reply_encoder_type::shared_header_count];
+		shared_header_table_type()
+		{
+			const char types[3] = {':', '*', '$'};
+			for (int t = 0; t < 3; ++t) {
+				for (int64_t i = 0; i < reply_encoder_type::shared_header_count; ++i) {
+					char * dst = data[t][i];
+					memset(dst, 0, width);
+					size_t len = 0;
+					dst[len++] = types[t];
+					len += write_decimal(dst + len, i);
+					dst[len++] = '\r';
+					dst[len++] = '\n';
+					length[t][i] = static_cast<uint8_t>(len);
+				}
+			}
+		}
+		static int index(char type)
+		{
+			return type == ':' ? 0 : (type == '*' ? 1 : 2);
+		}
+	};
+	static const shared_header_table_type shared_headers;
+
+	uint8_t * reply_encoder_type::prepare(size_t len)
+	{
+		if (buffer) {
+			return buffer->prepare(len);
+		}
+		cache_offset = cache->size();
+		cache->resize(cache_offset + len);
+		return &(*cache)[cache_offset];
+	}
+	void reply_encoder_type::commit(size_t len)
+	{
+		if (buffer) {
+			buffer->commit(len);
+		} else {
+			cache->resize(cache_offset + len);
+		}
+	}
+	void reply_encoder_type::header(char type, int64_t value)
+	{
+		if (0 <= value && value < shared_header_count) {
+			const int t = shared_header_table_type::index(type);
+			uint8_t * dst = prepare(shared_header_table_type::width);
+			memcpy(dst, shared_headers.data[t][value], shared_header_table_type::width);
+			commit(shared_headers.length[t][value]);
+			return;
+		}
+		char * dst = reinterpret_cast<char *>(prepare(max_header_length));
+		size_t len = 0;
+		dst[len++] = type;
+		len += write_decimal(dst + len, value);
+		dst[len++] = '\r';
+		dst[len++] = '\n';
+		commit(len);
+	}
+	void reply_encoder_type::raw(const void * data, size_t len)
+	{
+		if (!len) {
+			return;
+		}
+		if (buffer) {
+			buffer->append(data, len);
+		} else {
+			const uint8_t * src = reinterpret_cast<const uint8_t *>(data);
+			cache->insert(cache->end(), src, src + len);
+		}
+	}
+	///ヘッダと値と改行を一つの領域に書き込む
+	void reply_encoder_type::bulk(const char * data, size_t len)
+	{
+		if (len + max_header_length + 2 <= send_chunk_type::capacity) {
+			char * dst = reinterpret_cast<char *>(prepare(len + max_header_length + 2));
+			size_t pos = 0;
+			if (len < static_cast<size_t>(shared_header_count)) {
+				memcpy(dst, shared_headers.data[2][len], shared_header_table_type::width);
+				pos = shared_headers.length[2][len];
+			} else {
+				dst[pos++] = '$';
+				pos += write_decimal(dst + pos, len);
+				dst[pos++] = '\r';
+				dst[pos++] = '\n';
+			}
+			memcpy(dst + pos, data, len);
+			pos += len;
+			dst[pos++] = '\r';
+			dst[pos++] = '\n';
+			commit(pos);
+			return;
+		}
+		header('$', len);
+		raw(data, len);
+		raw("\r\n", 2);
+	}
+	///大きな値は参照を送信バッファに積む
+	void reply_encoder_type::bulk(const std::shared_ptr<const std::string> & value)
+	{
+		if (!value) {
+			null();
+			return;
+		}
+		if (!buffer || value->size() < zero_copy_threshold) {
+			bulk(value->data(), value->size());
+			return;
+		}
+		header('$', value->size());
+		buffer->append(value);
+		raw("\r\n", 2);
+	}
+};
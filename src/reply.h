@@ -0,0 +1,40 @@
+#ifndef INCLUDE_REDIS_CPP_REPLY_H
+#define INCLUDE_REDIS_CPP_REPLY_H
+
+#include "buffer.h"
+
+namespace rediscpp
+{
+	///整数を10進数で書き込み、書き込んだ長さを返す
+	///@note dstには20バイト以上必要、終端文字は書かない
+	size_t write_decimal(char * dst, int64_t value);
+
+	///RESPの応答を送信バッファへ直接書き込む
+	///@note 小さな数値のヘッダは事前に作った表から写すので、書式化や確保を行わない
+	class reply_encoder_type
+	{
+		send_buffer_type * buffer;
+		std::vector<uint8_t> * cache;///<ファイル送信中の書き込み先
+		size_t cache_offset;
+		uint8_t * prepare(size_t len);
+		void commit(size_t len);
+		void header(char type, int64_t value);
+	public:
+		static const size_t max_header_length = 24;
+		static const int64_t shared_header_count = 1024;///<事前に作るヘッダの数
+		static const size_t zero_copy_threshold = 16 * 1024;///<これ以上の値はコピーせずに送信する
+		explicit reply_encoder_type(send_buffer_type & buffer_) : buffer(&buffer_), cache(NULL), cache_offset(0) {}
+		explicit reply_encoder_type(std::vector<uint8_t> & cache_) : buffer(NULL), cache(&cache_), cache_offset(0) {}
+		void raw(const void * data, size_t len);
+		void raw(const std::string & data) { raw(data.data(), data.size()); }
+		void integer(int64_t value) { header(':', value); }
+		void multi_bulk(size_t count) { header('*', count); }
+		void null() { raw("$-1\r\n", 5); }
+		void null_multi_bulk() { raw("*-1\r\n", 5); }
+		void bulk(const char * data, size_t len);
+		void bulk(const std::string & value) { bulk(value.data(), value.size()); }
+		void bulk(const std::shared_ptr<const std::string> & value);
+	};
+};
+
+#endif
@@ -240,22 +240,24 @@ namespace rediscpp
 	std::shared_ptr<type_list> type_list::input(std::shared_ptr<file_type> & src)
 	{
 		std::shared_ptr<type_list> result(new type_list());
-		std::list<std::string> & value = result->value;
+		type_list::container_type & value = result->value;
 		size_t & size = result->count;
 		size = read_len(src);
 		for (size_t i = 0, n = size; i < n; ++i) {
 			value.push_back(read_string(src));
+			result->bytes += get_element_memory(value.back());
 		}
 		return result;
 	}
 	std::shared_ptr<type_list> type_list::input(std::pair<std::string::const_iterator,std::string::const_iterator> & src)
 	{
 		std::shared_ptr<type_list> result(new type_list());
-		std::list<std::string> & value = result->value;
+		type_list::container_type & value = result->value;
 		size_t & size = result->count;
 		size = read_len(src);
 		for (size_t i = 0, n = size; i < n; ++i) {
 			value.push_back(read_string(src));
+			result->bytes += get_element_memory(value.back());
 		}
 		return result;
 	}
@@ -276,20 +278,18 @@ namespace rediscpp
 	std::shared_ptr<type_set> type_set::input(std::shared_ptr<file_type> & src)
 	{
 		std::shared_ptr<type_set> result(new type_set());
-		std::set<std::string> & value = result->value;
 		size_t size = read_len(src);
 		for (size_t i = 0, n = size; i < n; ++i) {
-			value.insert(read_string(src));
+			result->insert(read_string(src));
 		}
 		return result;
 	}
 	std::shared_ptr<type_set> type_set::input(std::pair<std::string::const_iterator,std::string::const_iterator> & src)
 	{
 		std::shared_ptr<type_set> result(new type_set());
-		std::set<std::string> & value = result->value;
 		size_t size = read_len(src);
 		for (size_t i = 0, n = size; i < n; ++i) {
-			value.insert(read_string(src));
+			result->insert(read_string(src));
 		}
 		return result;
 	}
@@ -446,31 +446,32 @@ namespace rediscpp
 			f->printf("REDIS%04d", version);
 			for (size_t i = 0, n = databases.size(); i < n; ++i ) {
 				auto & db = *databases[i];
-				auto range = db.range();
-				if (range.first == range.second) {
+				if (!db.get_dbsize()) {
 					continue;
 				}
 				//selectdb i
 				f->write8(op_selectdb);
 				type_interface::write_len(f, i);
 
-				for (auto it = range.first; it != range.second; ++it) {
-					auto & kv = *it;
-					auto & key = kv.first;
-					auto & expire = kv.second.first;
-					auto & value = kv.second.second;
-					if (expire->is_expired(current)) {
-						continue;
+				for (size_t shard = 0, shard_count = db.get_shard_count(); shard < shard_count; ++shard) {
+					auto range = db.range(shard);
+					for (auto it = range.first; it != range.second; ++it) {
+						auto & entry = *it;
+						auto & key = entry.key;
+						auto & value = entry.value;
+						if (db.is_expired(shard, entry, current)) {
+							continue;
+						}
+						if (entry.is_expiring()) {
+							f->write8(op_expire_ms);
+							f->write64(db.get_expire_ms(shard, entry));
+						}
+						f->write8(value->get_type());
+						type_interface::write_string(f, key);
+						std::string value_str;
+						dump(value_str, value);
+						f->write(value_str);
 					}
-					if (expire->is_expiring()) {
-						f->write8(op_expire_ms);
-						f->write64(expire->at().get_ms());
-					}
-					f->write8(value->get_type());
-					type_interface::write_string(f, key);
-					std::string value_str;
-					dump(value_str, value);
-					f->write(value_str);
 				}
 			}
 			f->write8(op_eof);
@@ -503,7 +504,7 @@ namespace rediscpp
 			//全ロック
 			std::vector<std::shared_ptr<database_write_locker>> lockers(databases.size());
 			for (size_t i = 0; i < databases.size(); ++i) {
-				lockers[i].reset(new database_write_locker(databases[i].get(), NULL, false));
+				lockers[i].reset(new database_write_locker(databases[i].get(), databases[i]->get_all_shards(), false));
 			}
 			//@todo ファイルから読むのがslaveof以外でおきるなら、ここは修正が必要
 			slave = true;
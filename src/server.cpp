@@ -3,6 +3,7 @@
 #include "master.h"
 #include "log.h"
 #include "file.h"
+#include "type_string.h"
 #include <ctype.h>
 #include <signal.h>
 
@@ -13,11 +14,38 @@ namespace rediscpp
 		, slave(false)
 		, slave_mutex(true)
 		, listening_port(0)
+		, poll_batch_size(64)
+		, reactor_mode(false)
+		, poll_engine(epoll_engine)
+		, proto_max_bulk_len(default_proto_max_bulk_len)
+		, command_count(0)
+		, batch_count(0)
+		, batched_command_count(0)
+		, expired_key_count(0)
+		, expired_keys_per_sec(0)
+		, expire_cycle_count(0)
+		, expire_cycle_last_ns(0)
+		, expire_cycle_max_ns(0)
+		, expire_cycle_interval_ms(expire_normal_interval_ms)
+		, expire_window_start_ns(dictionary_type::get_time_ns())
+		, expire_window_count(0)
+		, expire_shard_cursor(0)
+		, maxmemory(0)
+		, maxmemory_policy(noeviction_policy)
+		, evict_cursor(0)
+		, nothing_evictable(false)
+		, evicted_keys(0)
+		, eviction_count(0)
+		, eviction_total_ns(0)
+		, eviction_max_ns(0)
+		, oom_rejected_count(0)
+		, watching_clients(0)
 	{
 		signal(SIGPIPE, SIG_IGN);
+		lazyfree.reset(new lazyfree_type());
 		databases.resize(1);
 		for (auto it = databases.begin(), end = databases.end(); it != end; ++it) {
-			it->reset(new database_type());
+			it->reset(new database_type(database_type::default_shard_count, lazyfree));
 		}
 		build_api_map();
 		bits_table.resize(256);
@@ -38,53 +66,70 @@ namespace rediscpp
 		bool is_valid;
 		listening_port = atou16(port, is_valid);
 		addr->set_port(listening_port);
-		listening = socket_type::create(*addr);
-		listening->set_reuse();
-		if (!listening->bind(addr)) {
-			return false;
-		}
-		if (!listening->listen(512)) {
-			return false;
+		if (reactor_mode && threads <= 0) {
+			lputs(__FILE__, __LINE__, info_level, "reactor mode needs worker threads, use shared poll");
+			reactor_mode = false;
+		}
+		//reactorモードでは各スレッドが待ち受ける
+		if (!reactor_mode) {
+			listening = socket_type::create(*addr);
+			listening->set_reuse();
+			if (!listening->bind(addr)) {
+				return false;
+			}
+			if (!listening->listen(512)) {
+				return false;
+			}
+			listening->set_extra(this);
+			listening->set_callback(server_callback);
+			listening->set_nonblocking();
 		}
-		listening->set_extra(this);
-		listening->set_callback(server_callback);
-		listening->set_nonblocking();
 
 		timer = timer_type::create();
 		timer->set_extra(this);
 		timer->set_callback(timer_callback);
 
+		expire_timer = timer_type::create();
+		expire_timer->set_extra(this);
+		expire_timer->set_callback(expire_timer_callback);
+		expire_timer->start(0, expire_normal_interval_ms * 1000000, true);
+
 		event = event_type::create();
 		event->set_extra(this);
 		event->set_callback(event_callback);
 
-		poll = poll_type::create();
-		poll->append(listening);
+		poll = poll_type::create(poll_engine);
+		if (listening) {
+			poll->append(listening);
+		}
 		poll->append(timer);
+		poll->append(expire_timer);
 		poll->append(event);
 
-		const int base_poll_count = 3;//listening, timer & event
-		if (threads) {
+		const int base_poll_count = listening ? 4 : 3;//listening, timer, expire_timer & event
+		if (reactor_mode) {
+			if (!startup_reactors(addr, threads)) {
+				return false;
+			}
+		} else if (threads) {
 			startup_threads(threads);
 		}
+		lazyfree->start();
+		poll_batch_type batch(poll_batch_size);
 		while (true) {
 			try {
-				process();
+				process(batch);
 				//メインスレッドだけの機能
 				if (shutdown) {
-					if (poll->get_count() == base_poll_count) {
+					bool idle = (poll->get_count() == base_poll_count);
+					for (auto it = reactors.begin(), end = reactors.end(); idle && it != end; ++it) {
+						idle = (*it)->is_idle();
+					}
+					if (idle) {
 						lputs(__FILE__, __LINE__, info_level, "quit server, no client now");
 						break;
 					}
 				}
-				//ガベージコレクト
-				{
-					timeval_type tv;
-					for (int i = 0, n = databases.size(); i < n; ++i) {
-						auto db = writable_db(i, NULL);
-						db->flush_expiring_key(tv);
-					}
-				}
 			} catch (std::exception e) {
 				lprintf(__FILE__, __LINE__, info_level, "exception:%s", e.what());
 			} catch (...) {
@@ -143,31 +188,47 @@ namespace rediscpp
 		}
 		server->on_timer(t, events);
 	}
-	void server_type::on_server(socket_type * s, int events)
+	void server_type::expire_timer_callback(pollable_type * p, int events)
 	{
-		std::shared_ptr<socket_type> cs = s->accept();
-		if (!cs) {
+		timer_type * t = dynamic_cast<timer_type *>(p);
+		if (!t) {
 			return;
 		}
-		//新規受け付けは停止中
-		if (shutdown) {
-			cs->shutdown(true, true);
-			cs->close();
+		server_type * server = reinterpret_cast<server_type *>(t->get_extra());
+		if (!server) {
 			return;
 		}
-		cs->set_callback(client_callback);
-		cs->set_nonblocking();
-		cs->set_nodelay();
-		std::shared_ptr<client_type> ct(new client_type(*this, cs, password));
-		ct->set(ct);
-		cs->set_extra(this);
-		cs->set_extra2(ct.get());
-		ct->process();
-		if (cs->done()) {
-			cs->close();
-		} else {
-			append_client(ct);
-		}
+		server->on_expire_timer(t, events);
+	}
+	///@note io_uringのmultishot acceptでは一度の通知で複数受け付けているので、受け付け済みのソケットが無くなるまで続ける
+	void server_type::on_server(socket_type * s, int events)
+	{
+		do {
+			std::shared_ptr<socket_type> cs = s->accept();
+			if (!cs) {
+				return;
+			}
+			//新規受け付けは停止中
+			if (shutdown) {
+				cs->shutdown(true, true);
+				cs->close();
+				continue;
+			}
+			cs->set_callback(client_callback);
+			cs->set_nonblocking();
+			cs->set_nodelay();
+			std::shared_ptr<client_type> ct(new client_type(*this, cs, password));
+			ct->set(ct);
+			ct->set_reactor(reinterpret_cast<reactor_type *>(s->get_extra2()));
+			cs->set_extra(this);
+			cs->set_extra2(ct.get());
+			ct->process();
+			if (cs->done()) {
+				cs->close();
+			} else {
+				append_client(ct);
+			}
+		} while (s->has_accepted());
 	}
 	void server_type::on_event(event_type * e, int events)
 	{
@@ -197,6 +258,11 @@ namespace rediscpp
 					propagete(job->arguments, true);
 				}
 				break;
+			case job_type::unmonitor_type:
+				monitors.erase(job->client);
+				monitoring = ! monitors.empty();
+				clients.erase(job->client->client.get());
+				break;
 			}
 		}
 		e->mod();
@@ -208,6 +274,194 @@ namespace rediscpp
 		}
 		t->mod();
 	}
+	void server_type::on_expire_timer(timer_type * t, int events)
+	{
+		if (t->recv()) {
+			const uint64_t interval_ms = expire_cycle();
+			expire_cycle_interval_ms = interval_ms;
+			t->start(interval_ms / 1000, (interval_ms % 1000) * 1000000, true);
+		}
+		t->mod();
+	}
+	///有効期限の切れたキーの削除と辞書の移行を、合わせてexpire_cycle_budget_nsの間だけ行う
+	///@note shard毎にexpire_batch_size個ずつロックして消し、時間切れで止まったshardから次の周期を始める
+	///@return 次の周期までの時間(ms)
+	uint64_t server_type::expire_cycle()
+	{
+		const uint64_t start = dictionary_type::get_time_ns();
+		const uint64_t deadline = start + expire_cycle_budget_ns;
+		timeval_type tv;
+		uint64_t expired = 0;
+		size_t expiring = 0;
+		bool exhausted = false;
+		bool rehashing = false;
+		const size_t shard_count = databases.front()->get_shard_count();
+		const size_t total = databases.size() * shard_count;
+		for (size_t visited = 0; visited < total && !exhausted; ++visited) {
+			const size_t position = (expire_shard_cursor + visited) % total;
+			const int i = static_cast<int>(position / shard_count);
+			const size_t shard = position % shard_count;
+			auto & db = databases[i];
+			const shard_mask_type mask = static_cast<shard_mask_type>(1) << shard;
+			while (true) {
+				auto locker = writable_db(i, NULL, mask, false);
+				const size_t erased = db->expire_keys(shard, tv, expire_batch_size);
+				expired += erased;
+				if (erased < expire_batch_size) {
+					expiring += db->get_expiring_count(shard);
+					const uint64_t now = dictionary_type::get_time_ns();
+					if (now < deadline && db->rehash(shard, deadline - now)) {
+						rehashing = true;
+					}
+					break;
+				}
+				if (deadline <= dictionary_type::get_time_ns()) {
+					break;
+				}
+			}
+			if (deadline <= dictionary_type::get_time_ns()) {
+				//残りは次の周期で、このshardから行う
+				exhausted = true;
+				expire_shard_cursor = position;
+				rehashing = rehashing || 0 < dictionary_type::rehash_active;
+			}
+		}
+		const uint64_t end = dictionary_type::get_time_ns();
+		const uint64_t elapsed = end - start;
+		++expire_cycle_count;
+		expire_cycle_last_ns = elapsed;
+		if (expire_cycle_max_ns < elapsed) {
+			expire_cycle_max_ns = elapsed;
+		}
+		expired_key_count += expired;
+		expire_window_count += expired;
+		if (expire_window_start_ns + 1000000000ULL <= end) {
+			expired_keys_per_sec = expire_window_count * 1000000000ULL / (end - expire_window_start_ns);
+			expire_window_start_ns = end;
+			expire_window_count = 0;
+		}
+		//時間内に終わらなければ、まだ期限の切れたキーが残っている
+		if (exhausted || rehashing) {
+			return expire_fast_interval_ms;
+		}
+		return expiring ? expire_normal_interval_ms : expire_idle_interval_ms;
+	}
+	namespace
+	{
+		const char * const maxmemory_policy_names[] = { "noeviction", "allkeys-random", "volatile-ttl", "allkeys-lru", "allkeys-lfu", "volatile-lfu" };
+	}
+	bool server_type::parse_maxmemory_policy(const std::string & name, maxmemory_policies & policy)
+	{
+		for (size_t i = 0; i < sizeof(maxmemory_policy_names) / sizeof(*maxmemory_policy_names); ++i) {
+			if (name == maxmemory_policy_names[i]) {
+				policy = static_cast<maxmemory_policies>(i);
+				return true;
+			}
+		}
+		return false;
+	}
+	///LFUの方針では、値の参照の記録をLFUに切り替え、LRUとLFUでは共有の整数を使わない
+	void server_type::set_maxmemory_policy(maxmemory_policies policy)
+	{
+		maxmemory_policy = policy;
+		type_interface::lfu_mode = (policy == allkeys_lfu_policy || policy == volatile_lfu_policy);
+		type_string::sharing_integers = !type_interface::lfu_mode && policy != allkeys_lru_policy;
+	}
+	///書き込む値に共有の整数を使えるか
+	///@note WATCHは値の更新時間で変更を調べ、共有の値の更新時間はキー毎に変わらないので、WATCH中のクライアントがいれば使わない
+	///@note 書き込むキーのshardのロックを保持して呼ぶ、WATCHは数を増やしてから同じロックで値を調べるので、間に入った書き込みは値の違いで分かる
+	bool server_type::is_sharing_integers() const
+	{
+		return type_string::sharing_integers && !watching_clients;
+	}
+	const char * server_type::get_maxmemory_policy_name(maxmemory_policies policy)
+	{
+		return maxmemory_policy_names[policy];
+	}
+	///解放待ちの値は、すぐに無くなるので除いて比べる
+	bool server_type::is_over_maxmemory() const
+	{
+		if (!maxmemory) {
+			return false;
+		}
+		const int64_t used = static_cast<int64_t>(get_used_memory()) - static_cast<int64_t>(lazyfree_type::pending_bytes);
+		return static_cast<int64_t>(maxmemory) < used;
+	}
+	///プロセスの常駐メモリのバイト数、取れなければ0
+	size_t server_type::get_used_memory_rss()
+	{
+		int fd = ::open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			return 0;
+		}
+		char buf[128];
+		ssize_t len = ::read(fd, buf, sizeof(buf) - 1);
+		::close(fd);
+		if (len <= 0) {
+			return 0;
+		}
+		buf[len] = '\0';
+		unsigned long long pages = 0, resident = 0;
+		if (sscanf(buf, "%llu %llu", &pages, &resident) != 2) {
+			return 0;
+		}
+		return static_cast<size_t>(resident) * sysconf(_SC_PAGESIZE);
+	}
+	///maxmemoryを超えていれば、下回るまでpolicyに従ってキーを消す
+	///@note ロックを保持していない時に呼び、一つのshardだけをロックして最大eviction_batch_size個消し、shardを順に回る
+	///@note eviction_budget_nsを過ぎたら、超えたままでも止めて次のコマンドで続ける
+	///@note 全てのshardに消せるキーが無ければ、次の書き込みまで全shardのロックを回らずにfalseを返す
+	///@return 消せるキーが無くなり、maxmemoryを超えたままならfalse
+	bool server_type::evict()
+	{
+		if (!is_over_maxmemory()) {
+			return true;
+		}
+		if (maxmemory_policy == noeviction_policy || nothing_evictable) {
+			return false;
+		}
+		const uint64_t start = dictionary_type::get_time_ns();
+		timeval_type current;
+		const size_t shard_count = databases.front()->get_shard_count();
+		const size_t total = databases.size() * shard_count;
+		uint64_t evicted = 0;
+		size_t failures = 0;//続けて消せなかったshardの数
+		bool result = true;
+		while (is_over_maxmemory()) {
+			if (total <= failures) {
+				nothing_evictable = true;
+				result = false;
+				break;
+			}
+			if (start + eviction_budget_ns <= dictionary_type::get_time_ns()) {
+				break;
+			}
+			const size_t position = evict_cursor++ % total;
+			const int i = static_cast<int>(position / shard_count);
+			const size_t shard = position % shard_count;
+			auto locker = writable_db(i, NULL, static_cast<shard_mask_type>(1) << shard, false);
+			size_t erased = 0;
+			while (erased < eviction_batch_size && databases[i]->evict(shard, maxmemory_policy, current)) {
+				++erased;
+				if (!is_over_maxmemory()) {
+					break;
+				}
+			}
+			evicted += erased;
+			failures = erased ? 0 : failures + 1;
+		}
+		if (!evicted) {
+			return result;
+		}
+		const uint64_t elapsed = dictionary_type::get_time_ns() - start;
+		evicted_keys += evicted;
+		++eviction_count;
+		eviction_total_ns += elapsed;
+		uint64_t max_ns = eviction_max_ns;
+		while (max_ns < elapsed && !eviction_max_ns.compare_exchange_weak(max_ns, elapsed)) {
+		}
+		return result;
+	}
 	void server_type::on_client(socket_type * s, int events)
 	{
 		std::shared_ptr<client_type> client = reinterpret_cast<client_type *>(s->get_extra2())->get();
@@ -230,6 +484,12 @@ namespace rediscpp
 	}
 	void server_type::append_client(std::shared_ptr<client_type> client, bool now)
 	{
+		//monitorはメインスレッドで管理し、それ以外は受け付けたスレッドに登録する
+		reactor_type * reactor = client->get_reactor();
+		if (reactor && !client->is_monitor()) {
+			reactor->append(client);
+			return;
+		}
 		if (thread_pool.empty() || now) {
 			if (!client->is_master() && !client->is_monitor() && !client->is_slave()) {
 				poll->append(client->client);
@@ -254,6 +514,28 @@ namespace rediscpp
 	}
 	void server_type::remove_client(std::shared_ptr<client_type> client, bool now)
 	{
+		reactor_type * reactor = client->get_reactor();
+		if (reactor) {
+			if (!reactor->is_current()) {
+				reactor->post(std::shared_ptr<job_type>(new job_type(job_type::del_type, client)));
+				return;
+			}
+			if (client->is_blocked()) {
+				unblocked(client);
+			}
+			client->client->close();
+			if (client->is_monitor()) {
+				std::shared_ptr<job_type> job(new job_type(job_type::unmonitor_type, client));
+				jobs.push(job);
+				event->send();
+			}
+			if (client->is_slave()) {
+				mutex_locker locker(slave_mutex);
+				slaves.erase(client);
+			}
+			reactor->clients.erase(client->client.get());
+			return;
+		}
 		if (thread_pool.empty() || now) {
 			if (client->is_blocked()) {
 				unblocked(client);
@@ -369,16 +651,17 @@ namespace rediscpp
 		//CLIENT KILL, LIST, GETNAME, SETNAME
 		//CONFIG GET, SET, RESETSTAT
 		//DEBUG OBJECT, SETFAULT
-		//INFO, SLOWLOG, 
-		api_map["DBSIZE"].set(&server_type::api_dbsize);
-		api_map["FLUSHALL"].set(&server_type::api_flushall).write();
-		api_map["FLUSHDB"].set(&server_type::api_flushdb).write();
+		//SLOWLOG, 
+		api_map["DBSIZE"].set(&server_type::api_dbsize).batch();
+		api_map["FLUSHALL"].set(&server_type::api_flushall).argc(1,2).type("cc").write().shrink().dynamic();
+		api_map["FLUSHDB"].set(&server_type::api_flushdb).argc(1,2).type("cc").write().shrink();
 		api_map["SHUTDOWN"].set(&server_type::api_shutdown).argc(1,2).type("cc");
 		api_map["TIME"].set(&server_type::api_time);
 		api_map["SLAVEOF"].set(&server_type::api_slaveof).type("ccc");
 		api_map["SYNC"].set(&server_type::api_sync);
 		api_map["REPLCONF"].set(&server_type::api_replconf).argc_gte(3).type("ccc**");
 		api_map["MONITOR"].set(&server_type::api_monitor);
+		api_map["INFO"].set(&server_type::api_information).argc(1,2).type("cc");
 		//transaction API
 		api_map["MULTI"].set(&server_type::api_multi);
 		api_map["EXEC"].set(&server_type::api_exec);
@@ -386,112 +669,119 @@ namespace rediscpp
 		api_map["WATCH"].set(&server_type::api_watch).argc_gte(2).type("ck*");
 		api_map["UNWATCH"].set(&server_type::api_unwatch);
 		//keys API
-		//DUMP, OBJECT
+		//DUMP
 		//MIGRATE, RESTORE
-		api_map["KEYS"].set(&server_type::api_keys).type("cp");
-		api_map["DEL"].set(&server_type::api_del).argc_gte(2).type("ck*").write();
-		api_map["EXISTS"].set(&server_type::api_exists).type("ck");
-		api_map["EXPIRE"].set(&server_type::api_expire).type("ckt").write();
-		api_map["EXPIREAT"].set(&server_type::api_expireat).type("ckt").write();
-		api_map["PERSIST"].set(&server_type::api_persist).type("ck").write();
-		api_map["TTL"].set(&server_type::api_ttl).type("ck");
-		api_map["PTTL"].set(&server_type::api_pttl).type("ck");
+		api_map["KEYS"].set(&server_type::api_keys).type("cp").batch();
+		api_map["SCAN"].set(&server_type::api_scan).argc(2,8).type("cccccccc");
+		api_map["DEL"].set(&server_type::api_del).argc_gte(2).type("ck*").write().shrink().batch();
+		api_map["UNLINK"].set(&server_type::api_unlink).argc_gte(2).type("ck*").write().shrink().batch();
+		api_map["EXISTS"].set(&server_type::api_exists).type("ck").batch();
+		api_map["EXPIRE"].set(&server_type::api_expire).type("ckt").write().shrink().batch();
+		api_map["EXPIREAT"].set(&server_type::api_expireat).type("ckt").write().shrink().batch();
+		api_map["PERSIST"].set(&server_type::api_persist).type("ck").write().shrink().batch();
+		api_map["TTL"].set(&server_type::api_ttl).type("ck").batch();
+		api_map["PTTL"].set(&server_type::api_pttl).type("ck").batch();
 		api_map["MOVE"].set(&server_type::api_move).type("ckd").write();
 		api_map["RANDOMKEY"].set(&server_type::api_randomkey);
 		api_map["RENAME"].set(&server_type::api_rename).type("ckk").write();
 		api_map["RENAMENX"].set(&server_type::api_renamenx).type("ckk").write();
-		api_map["TYPE"].set(&server_type::api_type).type("ck");
-		api_map["SORT"].set(&server_type::api_sort).argc_gte(2).type("ck*").set_parser(&server_type::api_sort_store);
-		api_map["DUMP"].set(&server_type::api_dump).type("ck");
+		api_map["TYPE"].set(&server_type::api_type).type("ck").batch();
+		api_map["OBJECT"].set(&server_type::api_object).type("cck").batch();
+		api_map["SORT"].set(&server_type::api_sort).argc_gte(2).type("ck*").dynamic().set_parser(&server_type::api_sort_store);
+		api_map["DUMP"].set(&server_type::api_dump).type("ck").batch();
 		api_map["RESTORE"].set(&server_type::api_restore).type("cktv");
 		//strings api
-		api_map["GET"].set(&server_type::api_get).type("ck");
-		api_map["SET"].set(&server_type::api_set).argc(3,8).type("ckvccccc").write();
-		api_map["SETEX"].set(&server_type::api_setex).type("cktv").write();
-		api_map["SETNX"].set(&server_type::api_setnx).type("ckv").write();
-		api_map["PSETEX"].set(&server_type::api_psetex).type("cktv").write();
-		api_map["STRLEN"].set(&server_type::api_strlen).type("ck");
-		api_map["APPEND"].set(&server_type::api_append).type("ckv").write();
-		api_map["GETRANGE"].set(&server_type::api_getrange).type("cknn");
-		api_map["SUBSTR"].set(&server_type::api_getrange).type("cknn");//aka GETRANGE
-		api_map["SETRANGE"].set(&server_type::api_setrange).type("cknv").write();
-		api_map["GETSET"].set(&server_type::api_getset).type("ckv").write();
-		api_map["MGET"].set(&server_type::api_mget).argc_gte(2).type("ck*");
-		api_map["MSET"].set(&server_type::api_mset).argc_gte(3).type("ckv**").write();
-		api_map["MSETNX"].set(&server_type::api_msetnx).argc_gte(3).type("ckv**").write();
-		api_map["DECR"].set(&server_type::api_decr).type("ck").write();
-		api_map["DECRBY"].set(&server_type::api_decrby).type("ckn").write();
-		api_map["INCR"].set(&server_type::api_incr).type("ck").write();
-		api_map["INCRBY"].set(&server_type::api_incrby).type("ckn").write();
-		api_map["INCRBYFLOAT"].set(&server_type::api_incrbyfloat).type("ckn").write();
-		api_map["BITCOUNT"].set(&server_type::api_bitcount).argc(2,4).type("cknn");
+		api_map["GET"].set(&server_type::api_get).type("ck").batch();
+		api_map["SET"].set(&server_type::api_set).argc(3,8).type("ckvccccc").write().batch();
+		api_map["SETEX"].set(&server_type::api_setex).type("cktv").write().batch();
+		api_map["SETNX"].set(&server_type::api_setnx).type("ckv").write().batch();
+		api_map["PSETEX"].set(&server_type::api_psetex).type("cktv").write().batch();
+		api_map["STRLEN"].set(&server_type::api_strlen).type("ck").batch();
+		api_map["APPEND"].set(&server_type::api_append).type("ckv").write().batch();
+		api_map["GETRANGE"].set(&server_type::api_getrange).type("cknn").batch();
+		api_map["SUBSTR"].set(&server_type::api_getrange).type("cknn").batch();//aka GETRANGE
+		api_map["SETRANGE"].set(&server_type::api_setrange).type("cknv").write().batch();
+		api_map["GETSET"].set(&server_type::api_getset).type("ckv").write().batch();
+		api_map["MGET"].set(&server_type::api_mget).argc_gte(2).type("ck*").batch();
+		api_map["MSET"].set(&server_type::api_mset).argc_gte(3).type("ckv**").write().batch();
+		api_map["MSETNX"].set(&server_type::api_msetnx).argc_gte(3).type("ckv**").write().batch();
+		api_map["DECR"].set(&server_type::api_decr).type("ck").write().batch();
+		api_map["DECRBY"].set(&server_type::api_decrby).type("ckn").write().batch();
+		api_map["INCR"].set(&server_type::api_incr).type("ck").write().batch();
+		api_map["INCRBY"].set(&server_type::api_incrby).type("ckn").write().batch();
+		api_map["INCRBYFLOAT"].set(&server_type::api_incrbyfloat).type("ckn").write().batch();
+		api_map["BITCOUNT"].set(&server_type::api_bitcount).argc(2,4).type("cknn").batch();
 		api_map["BITOP"].set(&server_type::api_bitop).argc_gte(4).type("cckk*");
-		api_map["GETBIT"].set(&server_type::api_getbit).type("ckn");
-		api_map["SETBIT"].set(&server_type::api_setbit).type("cknv").write();
+		api_map["GETBIT"].set(&server_type::api_getbit).type("ckn").batch();
+		api_map["SETBIT"].set(&server_type::api_setbit).type("cknv").write().batch();
 		//lists api
-		api_map["BLPOP"].set(&server_type::api_blpop).argc_gte(3).type("ck*t").write();
-		api_map["BRPOP"].set(&server_type::api_brpop).argc_gte(3).type("ck*t").write();
+		api_map["BLPOP"].set(&server_type::api_blpop).argc_gte(3).type("ck*t").write().shrink();
+		api_map["BRPOP"].set(&server_type::api_brpop).argc_gte(3).type("ck*t").write().shrink();
 		api_map["BRPOPLPUSH"].set(&server_type::api_brpoplpush).type("ckkt").write();
-		api_map["LPUSH"].set(&server_type::api_lpush).argc_gte(3).type("ckv*").write();
-		api_map["RPUSH"].set(&server_type::api_rpush).argc_gte(3).type("ckv*").write();
-		api_map["LPUSHX"].set(&server_type::api_lpushx).type("ckv").write();
-		api_map["RPUSHX"].set(&server_type::api_rpushx).type("ckv").write();
-		api_map["LPOP"].set(&server_type::api_lpop).type("ck").write();
-		api_map["RPOP"].set(&server_type::api_rpop).type("ck").write();
-		api_map["LINSERT"].set(&server_type::api_linsert).type("ckccv").write();
-		api_map["LINDEX"].set(&server_type::api_lindex).type("ckn");
-		api_map["LLEN"].set(&server_type::api_llen).type("ck");
-		api_map["LRANGE"].set(&server_type::api_lrange).type("cknn");
-		api_map["LREM"].set(&server_type::api_lrem).type("cknv").write();
-		api_map["LSET"].set(&server_type::api_lset).type("cknv").write();
-		api_map["LTRIM"].set(&server_type::api_ltrim).type("cknn").write();
-		api_map["RPOPLPUSH"].set(&server_type::api_rpoplpush).type("ckk").write();
+		api_map["LPUSH"].set(&server_type::api_lpush).argc_gte(3).type("ckv*").write().batch();
+		api_map["RPUSH"].set(&server_type::api_rpush).argc_gte(3).type("ckv*").write().batch();
+		api_map["LPUSHX"].set(&server_type::api_lpushx).type("ckv").write().batch();
+		api_map["RPUSHX"].set(&server_type::api_rpushx).type("ckv").write().batch();
+		api_map["LPOP"].set(&server_type::api_lpop).type("ck").write().shrink().batch();
+		api_map["RPOP"].set(&server_type::api_rpop).type("ck").write().shrink().batch();
+		api_map["LINSERT"].set(&server_type::api_linsert).type("ckccv").write().batch();
+		api_map["LINDEX"].set(&server_type::api_lindex).type("ckn").batch();
+		api_map["LLEN"].set(&server_type::api_llen).type("ck").batch();
+		api_map["LRANGE"].set(&server_type::api_lrange).type("cknn").batch();
+		api_map["LREM"].set(&server_type::api_lrem).type("cknv").write().shrink().batch();
+		api_map["LSET"].set(&server_type::api_lset).type("cknv").write().batch();
+		api_map["LTRIM"].set(&server_type::api_ltrim).type("cknn").write().shrink().batch();
+		api_map["RPOPLPUSH"].set(&server_type::api_rpoplpush).type("ckk").write().batch();
 		//hashes api
-		api_map["HDEL"].set(&server_type::api_hdel).argc_gte(3).type("ckf*").write();
-		api_map["HEXISTS"].set(&server_type::api_hexists).type("ckf");
-		api_map["HGET"].set(&server_type::api_hget).type("ckf");
-		api_map["HGETALL"].set(&server_type::api_hgetall).type("ck");
-		api_map["HKEYS"].set(&server_type::api_hkeys).type("ck");
-		api_map["HVALS"].set(&server_type::api_hvals).type("ck");
-		api_map["HINCRBY"].set(&server_type::api_hincrby).type("ckfn").write();
-		api_map["HINCRBYFLOAT"].set(&server_type::api_hincrbyfloat).type("ckfn").write();
-		api_map["HLEN"].set(&server_type::api_hlen).type("ck");
-		api_map["HMGET"].set(&server_type::api_hmget).argc_gte(3).type("ckf*");
-		api_map["HMSET"].set(&server_type::api_hmset).argc_gte(4).type("ckfv**").write();
-		api_map["HSET"].set(&server_type::api_hset).type("ckfv").write();
-		api_map["HSETNX"].set(&server_type::api_hsetnx).type("ckfv").write();
+		api_map["HDEL"].set(&server_type::api_hdel).argc_gte(3).type("ckf*").write().shrink().batch();
+		api_map["HEXISTS"].set(&server_type::api_hexists).type("ckf").batch();
+		api_map["HGET"].set(&server_type::api_hget).type("ckf").batch();
+		api_map["HGETALL"].set(&server_type::api_hgetall).type("ck").batch();
+		api_map["HSCAN"].set(&server_type::api_hscan).argc(3,7).type("ckccccc").batch();
+		api_map["HKEYS"].set(&server_type::api_hkeys).type("ck").batch();
+		api_map["HVALS"].set(&server_type::api_hvals).type("ck").batch();
+		api_map["HINCRBY"].set(&server_type::api_hincrby).type("ckfn").write().batch();
+		api_map["HINCRBYFLOAT"].set(&server_type::api_hincrbyfloat).type("ckfn").write().batch();
+		api_map["HLEN"].set(&server_type::api_hlen).type("ck").batch();
+		api_map["HMGET"].set(&server_type::api_hmget).argc_gte(3).type("ckf*").batch();
+		api_map["HMSET"].set(&server_type::api_hmset).argc_gte(4).type("ckfv**").write().batch();
+		api_map["HSET"].set(&server_type::api_hset).type("ckfv").write().batch();
+		api_map["HSETNX"].set(&server_type::api_hsetnx).type("ckfv").write().batch();
 		//sets api
-		api_map["SADD"].set(&server_type::api_sadd).argc_gte(3).type("ckm*").write();
-		api_map["SCARD"].set(&server_type::api_scard).argc(2).type("ck");
-		api_map["SISMEMBER"].set(&server_type::api_sismember).argc(3).type("ckm");
-		api_map["SMEMBERS"].set(&server_type::api_smembers).argc(2).type("ck");
-		api_map["SMOVE"].set(&server_type::api_smove).argc(4).type("ckkm").write();
-		api_map["SPOP"].set(&server_type::api_spop).argc(2).type("ck").write();
-		api_map["SRANDMEMBER"].set(&server_type::api_srandmember).argc_gte(2).type("ckn");
-		api_map["SREM"].set(&server_type::api_srem).argc_gte(3).type("ckm*").write();
+		api_map["SADD"].set(&server_type::api_sadd).argc_gte(3).type("ckm*").write().batch();
+		api_map["SCARD"].set(&server_type::api_scard).argc(2).type("ck").batch();
+		api_map["SISMEMBER"].set(&server_type::api_sismember).argc(3).type("ckm").batch();
+		api_map["SMEMBERS"].set(&server_type::api_smembers).argc(2).type("ck").batch();
+		api_map["SSCAN"].set(&server_type::api_sscan).argc(3,7).type("ckccccc").batch();
+		api_map["SMOVE"].set(&server_type::api_smove).argc(4).type("ckkm").write().batch();
+		api_map["SPOP"].set(&server_type::api_spop).argc(2).type("ck").write().shrink().batch();
+		api_map["SRANDMEMBER"].set(&server_type::api_srandmember).argc_gte(2).type("ckn").batch();
+		api_map["SREM"].set(&server_type::api_srem).argc_gte(3).type("ckm*").write().shrink().batch();
 		api_map["SDIFF"].set(&server_type::api_sdiff).argc_gte(2).type("ck*");
-		api_map["SDIFFSTORE"].set(&server_type::api_sdiffstore).argc_gte(3).type("ckk*").write();
+		api_map["SDIFFSTORE"].set(&server_type::api_sdiffstore).argc_gte(3).type("ckk*").write().batch();
 		api_map["SINTER"].set(&server_type::api_sinter).argc_gte(2).type("ck*");
-		api_map["SINTERSTORE"].set(&server_type::api_sinterstore).argc_gte(3).type("ckk*").write();
+		api_map["SINTERSTORE"].set(&server_type::api_sinterstore).argc_gte(3).type("ckk*").write().batch();
 		api_map["SUNION"].set(&server_type::api_sunion).argc_gte(2).type("ck*");
-		api_map["SUNIONSTORE"].set(&server_type::api_sunionstore).argc_gte(3).type("ckk*").write();
+		api_map["SUNIONSTORE"].set(&server_type::api_sunionstore).argc_gte(3).type("ckk*").write().batch();
 		//zsets api
-		api_map["ZADD"].set(&server_type::api_zadd).argc_gte(4).type("cksm**").write();
-		api_map["ZCARD"].set(&server_type::api_zcard).argc(2).type("ck");
-		api_map["ZCOUNT"].set(&server_type::api_zcount).argc(4).type("cknn");
-		api_map["ZINCRBY"].set(&server_type::api_zincrby).argc(4).type("cknm").write();
-		api_map["ZINTERSTORE"].set(&server_type::api_zinterstore).argc_gte(4).type("cknc*").write();//@note タイプが多すぎてパース出来ない
-		api_map["ZUNIONSTORE"].set(&server_type::api_zunionstore).argc_gte(4).type("cknc*").write();//@note タイプが多すぎてパース出来ない
-		api_map["ZRANGE"].set(&server_type::api_zrange).argc_gte(4).type("cknnc");
-		api_map["ZREVRANGE"].set(&server_type::api_zrevrange).argc_gte(4).type("cknnc");
-		api_map["ZRANGEBYSCORE"].set(&server_type::api_zrangebyscore).argc_gte(4).type("cknncccc");
-		api_map["ZREVRANGEBYSCORE"].set(&server_type::api_zrevrangebyscore).argc_gte(4).type("cknncccc");
-		api_map["ZRANK"].set(&server_type::api_zrank).argc(3).type("ckm");
-		api_map["ZREVRANK"].set(&server_type::api_zrevrank).argc(3).type("ckm");
-		api_map["ZREM"].set(&server_type::api_zrem).argc_gte(3).type("ckm*").write();
-		api_map["ZREMRANGEBYRANK"].set(&server_type::api_zremrangebyrank).argc(4).type("cknn").write();
-		api_map["ZREMRANGEBYSCORE"].set(&server_type::api_zremrangebyscore).argc(4).type("cknn").write();
-		api_map["ZSCORE"].set(&server_type::api_zscore).argc(3).type("ckm");
+		api_map["ZADD"].set(&server_type::api_zadd).argc_gte(4).type("cksm**").write().batch();
+		api_map["ZCARD"].set(&server_type::api_zcard).argc(2).type("ck").batch();
+		api_map["ZCOUNT"].set(&server_type::api_zcount).argc(4).type("cknn").batch();
+		api_map["ZINCRBY"].set(&server_type::api_zincrby).argc(4).type("cknm").write().batch();
+		api_map["ZINTERSTORE"].set(&server_type::api_zinterstore).argc_gte(4).type("cknc*").write().batch().dynamic();//@note タイプが多すぎてパース出来ない
+		api_map["ZUNIONSTORE"].set(&server_type::api_zunionstore).argc_gte(4).type("cknc*").write().batch().dynamic();//@note タイプが多すぎてパース出来ない
+		api_map["ZRANGE"].set(&server_type::api_zrange).argc_gte(4).type("cknnc").batch();
+		api_map["ZREVRANGE"].set(&server_type::api_zrevrange).argc_gte(4).type("cknnc").batch();
+		api_map["ZRANGEBYSCORE"].set(&server_type::api_zrangebyscore).argc_gte(4).type("cknncccc").batch();
+		api_map["ZREVRANGEBYSCORE"].set(&server_type::api_zrevrangebyscore).argc_gte(4).type("cknncccc").batch();
+		api_map["ZRANK"].set(&server_type::api_zrank).argc(3).type("ckm").batch();
+		api_map["ZREVRANK"].set(&server_type::api_zrevrank).argc(3).type("ckm").batch();
+		api_map["ZREM"].set(&server_type::api_zrem).argc_gte(3).type("ckm*").write().shrink().batch();
+		api_map["ZREMRANGEBYRANK"].set(&server_type::api_zremrangebyrank).argc(4).type("cknn").write().shrink().batch();
+		api_map["ZREMRANGEBYSCORE"].set(&server_type::api_zremrangebyscore).argc(4).type("cknn").write().shrink().batch();
+		api_map["ZSCORE"].set(&server_type::api_zscore).argc(3).type("ckm").batch();
+		api_map["ZSCAN"].set(&server_type::api_zscan).argc(3,7).type("ckccccc").batch();
+		api_map.build();
 	}
 	server_type::~server_type()
 	{
@@ -501,10 +791,28 @@ namespace rediscpp
 	{
 		thread_pool.resize(threads);
 		for (auto it = thread_pool.begin(), end = thread_pool.end(); it != end; ++it) {
-			it->reset(new worker_type(*this));
+			it->reset(new worker_type(*this, std::shared_ptr<reactor_type>()));
 			(*it)->create();
 		}
 	}
+	///スレッド毎に待ち受けを作ってから、スレッドを起動する
+	bool server_type::startup_reactors(std::shared_ptr<address_type> address, int threads)
+	{
+		reactors.resize(threads);
+		for (auto it = reactors.begin(), end = reactors.end(); it != end; ++it) {
+			it->reset(new reactor_type(*this, poll_batch_size));
+			if (!(*it)->start(address)) {
+				reactors.clear();
+				return false;
+			}
+		}
+		thread_pool.resize(threads);
+		for (int i = 0; i < threads; ++i) {
+			thread_pool[i].reset(new worker_type(*this, reactors[i]));
+			thread_pool[i]->create();
+		}
+		return true;
+	}
 	void server_type::shutdown_threads()
 	{
 		if (thread_pool.empty()) {
@@ -520,33 +828,144 @@ namespace rediscpp
 			thread->join();
 		}
 		thread_pool.clear();
+		reactors.clear();
 	}
-	void server_type::process()
+	///イベントをまとめて受け取って処理する
+	///@note 再登録(EPOLL_CTL_MOD)は全てのイベントを処理した後にまとめて行う
+	void server_type::process(poll_batch_type & batch)
 	{
 		try
 		{
-			std::vector<epoll_event> events(1);
-			poll->wait(events, 1000);
-			for (auto it = events.begin(), end = events.end(); it != end; ++it) {
-				auto pollable = reinterpret_cast<pollable_type*>(it->data.ptr);
-				if (pollable) {
-					pollable->trigger(it->events);
-				}
-			}
+			poll->dispatch(batch, 1000);
 		} catch (const std::exception & e) {
 			lprintf(__FILE__, __LINE__, info_level, "exception %s", e.what());
 		} catch (...) {
 			lprintf(__FILE__, __LINE__, info_level, "exception");
 		}
 	}
-	worker_type::worker_type(server_type & server_)
+	worker_type::worker_type(server_type & server_, std::shared_ptr<reactor_type> reactor_)
 		: server(server_)
+		, batch(server_.get_poll_batch_size())
+		, reactor(reactor_)
 	{
 	}
 	void worker_type::run()
 	{
-		server.process();
+		if (reactor) {
+			reactor->process();
+		} else {
+			server.process(batch);
+		}
+	}
+	///処理中のスレッドのreactor
+	static __thread reactor_type * current_reactor = NULL;
+	reactor_type::reactor_type(server_type & server_, size_t batch_size)
+		: server(server_)
+		, batch(batch_size)
+	{
+	}
+	bool reactor_type::start(std::shared_ptr<address_type> address)
+	{
+		listening = socket_type::create(*address);
+		if (!listening) {
+			return false;
+		}
+		listening->set_reuse();
+		if (!listening->set_reuseport()) {
+			return false;
+		}
+		if (!listening->bind(address)) {
+			return false;
+		}
+		if (!listening->listen(512)) {
+			return false;
+		}
+		listening->set_extra(&server);
+		listening->set_extra2(this);
+		listening->set_callback(server_type::server_callback);
+		listening->set_nonblocking();
+
+		event = event_type::create();
+		event->set_extra(this);
+		event->set_callback(event_callback);
+
+		poll = poll_type::create(server.poll_engine);
+		poll->append(listening);
+		poll->append(event);
+		return true;
+	}
+	void reactor_type::process()
+	{
+		current_reactor = this;
+		try
+		{
+			poll->dispatch(batch, 1000);
+		} catch (const std::exception & e) {
+			lprintf(__FILE__, __LINE__, info_level, "exception %s", e.what());
+		} catch (...) {
+			lprintf(__FILE__, __LINE__, info_level, "exception");
+		}
+	}
+	bool reactor_type::is_current() const
+	{
+		return current_reactor == this;
+	}
+	void reactor_type::append(std::shared_ptr<client_type> client)
+	{
+		if (!is_current()) {
+			post(std::shared_ptr<job_type>(new job_type(job_type::add_type, client)));
+			return;
+		}
+		poll->append(client->client);
+		clients[client->client.get()] = client;
+	}
+	///他のスレッドから処理を依頼する
+	void reactor_type::post(std::shared_ptr<job_type> job)
+	{
+		jobs.push(job);
+		event->send();
+	}
+	void reactor_type::event_callback(pollable_type * p, int events)
+	{
+		event_type * e = dynamic_cast<event_type *>(p);
+		if (!e) {
+			return;
+		}
+		reactor_type * reactor = reinterpret_cast<reactor_type *>(e->get_extra());
+		if (!reactor) {
+			return;
+		}
+		reactor->on_event(e, events);
+	}
+	void reactor_type::on_event(event_type * e, int events)
+	{
+		e->recv();
+		while (true) {
+			auto job = jobs.pop(0);
+			if (!job) {
+				break;
+			}
+			switch (job->type) {
+			case job_type::add_type:
+				append(job->client);
+				break;
+			case job_type::del_type:
+				server.remove_client(job->client);
+				break;
+			default:
+				break;
+			}
+		}
+		e->mod();
 	}
+	///データベースをshard_count個のshardで作り直す
+	///@note startの前に呼ぶ
+	void server_type::set_shard_count(size_t shard_count)
+	{
+		for (auto it = databases.begin(), end = databases.end(); it != end; ++it) {
+			it->reset(new database_type(std::max<size_t>(1, shard_count), lazyfree));
+		}
+	}
 	database_write_locker server_type::writable_db(int index, client_type * client, bool rdlock)
 	{
 		if (slave && !rdlock) {
@@ -558,10 +977,26 @@ namespace rediscpp
 		}
 		return database_write_locker(databases.at(index).get(), client, rdlock);
 	}
+	///パイプラインのグループなど、まとめて使うshardを指定してロックする
+	database_write_locker server_type::writable_db(int index, client_type * client, shard_mask_type shards, bool rdlock)
+	{
+		if (slave && !rdlock) {
+			if (client) {
+				if (!client->is_master()) {
+					throw std::runtime_error("ERR could not change on slave mode");
+				}
+			}
+		}
+		return database_write_locker(databases.at(index).get(), shards, rdlock);
+	}
 	database_read_locker server_type::readable_db(int index, client_type * client)
 	{
 		return database_read_locker(databases.at(index).get(), client);
 	}
+	database_read_locker server_type::readable_db(int index, client_type * client, shard_mask_type shards)
+	{
+		return database_read_locker(databases.at(index).get(), client, shards);
+	}
 	database_write_locker server_type::writable_db(client_type * client, bool rdlock)
 	{
 		return writable_db(client->get_db_index(), client, rdlock);
@@ -580,6 +1015,6 @@ namespace rediscpp
 	{
 		if (!client) return;
 		mutex_locker locker(blocked_mutex);
-		blocked_clients.insert(client);
+		blocked_clients.erase(client);
 	}
 }
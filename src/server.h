@@ -6,6 +6,9 @@
 #include "thread.h"
 #include "type_interface.h"
 #include "database.h"
+#include "lazyfree.h"
+#include "perfect_hash.h"
+#include "argument_plan.h"
 
 namespace rediscpp
 {
@@ -26,13 +29,18 @@ namespace rediscpp
 	typedef bool (server_type::*api_function_type)(client_type * client);
 	struct api_info
 	{
+		std::string name;///<大文字のコマンド名
 		api_function_type function;
 		api_function_type parser;
 		size_t min_argc;
 		size_t max_argc;
 		//c : command, s : string, k : key, v : value, d : db index, t : time, i : integer, f : float
 		std::string arg_types;
+		argument_plan_type plan;///<arg_typesを解釈した引数の分類
 		bool writing;
+		bool batching;///<選択中のDBだけをwritingに合ったロックで使うので、パイプラインでまとめて実行できる
+		bool dynamic_keys;///<引数のキー以外にもアクセスするので、すべてのshardをロックする
+		bool shrinking;///<メモリを増やさないので、maxmemoryを超えていても実行する
 		api_info()
 			: function(NULL)
 			, parser(NULL)
@@ -40,7 +48,11 @@ namespace rediscpp
 			, max_argc(1)
 			, arg_types("c")
 			, writing(false)
+			, batching(false)
+			, dynamic_keys(false)
+			, shrinking(false)
 		{
+			plan.compile(arg_types);
 		}
 		api_info & set(api_function_type function_)
 		{
@@ -67,6 +79,7 @@ namespace rediscpp
 		api_info & type(const std::string & arg_types_)
 		{
 			arg_types = arg_types_;
+			plan.compile(arg_types);
 			if (min_argc == 1 && max_argc == 1) {
 				min_argc = max_argc = arg_types.size();
 			}
@@ -77,17 +90,85 @@ namespace rediscpp
 			writing = true;
 			return *this;
 		}
+		api_info & batch()
+		{
+			batching = true;
+			return *this;
+		}
+		api_info & dynamic()
+		{
+			dynamic_keys = true;
+			return *this;
+		}
+		api_info & shrink()
+		{
+			shrinking = true;
+			return *this;
+		}
 		api_info & set_parser(api_function_type function_)
 		{
 			parser = function_;
 			return *this;
 		}
 	};
+	///コマンド名からapi_infoを引く表
+	///@note api_infoは登録順に連続して並べ、位置はperfect_hash_typeで引く
+	class api_table_type
+	{
+		std::vector<api_info> infos;
+		perfect_hash_type hash;
+	public:
+		api_info & operator[](const std::string & name)
+		{
+			size_t index = hash.insert(name);
+			if (infos.size() <= index) {
+				infos.resize(index + 1);
+				infos[index].name = hash.get_name(index);
+			}
+			return infos[index];
+		}
+		void build() { hash.build(); }
+		///引数を変更せずに大文字小文字を区別しないで引く
+		const api_info * find(const std::string & name) const
+		{
+			int index = hash.find(name);
+			return index < 0 ? NULL : &infos[index];
+		}
+		size_t size() const { return infos.size(); }
+	};
+	class job_type;
+	///スレッド毎のpollと待ち受け
+	///@note SO_REUSEPORTで待ち受けを分け、受け付けたクライアントは閉じるまで同じスレッドで処理する
+	class reactor_type
+	{
+		friend class server_type;
+		server_type & server;
+		std::shared_ptr<poll_type> poll;
+		std::shared_ptr<event_type> event;
+		std::shared_ptr<socket_type> listening;
+		std::map<socket_type*,std::shared_ptr<client_type>> clients;
+		sync_queue<std::shared_ptr<job_type>> jobs;
+		poll_batch_type batch;
+		reactor_type(const reactor_type &);
+		static void event_callback(pollable_type * p, int events);
+		void on_event(event_type * e, int events);
+	public:
+		reactor_type(server_type & server_, size_t batch_size);
+		bool start(std::shared_ptr<address_type> address);
+		void process();
+		bool is_current() const;
+		void append(std::shared_ptr<client_type> client);
+		void post(std::shared_ptr<job_type> job);
+		bool is_idle() const { return poll->get_count() <= 2; }///<listening & eventのみ
+		const poll_type & get_poll() const { return *poll; }
+	};
 	class worker_type : public thread_type
 	{
 		server_type & server;
+		poll_batch_type batch;///<スレッド毎に使い回すイベント領域
+		std::shared_ptr<reactor_type> reactor;///<reactorモードの場合のみ
 	public:
-		worker_type(server_type & server_);
+		worker_type(server_type & server_, std::shared_ptr<reactor_type> reactor_);
 		virtual void run();
 	};
 	class job_type
@@ -100,6 +181,7 @@ namespace rediscpp
 			list_pushed_type,///<listに値が何か追加された場合
 			slaveof_type,
 			propagate_type,///<monitor, slave向けの情報
+			unmonitor_type,///<reactorで閉じたmonitorの解除
 		};
 		job_types type;
 		std::shared_ptr<client_type> client;
@@ -120,9 +202,11 @@ namespace rediscpp
 	{
 		friend class client_type;
 		friend class master_type;
+		friend class reactor_type;
 		std::shared_ptr<poll_type> poll;
 		std::shared_ptr<event_type> event;
 		std::shared_ptr<timer_type> timer;
+		std::shared_ptr<timer_type> expire_timer;///<有効期限の切れたキーを消す周期
 		std::map<socket_type*,std::shared_ptr<client_type>> clients;
 		mutex_type blocked_mutex;
 		std::set<std::shared_ptr<client_type>> blocked_clients;
@@ -130,6 +214,7 @@ namespace rediscpp
 		uint16_t listening_port;
 		std::map<std::string,std::string> store;
 		std::string password;
+		std::shared_ptr<lazyfree_type> lazyfree;
 		std::vector<std::shared_ptr<database_type>> databases;
 		std::vector<std::shared_ptr<worker_type>> thread_pool;
 		sync_queue<std::shared_ptr<job_type>> jobs;
@@ -141,24 +226,81 @@ namespace rediscpp
 		std::set<std::shared_ptr<client_type>> slaves;
 		volatile bool monitoring;
 		std::set<std::shared_ptr<client_type>> monitors;
+		size_t poll_batch_size;///<一度のepoll_waitで受け取る最大イベント数
+		bool reactor_mode;///<スレッド毎にpollと待ち受けを持つ
+		poll_engine_types poll_engine;
+		size_t proto_max_bulk_len;///<受け付ける値の最大長
+		std::vector<std::shared_ptr<reactor_type>> reactors;
+		std::atomic<uint64_t> command_count;///<実行したコマンド数
+		std::atomic<uint64_t> batch_count;///<まとめてロックしたパイプラインのグループ数
+		std::atomic<uint64_t> batched_command_count;///<グループで実行したコマンド数
+		std::atomic<uint64_t> expired_key_count;///<周期処理で消したキー数
+		std::atomic<uint64_t> expired_keys_per_sec;
+		std::atomic<uint64_t> expire_cycle_count;
+		std::atomic<uint64_t> expire_cycle_last_ns;
+		std::atomic<uint64_t> expire_cycle_max_ns;
+		std::atomic<uint64_t> expire_cycle_interval_ms;///<次の周期までの時間
+		uint64_t expire_window_start_ns;///<expired_keys_per_secを求める区間
+		uint64_t expire_window_count;
+		size_t expire_shard_cursor;///<次の周期を始めるdatabaseとshardの通し番号
+		static const uint64_t expire_cycle_budget_ns = 1000000;///<一回の周期で使う時間
+		static const uint64_t expire_normal_interval_ms = 100;
+		static const uint64_t expire_fast_interval_ms = 10;///<時間内に消し切れないか、辞書の移行中
+		static const uint64_t expire_idle_interval_ms = 1000;///<有効期限を持つキーが無い
+		static const size_t expire_batch_size = 64;///<一度のロックで消すキー数
+		size_t maxmemory;///<0なら制限しない
+		maxmemory_policies maxmemory_policy;
+		std::atomic<size_t> evict_cursor;///<次に消すdatabaseとshardの通し番号
+		std::atomic<bool> nothing_evictable;///<消せるキーが無かったので、次の書き込みまで探さない
+		std::atomic<uint64_t> evicted_keys;
+		std::atomic<uint64_t> eviction_count;///<キーを消した追い出しの回数
+		std::atomic<uint64_t> eviction_total_ns;
+		std::atomic<uint64_t> eviction_max_ns;
+		std::atomic<uint64_t> oom_rejected_count;///<maxmemoryを超えていて断った書き込み
+		std::atomic<uint64_t> watching_clients;///<WATCH中のクライアント数
+		static const uint64_t eviction_budget_ns = 1000000;///<一回の追い出しで使う時間
+		static const size_t eviction_batch_size = 16;///<一度のロックで消すキー数
 
 		static void client_callback(pollable_type * p, int events);
 		static void server_callback(pollable_type * p, int events);
 		static void event_callback(pollable_type * p, int events);
 		static void timer_callback(pollable_type * p, int events);
+		static void expire_timer_callback(pollable_type * p, int events);
 		void on_server(socket_type * s, int events);
 		void on_client(socket_type * s, int events);
 		void on_event(event_type * e, int events);
 		void on_timer(timer_type * e, int events);
+		void on_expire_timer(timer_type * e, int events);
+		uint64_t expire_cycle();
+		bool evict();
+		bool is_sharing_integers() const;
 	public:
 		server_type();
 		~server_type();
 		void startup_threads(int threads);
+		bool startup_reactors(std::shared_ptr<address_type> address, int threads);
 		void shutdown_threads();
 		bool start(const std::string & hostname, const std::string & port, int threads);
-		void process();
+		void process(poll_batch_type & batch);
+		void set_poll_batch_size(size_t size) { poll_batch_size = std::max<size_t>(1, size); }
+		size_t get_poll_batch_size() const { return poll_batch_size; }
+		void set_reactor_mode(bool reactor_mode_) { reactor_mode = reactor_mode_; }
+		void set_poll_engine(poll_engine_types poll_engine_) { poll_engine = poll_engine_; }
+		void set_shard_count(size_t shard_count);
+		void set_maxmemory(size_t maxmemory_) { maxmemory = maxmemory_; }
+		static const size_t default_proto_max_bulk_len = 512 * 1024 * 1024;
+		void set_proto_max_bulk_len(size_t len) { proto_max_bulk_len = std::min<size_t>(len, std::numeric_limits<int>::max()); }
+		size_t get_proto_max_bulk_len() const { return proto_max_bulk_len; }
+		void set_maxmemory_policy(maxmemory_policies policy);
+		static bool parse_maxmemory_policy(const std::string & name, maxmemory_policies & policy);
+		static const char * get_maxmemory_policy_name(maxmemory_policies policy);
+		static size_t get_used_memory() { return static_cast<size_t>(std::max<int64_t>(0, type_interface::used_memory + dictionary_type::used_memory)); }
+		static size_t get_used_memory_rss();
+		bool is_over_maxmemory() const;
 		database_write_locker writable_db(int index, client_type * client, bool rdlock = false);
+		database_write_locker writable_db(int index, client_type * client, shard_mask_type shards, bool rdlock);
 		database_read_locker readable_db(int index, client_type * client);
+		database_read_locker readable_db(int index, client_type * client, shard_mask_type shards);
 		database_write_locker writable_db(client_type * client, bool rdlock = false);
 		database_read_locker readable_db(client_type * client);
 		bool save(const std::string & path);
@@ -169,12 +311,19 @@ namespace rediscpp
 		void slaveof(const std::string & host, const std::string & port, bool now = false);
 		void propagete(const std::string & info, bool now = false);
 		void propagete(const arguments_type & info, bool now = false);
-		std::map<std::string,api_info> api_map;
+		api_table_type api_map;
 		void build_api_map();
 		void blocked(std::shared_ptr<client_type> client);
 		void unblocked(std::shared_ptr<client_type> client);
 		void excecute_blocked_client(bool now = false);
 		void notify_list_pushed();
+		///書き込みで消せるキーが増えたかもしれないので、追い出しを再開する
+		void notify_written()
+		{
+			if (nothing_evictable) {
+				nothing_evictable = false;
+			}
+		}
 		int64_t pos_fix(int64_t pos, int64_t size)
 		{
 			if (pos < 0) {
@@ -193,6 +342,9 @@ namespace rediscpp
 		}
 		int64_t incrby(const std::string & value, int64_t count);
 		std::string incrbyfloat(const std::string & value, const std::string & count);
+		std::shared_ptr<type_string> create_string(const std::string & str, const timeval_type & current) const;
+		std::shared_ptr<type_string> create_integer(int64_t value, const timeval_type & current) const;
+		static std::shared_ptr<type_string> unshare_string(database_type * db, const std::string & key, std::shared_ptr<type_string> value, const timeval_type & current);
 		static void dump(std::string & dst, const std::shared_ptr<type_interface> & value);
 		static void dump_suffix(std::string & dst);
 		static std::shared_ptr<type_interface> restore(const std::string & src, const timeval_type & current);
@@ -213,6 +365,7 @@ namespace rediscpp
 		bool api_sync(client_type * client);
 		bool api_replconf(client_type * client);
 		bool api_monitor(client_type * client);
+		bool api_information(client_type * client);
 		//transactions api
 		bool api_multi(client_type * client);
 		bool api_exec(client_type * client);
@@ -221,7 +374,11 @@ namespace rediscpp
 		bool api_unwatch(client_type * client);
 		//keys api
 		bool api_keys(client_type * client);
+		bool api_scan(client_type * client);
+		void parse_scan_options(client_type * client, size_t start, std::string & pattern, size_t & count, std::string * type);
+		void response_scan(client_type * client, uint64_t cursor, const std::vector<std::string> & items);
 		bool api_del(client_type * client);
+		bool api_unlink(client_type * client);
 		bool api_exists(client_type * client);
 		bool api_expire(client_type * client);
 		bool api_expireat(client_type * client);
@@ -237,6 +394,7 @@ namespace rediscpp
 		bool api_rename(client_type * client);
 		bool api_renamenx(client_type * client);
 		bool api_type(client_type * client);
+		bool api_object(client_type * client);
 		bool api_sort(client_type * client);
 		bool api_sort_store(client_type * client);
 		bool api_dump(client_type * client);
@@ -292,6 +450,7 @@ namespace rediscpp
 		bool api_hexists(client_type * client);
 		bool api_hget(client_type * client);
 		bool api_hgetall(client_type * client);
+		bool api_hscan(client_type * client);
 		bool api_hincrby(client_type * client);
 		bool api_hincrbyfloat(client_type * client);
 		bool api_hkeys(client_type * client);
@@ -312,6 +471,7 @@ namespace rediscpp
 		bool api_sinterstore(client_type * client);
 		bool api_sismember(client_type * client);
 		bool api_smembers(client_type * client);
+		bool api_sscan(client_type * client);
 		bool api_smove(client_type * client);
 		bool api_spop(client_type * client);
 		bool api_srandmember(client_type * client);
@@ -335,6 +495,7 @@ namespace rediscpp
 		bool api_zrevrangebyscore(client_type * client);
 		bool api_zrevrank(client_type * client);
 		bool api_zscore(client_type * client);
+		bool api_zscan(client_type * client);
 		bool api_zunionstore(client_type * client);
 		bool api_zoperaion_internal(client_type * client, int type);
 		bool api_zrange_internal(client_type * client, bool rev);
@@ -3,10 +3,12 @@
 namespace rediscpp
 {
 	type_hash::type_hash()
+		: bytes(0)
 	{
 	}
 	type_hash::type_hash(const timeval_type & current)
 		: type_interface(current)
+		, bytes(0)
 	{
 	}
 	type_hash::~type_hash()
@@ -19,6 +21,7 @@ namespace rediscpp
 			auto & field = **it;
 			auto vit = value.find(field);
 			if (vit != value.end()) {
+				bytes -= get_element_memory(vit->first, vit->second);
 				value.erase(vit);
 				++removed;
 			}
@@ -41,10 +44,41 @@ namespace rediscpp
 		}
 		return std::make_pair(std::string(), false);
 	}
-	std::pair<std::unordered_map<std::string, std::string>::const_iterator,std::unordered_map<std::string, std::string>::const_iterator> type_hash::hgetall() const
+	std::pair<type_hash::container_type::const_iterator,type_hash::container_type::const_iterator> type_hash::hgetall() const
 	{
 		return std::make_pair(value.begin(), value.end());
 	}
+	///フィールドのハッシュを逆順のビットにした位置で、cursorから先の要素をcount個以上集める
+	///@note キーの辞書のカーソルを表の大きさの限りなく大きい時にしたもので、バケット数が変わっても続きから辿れる
+	///@note 同じハッシュの要素は一度に返す
+	///@return 次のカーソル、0なら終わり
+	uint64_t type_hash::hscan(uint64_t cursor, size_t count, std::vector<std::pair<const std::string*,const std::string*>> & fields) const
+	{
+		const uint64_t position = reverse_bits(cursor);
+		auto hasher = value.hash_function();
+		std::vector<std::pair<uint64_t,container_type::const_iterator>> pending;
+		for (auto it = value.begin(), end = value.end(); it != end; ++it) {
+			const uint64_t reversed = reverse_bits(hasher(it->first));
+			if (position <= reversed) {
+				pending.push_back(std::make_pair(reversed, it));
+			}
+		}
+		if (pending.empty()) {
+			return 0;
+		}
+		uint64_t last = std::numeric_limits<uint64_t>::max();
+		if (count < pending.size()) {
+			auto nth = pending.begin() + (count - 1);
+			std::nth_element(pending.begin(), nth, pending.end(), [](const std::pair<uint64_t,container_type::const_iterator> & lhs, const std::pair<uint64_t,container_type::const_iterator> & rhs) { return lhs.first < rhs.first; });
+			last = nth->first;
+		}
+		for (auto it = pending.begin(), end = pending.end(); it != end; ++it) {
+			if (it->first <= last) {
+				fields.push_back(std::make_pair(&it->second->first, &it->second->second));
+			}
+		}
+		return reverse_bits(last + 1);
+	}
 	size_t type_hash::size() const
 	{
 		return value.size();
@@ -56,10 +90,12 @@ namespace rediscpp
 			if (nx) {
 				return false;
 			}
+			bytes += get_string_memory(val.size()) - get_string_memory(it->second.size());
 			it->second = val;
 			return false;
 		} else {
 			value[field] = val;
+			bytes += get_element_memory(field, val);
 			return true;//created
 		}
 	}
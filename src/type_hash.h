@@ -7,7 +7,13 @@ namespace rediscpp
 {
 	class type_hash : public type_interface
 	{
-		std::unordered_map<std::string, std::string> value;
+	public:
+		typedef std::unordered_map<std::string, std::string, std::hash<std::string>, std::equal_to<std::string>, node_allocator<std::pair<const std::string, std::string>>> container_type;
+	private:
+		container_type value;
+		size_t bytes;///<要素の大きさの合計
+		static const size_t node_memory = 80;///<std::unordered_mapの節の次のポインタと2つのstd::stringとハッシュ値
+		static size_t get_element_memory(const std::string & field, const std::string & val) { return node_memory + get_string_memory(field.size()) + get_string_memory(val.size()); }
 	public:
 		type_hash();
 		type_hash(const timeval_type & current);
@@ -15,14 +21,16 @@ namespace rediscpp
 		virtual type_types get_type() const { return hash_type; }
 		virtual void output(std::shared_ptr<file_type> & dst) const;
 		virtual void output(std::string & dst) const;
+		virtual size_t get_memory_usage() const { return sizeof(*this) + bytes + value.bucket_count() * sizeof(void*); }
 		static std::shared_ptr<type_hash> input(std::shared_ptr<file_type> & src);
 		static std::shared_ptr<type_hash> input(std::pair<std::string::const_iterator,std::string::const_iterator> & src);
 		size_t hdel(const std::vector<std::string*> & fields);
 		bool hexists(const std::string field) const;
 		bool empty() const;
 		std::pair<std::string,bool> hget(const std::string field) const;
-		std::pair<std::unordered_map<std::string, std::string>::const_iterator,std::unordered_map<std::string, std::string>::const_iterator> hgetall() const;
+		std::pair<container_type::const_iterator,container_type::const_iterator> hgetall() const;
 		size_t size() const;
+		uint64_t hscan(uint64_t cursor, size_t count, std::vector<std::pair<const std::string*,const std::string*>> & fields) const;
 		bool hset(const std::string & field, const std::string & val, bool nx = false);
 	};
 };
@@ -2,15 +2,42 @@
 
 namespace rediscpp
 {
+	std::atomic<int64_t> type_interface::used_memory(0);
+	bool type_interface::lfu_mode = false;
+	namespace
+	{
+		///LFUの参照回数を増やすかを決める乱数
+		///@note 読み込みロックで複数のスレッドから呼ぶので、スレッド毎に持つ
+		double lfu_random()
+		{
+			static __thread uint64_t state = 0;
+			if (!state) {
+				state = reinterpret_cast<uintptr_t>(&state) | 1;
+			}
+			state ^= state >> 12;
+			state ^= state << 25;
+			state ^= state >> 27;
+			return static_cast<double>((state * 0x2545F4914F6CDD1DULL) >> 11) / static_cast<double>(1ULL << 53);
+		}
+	}
 	type_interface::type_interface()
+		: memory(0)
+		, access(get_initial_access(modified))
 	{
 	}
 	type_interface::type_interface(const timeval_type & current)
 		: modified(current)
+		, memory(0)
+		, access(get_initial_access(current))
+	{
+	}
+	uint32_t type_interface::get_initial_access(const timeval_type & current)
 	{
+		return lfu_mode ? (get_lfu_clock(current) << 8) | lfu_init_value : get_lru_clock(current);
 	}
 	type_interface::~type_interface()
 	{
+		used_memory -= memory;
 	}
 	timeval_type type_interface::get_last_modified_time() const
 	{
@@ -19,5 +46,53 @@ namespace rediscpp
 	void type_interface::update(const timeval_type & current)
 	{
 		modified = current;
+		touch(current);
+		account();
+	}
+	///前回からの大きさの差をused_memoryに反映する
+	///@note 辞書に入れる時と、変更した後のupdateで呼ぶ
+	///@note 共有の値は複数のスレッドから呼ばれるので、変わらなければ書かない
+	void type_interface::account()
+	{
+		const size_t now = get_memory_usage();
+		if (now == memory) {
+			return;
+		}
+		used_memory += static_cast<int64_t>(now) - static_cast<int64_t>(memory);
+		memory = now;
+	}
+	///参照した時間を記録し、LFUでは参照回数を確率的に増やす
+	///@note 読み込みロックで複数のスレッドから呼ばれるので、変わる時だけ書き、同時に書いた場合はどちらかが残ればよい
+	void type_interface::touch(const timeval_type & current) const
+	{
+		const uint32_t previous = access.load(std::memory_order_relaxed);
+		uint32_t next;
+		if (lfu_mode) {
+			uint32_t counter = decay_lfu(previous, current);
+			if (counter < 255) {
+				const uint32_t base = lfu_init_value < counter ? counter - lfu_init_value : 0;
+				if (lfu_random() * (base * lfu_log_factor + 1) < 1.0) {
+					++counter;
+				}
+			}
+			next = (get_lfu_clock(current) << 8) | counter;
+		} else {
+			next = get_lru_clock(current);
+		}
+		if (previous != next) {
+			access.store(next, std::memory_order_relaxed);
+		}
+	}
+	///最後に参照してから経った分だけ減らした参照回数
+	uint8_t type_interface::decay_lfu(uint32_t access_, const timeval_type & current)
+	{
+		const uint32_t counter = access_ & 0xFF;
+		const uint32_t periods = ((get_lfu_clock(current) - (access_ >> 8)) & 0xFFFF) / lfu_decay_minutes;
+		return static_cast<uint8_t>(periods < counter ? counter - periods : 0);
+	}
+	///最後に参照してからの秒数
+	uint32_t type_interface::get_idle(const timeval_type & current) const
+	{
+		return (get_lru_clock(current) - access.load(std::memory_order_relaxed)) & lru_clock_mask;
 	}
 };
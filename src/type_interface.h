@@ -3,6 +3,7 @@
 
 #include "common.h"
 #include "timeval.h"
+#include "node_pool.h"
 
 namespace rediscpp
 {
@@ -22,15 +23,42 @@ namespace rediscpp
 	class type_interface
 	{
 		timeval_type modified;///<ŌɏC(WATCHp)
+		size_t memory;///<used_memoryɉ傫
+		///ŌɎQƂLRU̎v
+		///@note LFUł͏16rbgŌɎQƂPʂ̎vA8rbgΐ̎QƉ
+		mutable std::atomic<uint32_t> access;
+		type_interface(const type_interface &);
+		type_interface & operator=(const type_interface &);
+		static uint32_t get_initial_access(const timeval_type & current);
+		static uint8_t decay_lfu(uint32_t access_, const timeval_type & current);
 	public:
+		static const uint32_t lru_clock_mask = (1 << 24) - 1;///<LRU̎v24rbg̕bŁA194ň
+		static const uint32_t lfu_init_value = 5;///<Vl̎QƉ񐔁AɒǂoȂ悤ɂ
+		static const uint32_t lfu_log_factor = 10;///<QƉ񐔂n̎A1/((n-lfu_init_value)*lfu_log_factor+1)̊mő₷
+		static const uint32_t lfu_decay_minutes = 1;///<QƂȂԁA̕ɎQƉ񐔂1炷
+		static std::atomic<int64_t> used_memory;///<ɓꂽl̑傫̍v
+		static bool lfu_mode;///<accessLFUƂĎgANɒǂo̕jŌ߂
 		type_interface();
 		type_interface(const timeval_type & current);
 		virtual ~type_interface();
+		///l̖{̂͌^ɌŒ蒷Ȃ̂ŁAnode_pool_typemۂ
+		static void * operator new(size_t size) { return node_pool_type::is_pooled(size) ? node_pool_type::allocate(size) : ::operator new(size); }
+		static void operator delete(void * p, size_t size) { if (node_pool_type::is_pooled(size)) { node_pool_type::deallocate(p, size); } else { ::operator delete(p); } }
 		virtual type_types get_type() const = 0;
 		virtual void output(std::shared_ptr<file_type> & dst) const = 0;
 		virtual void output(std::string & dst) const = 0;
+		///lmۂĂoCǧς
+		///@note vfɔႷ鎞Ԃ|Ȃ悤ɁAe^ύX̓xɐĂ
+		virtual size_t get_memory_usage() const = 0;
 		timeval_type get_last_modified_time() const;
 		void update(const timeval_type & current);
+		void account();
+		void touch(const timeval_type & current) const;
+		uint32_t get_idle(const timeval_type & current) const;
+		uint8_t get_freq(const timeval_type & current) const { return decay_lfu(access.load(std::memory_order_relaxed), current); }
+		static uint32_t get_lru_clock(const timeval_type & current) { return static_cast<uint32_t>(current.tv_sec) & lru_clock_mask; }
+		static uint32_t get_lfu_clock(const timeval_type & current) { return static_cast<uint32_t>(current.tv_sec / 60) & 0xFFFF; }
+		static size_t get_string_memory(size_t capacity) { return 15 < capacity ? capacity + 1 : 0; }
 		static void write_len(std::shared_ptr<file_type> & dst, uint32_t len);
 		static void write_string(std::shared_ptr<file_type> & dst, const std::string & str);
 		static void write_double(std::shared_ptr<file_type> & dst, double val);
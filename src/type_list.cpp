@@ -4,25 +4,32 @@ namespace rediscpp
 {
 	type_list::type_list()
 		: count(0)
+		, bytes(0)
 	{
 	}
 	type_list::type_list(const timeval_type & current)
 		: type_interface(current)
 		, count(0)
+		, bytes(0)
 	{
 	}
 	type_list::~type_list()
 	{
 	}
-	void type_list::move(std::list<std::string> && value, size_t count_)
+	void type_list::move(container_type && value, size_t count_)
 	{
-		value.swap(value);
+		this->value.swap(value);
 		count = count_;
+		bytes = 0;
+		for (auto it = this->value.begin(), end = this->value.end(); it != end; ++it) {
+			bytes += get_element_memory(*it);
+		}
 	}
 	void type_list::lpush(const std::vector<std::string*> & elements)
 	{
 		for (auto it = elements.begin(), end = elements.end(); it != end; ++it) {
 			value.insert(value.begin(), **it);
+			bytes += get_element_memory(**it);
 		}
 		count += elements.size();
 	}
@@ -30,6 +37,7 @@ namespace rediscpp
 	{
 		for (auto it = elements.begin(), end = elements.end(); it != end; ++it) {
 			value.insert(value.end(), **it);
+			bytes += get_element_memory(**it);
 		}
 		count += elements.size();
 	}
@@ -44,17 +52,20 @@ namespace rediscpp
 		}
 		value.insert(it, element);
 		++count;
+		bytes += get_element_memory(element);
 		return true;
 	}
 	void type_list::lpush(const std::string & element)
 	{
 		value.push_front(element);
 		++count;
+		bytes += get_element_memory(element);
 	}
 	void type_list::rpush(const std::string & element)
 	{
 		value.push_back(element);
 		++count;
+		bytes += get_element_memory(element);
 	}
 	std::string type_list::lpop()
 	{
@@ -64,6 +75,7 @@ namespace rediscpp
 		std::string result = value.front();
 		value.pop_front();
 		--count;
+		bytes -= get_element_memory(result);
 		return result;
 	}
 	std::string type_list::rpop()
@@ -74,6 +86,7 @@ namespace rediscpp
 		std::string result = value.back();
 		value.pop_back();
 		--count;
+		bytes -= get_element_memory(result);
 		return result;
 	}
 	size_t type_list::size() const
@@ -84,37 +97,37 @@ namespace rediscpp
 	{
 		return count == 0;
 	}
-	std::list<std::string>::const_iterator type_list::get_it(size_t index) const
+	type_list::container_type::const_iterator type_list::get_it(size_t index) const
 	{
 		if (count <= index) {
 			return value.end();
 		}
 		if (index <= count / 2) {
-			std::list<std::string>::const_iterator it = value.begin();
+			container_type::const_iterator it = value.begin();
 			for (auto i = 0; i < index; ++i) {
 				++it;
 			}
 			return it;
 		}
-		std::list<std::string>::const_iterator it = value.end();
+		container_type::const_iterator it = value.end();
 		for (auto i = count; index < i; --i) {
 			--it;
 		}
 		return it;
 	}
-	std::list<std::string>::iterator type_list::get_it_internal(size_t index)
+	type_list::container_type::iterator type_list::get_it_internal(size_t index)
 	{
 		if (count <= index) {
 			return value.end();
 		}
 		if (index <= count / 2) {
-			std::list<std::string>::iterator it = value.begin();
+			container_type::iterator it = value.begin();
 			for (auto i = 0; i < index; ++i) {
 				++it;
 			}
 			return it;
 		}
-		std::list<std::string>::iterator it = value.end();
+		container_type::iterator it = value.end();
 		for (auto i = count; index < i; --i) {
 			--it;
 		}
@@ -124,24 +137,25 @@ namespace rediscpp
 	{
 		if (index < 0 || count <= index) return false;
 		auto it = get_it_internal(index);
+		bytes += get_element_memory(newval) - get_element_memory(*it);
 		*it = newval;
 		return true;
 	}
-	std::pair<std::list<std::string>::const_iterator,std::list<std::string>::const_iterator> type_list::get_range(size_t start, size_t end) const
+	std::pair<type_list::container_type::const_iterator,type_list::container_type::const_iterator> type_list::get_range(size_t start, size_t end) const
 	{
 		start = std::min(count, start);
 		end = std::min(count, end);
 		if (end <= start) {
 			return std::make_pair(value.end(), value.end());
 		}
-		std::list<std::string>::const_iterator sit = get_it(start);
+		container_type::const_iterator sit = get_it(start);
 		if (count <= end) {
 			return std::make_pair(sit, value.end());
 		}
 		if (start == end) {
 			return std::make_pair(sit, sit);
 		}
-		std::list<std::string>::const_iterator eit;
+		container_type::const_iterator eit;
 		if (end - start < count - end) {
 			eit = sit;
 			for (size_t i = start; i < end; ++i) {
@@ -152,25 +166,25 @@ namespace rediscpp
 		}
 		return std::make_pair(sit, eit);
 	}
-	std::pair<std::list<std::string>::const_iterator,std::list<std::string>::const_iterator> type_list::get_range() const
+	std::pair<type_list::container_type::const_iterator,type_list::container_type::const_iterator> type_list::get_range() const
 	{
 		return std::make_pair(value.begin(), value.end());
 	}
-	std::pair<std::list<std::string>::iterator,std::list<std::string>::iterator> type_list::get_range_internal(size_t start, size_t end)
+	std::pair<type_list::container_type::iterator,type_list::container_type::iterator> type_list::get_range_internal(size_t start, size_t end)
 	{
 		start = std::min(count, start);
 		end = std::min(count, end);
 		if (end <= start) {
 			return std::make_pair(value.end(), value.end());
 		}
-		std::list<std::string>::iterator sit = get_it_internal(start);
+		container_type::iterator sit = get_it_internal(start);
 		if (count <= end) {
 			return std::make_pair(sit, value.end());
 		}
 		if (start == end) {
 			return std::make_pair(sit, sit);
 		}
-		std::list<std::string>::iterator eit;
+		container_type::iterator eit;
 		if (end - start < count - end) {
 			eit = sit;
 			for (size_t i = start; i < end; ++i) {
@@ -189,6 +203,7 @@ namespace rediscpp
 		if (count_ == 0) {
 			for (auto it = value.begin(); it != value.end();) {
 				if (*it == target) {
+					bytes -= get_element_memory(*it);
 					it = value.erase(it);
 					++removed;
 				} else {
@@ -198,6 +213,7 @@ namespace rediscpp
 		} else if (0 < count_) {
 			for (auto it = value.begin(); it != value.end();) {
 				if (*it == target) {
+					bytes -= get_element_memory(*it);
 					it = value.erase(it);
 					++removed;
 					if (count_ == removed) {
@@ -214,6 +230,7 @@ namespace rediscpp
 				--it;
 				while (true) {
 					if (*it == target) {
+						bytes -= get_element_memory(*it);
 						it = value.erase(it);
 						++removed;
 						if (count_ == removed) {
@@ -238,10 +255,17 @@ namespace rediscpp
 		if (end <= start) {
 			value.clear();
 			count = 0;
+			bytes = 0;
 			return;
 		}
 		auto range = get_range_internal(start, end);
 		count = end - start;
+		for (auto it = value.begin(); it != range.first; ++it) {
+			bytes -= get_element_memory(*it);
+		}
+		for (auto it = range.second; it != value.end(); ++it) {
+			bytes -= get_element_memory(*it);
+		}
 		value.erase(value.begin(), range.first);
 		value.erase(range.second, value.end());
 	}
@@ -7,16 +7,23 @@ namespace rediscpp
 {
 	class type_list : public type_interface
 	{
-		std::list<std::string> value;
+	public:
+		typedef std::list<std::string, node_allocator<std::string>> container_type;
+	private:
+		container_type value;
 		size_t count;
+		size_t bytes;///<要素の大きさの合計
+		static const size_t node_memory = 48;///<std::listの節の前後のポインタとstd::string
+		static size_t get_element_memory(const std::string & element) { return node_memory + get_string_memory(element.size()); }
 	public:
 		type_list();
 		type_list(const timeval_type & current);
 		virtual ~type_list();
-		void move(std::list<std::string> && value, size_t count_);
+		void move(container_type && value, size_t count_);
 		virtual type_types get_type() const { return list_type; }
 		virtual void output(std::shared_ptr<file_type> & dst) const;
 		virtual void output(std::string & dst) const;
+		virtual size_t get_memory_usage() const { return sizeof(*this) + bytes; }
 		static std::shared_ptr<type_list> input(std::shared_ptr<file_type> & src);
 		static std::shared_ptr<type_list> input(std::pair<std::string::const_iterator,std::string::const_iterator> & src);
 		void lpush(const std::vector<std::string*> & elements);
@@ -28,15 +35,15 @@ namespace rediscpp
 		std::string rpop();
 		size_t size() const;
 		bool empty() const;
-		std::list<std::string>::const_iterator get_it(size_t index) const;
+		container_type::const_iterator get_it(size_t index) const;
 		bool set(int64_t index, const std::string & newval);
-		std::pair<std::list<std::string>::const_iterator,std::list<std::string>::const_iterator> get_range(size_t start, size_t end) const;
-		std::pair<std::list<std::string>::const_iterator,std::list<std::string>::const_iterator> get_range() const;
+		std::pair<container_type::const_iterator,container_type::const_iterator> get_range(size_t start, size_t end) const;
+		std::pair<container_type::const_iterator,container_type::const_iterator> get_range() const;
 		size_t lrem(int64_t count_, const std::string & target);
 		void trim(size_t start, size_t end);
 	private:
-		std::list<std::string>::iterator get_it_internal(size_t index);
-		std::pair<std::list<std::string>::iterator,std::list<std::string>::iterator> get_range_internal(size_t start, size_t end);
+		container_type::iterator get_it_internal(size_t index);
+		std::pair<container_type::iterator,container_type::iterator> get_range_internal(size_t start, size_t end);
 	};
 };
 
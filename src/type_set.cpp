@@ -3,10 +3,12 @@
 namespace rediscpp
 {
 	type_set::type_set()
+		: bytes(0)
 	{
 	}
 	type_set::type_set(const timeval_type & current)
 		: type_interface(current)
+		, bytes(0)
 	{
 	}
 	type_set::~type_set(){}
@@ -16,6 +18,7 @@ namespace rediscpp
 		for (auto it = members.begin(), end = members.end(); it != end; ++it) {
 			auto & member = **it;
 			if (value.insert(member).second) {
+				bytes += get_element_memory(member);
 				++added;
 			}
 		}
@@ -29,10 +32,20 @@ namespace rediscpp
 	{
 		return value.find(member) != value.end();
 	}
-	std::pair<std::set<std::string>::const_iterator,std::set<std::string>::const_iterator> type_set::smembers() const
+	std::pair<type_set::container_type::const_iterator,type_set::container_type::const_iterator> type_set::smembers() const
 	{
 		return std::make_pair(value.begin(), value.end());
 	}
+	///afterより後のメンバーを順に最大count個集める、afterがNULLなら最初から
+	///@return まだ残っていればtrue
+	bool type_set::sscan(const std::string * after, size_t count, std::vector<const std::string*> & members) const
+	{
+		auto it = after ? value.upper_bound(*after) : value.begin();
+		for (auto end = value.end(); it != end && members.size() < count; ++it) {
+			members.push_back(&*it);
+		}
+		return it != value.end();
+	}
 	size_t type_set::srem(const std::vector<std::string*> & members)
 	{
 		size_t removed = 0;
@@ -40,6 +53,7 @@ namespace rediscpp
 			auto & member = **it;
 			auto vit = value.find(member);
 			if (vit != value.end()) {
+				bytes -= get_element_memory(member);
 				value.erase(vit);
 				++removed;
 			}
@@ -50,6 +64,7 @@ namespace rediscpp
 	{
 		auto vit = value.find(member);
 		if (vit != value.end()) {
+			bytes -= get_element_memory(member);
 			value.erase(vit);
 			return true;
 		}
@@ -57,7 +72,11 @@ namespace rediscpp
 	}
 	bool type_set::insert(const std::string & member)
 	{
-		return value.insert(member).second;
+		if (!value.insert(member).second) {
+			return false;
+		}
+		bytes += get_element_memory(member);
+		return true;
 	}
 	std::string type_set::random_key(const std::string & low, const std::string & high)
 	{
@@ -93,7 +112,7 @@ namespace rediscpp
 		}
 		return result;
 	}
-	std::set<std::string>::const_iterator type_set::srandmember() const
+	type_set::container_type::const_iterator type_set::srandmember() const
 	{
 		auto it = value.begin();
 		std::advance(it, rand() % value.size());
@@ -127,7 +146,7 @@ namespace rediscpp
 		/*/
 	}
 	///重複を許してcount個の要素を選択する
-	bool type_set::type_set::srandmember(size_t count, std::vector<std::set<std::string>::const_iterator> & result) const
+	bool type_set::type_set::srandmember(size_t count, std::vector<container_type::const_iterator> & result) const
 	{
 		result.clear();
 		if (count == 0) {
@@ -143,7 +162,7 @@ namespace rediscpp
 		return true;
 	}
 	///重複を許さずにcount個の要素を選択する
-	bool type_set::srandmember_distinct(size_t count, std::vector<std::set<std::string>::const_iterator> & result) const
+	bool type_set::srandmember_distinct(size_t count, std::vector<container_type::const_iterator> & result) const
 	{
 		result.clear();
 		if (value.size() < count) {
@@ -173,13 +192,23 @@ namespace rediscpp
 	void type_set::clear()
 	{
 		value.clear();
+		bytes = 0;
+	}
+	void type_set::recount()
+	{
+		bytes = 0;
+		for (auto it = value.begin(), end = value.end(); it != end; ++it) {
+			bytes += get_element_memory(*it);
+		}
 	}
 	void type_set::sunion(const type_set & rhs)
 	{
 		if (this == &rhs) {
 			return;
 		}
-		value.insert(rhs.value.begin(), rhs.value.end());
+		for (auto it = rhs.value.begin(), end = rhs.value.end(); it != end; ++it) {
+			insert(*it);
+		}
 	}
 	void type_set::sdiff(const type_set & rhs)
 	{
@@ -187,18 +216,20 @@ namespace rediscpp
 			clear();
 			return;
 		}
-		std::set<std::string> lhs;
+		container_type lhs;
 		lhs.swap(value);
 		std::set_difference(lhs.begin(), lhs.end(), rhs.value.begin(), rhs.value.end(), std::inserter(value, value.begin()));
+		recount();
 	}
 	void type_set::sinter(const type_set & rhs)
 	{
 		if (this == &rhs) {
 			return;
 		}
-		std::set<std::string> lhs;
+		container_type lhs;
 		lhs.swap(value);
 		std::set_intersection(lhs.begin(), lhs.end(), rhs.value.begin(), rhs.value.end(), std::inserter(value, value.begin()));
+		recount();
 	}
 };
 
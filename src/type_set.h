@@ -7,7 +7,14 @@ namespace rediscpp
 {
 	class type_set : public type_interface
 	{
-		std::set<std::string> value;
+	public:
+		typedef std::set<std::string, std::less<std::string>, node_allocator<std::string>> container_type;
+	private:
+		container_type value;
+		size_t bytes;///<要素の大きさの合計
+		static const size_t node_memory = 64;///<std::setの節の色と3つのポインタとstd::string
+		static size_t get_element_memory(const std::string & member) { return node_memory + get_string_memory(member.size()); }
+		void recount();
 	public:
 		type_set();
 		type_set(const timeval_type & current);
@@ -15,21 +22,23 @@ namespace rediscpp
 		virtual type_types get_type() const { return set_type; }
 		virtual void output(std::shared_ptr<file_type> & dst) const;
 		virtual void output(std::string & dst) const;
+		virtual size_t get_memory_usage() const { return sizeof(*this) + bytes; }
 		static std::shared_ptr<type_set> input(std::shared_ptr<file_type> & src);
 		static std::shared_ptr<type_set> input(std::pair<std::string::const_iterator,std::string::const_iterator> & src);
 		size_t sadd(const std::vector<std::string*> & members);
 		size_t scard() const;
 		bool sismember(const std::string & member) const;
-		std::pair<std::set<std::string>::const_iterator,std::set<std::string>::const_iterator> smembers() const;
+		std::pair<container_type::const_iterator,container_type::const_iterator> smembers() const;
+		bool sscan(const std::string * after, size_t count, std::vector<const std::string*> & members) const;
 		size_t srem(const std::vector<std::string*> & members);
 		bool erase(const std::string & member);
 		bool insert(const std::string & member);
 	private:
 		static std::string random_key(const std::string & low, const std::string & high);
 	public:
-		std::set<std::string>::const_iterator srandmember() const;
-		bool srandmember(size_t count, std::vector<std::set<std::string>::const_iterator> & result) const;
-		bool srandmember_distinct(size_t count, std::vector<std::set<std::string>::const_iterator> & result) const;
+		container_type::const_iterator srandmember() const;
+		bool srandmember(size_t count, std::vector<container_type::const_iterator> & result) const;
+		bool srandmember_distinct(size_t count, std::vector<container_type::const_iterator> & result) const;
 		bool empty() const;
 		size_t size() const;
 		void clear();
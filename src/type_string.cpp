@@ -2,64 +2,150 @@
 
 namespace rediscpp
 {
+	bool type_string::sharing_integers = true;
 	type_string::type_string()
 		: int_value(0)
 		, int_type(false)
+		, shared(false)
 	{
 	}
 	type_string::type_string(const timeval_type & current)
 		: type_interface(current)
 		, int_value(0)
 		, int_type(false)
+		, shared(false)
 	{
 	}
+	std::vector<std::shared_ptr<type_string>> type_string::create_shared_integers()
+	{
+		std::vector<std::shared_ptr<type_string>> result;
+		result.reserve(shared_integer_count);
+		for (int64_t i = 0; i < shared_integer_count; ++i) {
+			std::shared_ptr<type_string> value(new type_string());
+			value->set_int(i);
+			value->shared = true;
+			result.push_back(value);
+		}
+		return result;
+	}
+	///共有の整数の値
+	///@return 範囲外ならNULL
+	std::shared_ptr<type_string> type_string::get_shared_integer(int64_t value)
+	{
+		if (value < 0 || shared_integer_count <= value) {
+			return std::shared_ptr<type_string>();
+		}
+		static const std::vector<std::shared_ptr<type_string>> integers = create_shared_integers();
+		return integers[value];
+	}
+	///整数として読み、書き戻すと同じ文字列になるか
+	bool type_string::parse_integer(const std::string & str, int64_t & value)
+	{
+		if (str.empty() || 20 < str.size() || !(isdigit(static_cast<uint8_t>(str[0])) || str[0] == '-')) {
+			return false;
+		}
+		bool is_valid = false;
+		value = atoi64(str, is_valid);
+		return is_valid && format("%" PRId64, value) == str;
+	}
 	std::string type_string::get() const
 	{
-		if (int_type && string_value.empty()) {
-			return format("%"PRId64, int_value);
+		if (int_type) {
+			return format("%" PRId64, int_value);
+		}
+		return string_value ? *string_value : std::string();
+	}
+	///値を共有する参照を返す
+	///@note 参照している間に値が書き換えられても、参照先は変わらない
+	std::shared_ptr<const std::string> type_string::get_shared() const
+	{
+		if (int_type || !string_value) {
+			return std::make_shared<std::string>(get());
 		}
 		return string_value;
 	}
 	type_string::~type_string()
 	{
 	}
+	///@note 共有している文字列は、make_sharedの制御ブロックと合わせて数える
+	///@note 共有の整数の値はどのキーのものとしても数えない
+	size_t type_string::get_memory_usage() const
+	{
+		if (shared) {
+			return 0;
+		}
+		if (!string_value) {
+			return sizeof(*this);
+		}
+		return sizeof(*this) + shared_memory + get_string_memory(string_value->capacity());
+	}
+	///書き換え用の参照
 	std::string & type_string::ref()
 	{
 		to_str();
-		return string_value;
+		unshare();
+		return *string_value;
 	}
 	void type_string::set(const std::string & str)
 	{
-		string_value = str;
+		int64_t value;
+		if (parse_integer(str, value)) {
+			set_int(value);
+			return;
+		}
+		if (string_value && string_value.unique()) {
+			*string_value = str;
+		} else {
+			string_value = std::make_shared<std::string>(str);
+		}
 		int_type = false;
 	}
+	void type_string::set_int(int64_t value)
+	{
+		int_value = value;
+		int_type = true;
+		string_value.reset();
+	}
 	int64_t type_string::append(const std::string & str)
 	{
-		to_str();
-		string_value += str;
-		return string_value.size();
+		std::string & string = ref();
+		string += str;
+		return string.size();
 	}
 	int64_t type_string::setrange(size_t offset, const std::string & str)
 	{
-		to_str();
+		std::string & string = ref();
 		size_t new_size = offset + str.size();
-		if (string_value.size() < new_size) {
-			string_value.resize(new_size);
+		if (string.size() < new_size) {
+			string.resize(new_size);
+		}
+		std::copy(str.begin(), str.end(), string.begin() + offset);
+		return string.size();
+	}
+	///他から参照されていれば複製して、書き換えられるようにする
+	void type_string::unshare()
+	{
+		if (!string_value) {
+			string_value = std::make_shared<std::string>();
+		} else if (!string_value.unique()) {
+			string_value = std::make_shared<std::string>(*string_value);
 		}
-		std::copy(str.begin(), str.end(), string_value.begin() + offset);
-		return string_value.size();
 	}
 	void type_string::to_int()
 	{
-		if (!int_type) {
-			int_value = atoi64(string_value, int_type);
+		if (!int_type && string_value) {
+			int_value = atoi64(*string_value, int_type);
 		}
 	}
 	void type_string::to_str()
 	{
 		if (int_type) {
-			string_value = format("%"PRId64, int_value);
 			int_type = false;
+			if (string_value && string_value.unique()) {
+				*string_value = format("%" PRId64, int_value);
+			} else {
+				string_value = std::make_shared<std::string>(format("%" PRId64, int_value));
+			}
 		}
 	}
 	int64_t type_string::incrby(int64_t count)
@@ -68,16 +154,21 @@ namespace rediscpp
 		if (!int_type) {
 			throw std::runtime_error("ERR not valid integer");
 		}
+		int_value = add_integer(int_value, count);
+		return int_value;
+	}
+	///桁あふれを確認して加える
+	int64_t type_string::add_integer(int64_t value, int64_t count)
+	{
 		if (count < 0) {
-			if (int_value < int_value + count) {
+			if (value < std::numeric_limits<int64_t>::min() - count) {
 				throw std::runtime_error("ERR underflow");
 			}
 		} else if (0 < count) {
-			if (int_value + count < int_value) {
+			if (std::numeric_limits<int64_t>::max() - count < value) {
 				throw std::runtime_error("ERR overflow");
 			}
 		}
-		int_value += count;
-		return int_value;
+		return value + count;
 	}
 };
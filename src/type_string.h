@@ -5,30 +5,48 @@
 
 namespace rediscpp
 {
+	///文字列の値
+	///@note 文字列は送信中の応答と共有できるように参照で持ち、書き換え時に共有されていればコピーする
+	///@note 整数と同じ書式の文字列は、文字列を持たずに整数で持つ
+	///@note 0からshared_integer_count未満の整数は、キー間で共有する読み込み専用の値を使える、書き換える時はキー専用の値に置き換える
 	class type_string : public type_interface
 	{
-		std::string string_value;
+		std::shared_ptr<std::string> string_value;///<int_typeの場合は使わない
 		int64_t int_value;
 		bool int_type;
+		bool shared;///<共有の整数の値、書き換えない
+		static const size_t shared_memory = 48;///<make_sharedの制御ブロックとstd::string
+		static std::vector<std::shared_ptr<type_string>> create_shared_integers();
 	public:
+		static const int64_t shared_integer_count = 10000;
+		static bool sharing_integers;///<共有の整数を使う、LRUとLFUでは値毎に参照を記録するので使わない
 		type_string();
 		type_string(const timeval_type & current);
 		virtual ~type_string();
 		virtual type_types get_type() const { return string_type; }
 		virtual void output(std::shared_ptr<file_type> & dst) const;
 		virtual void output(std::string & dst) const;
+		virtual size_t get_memory_usage() const;
 		static std::shared_ptr<type_string> input(std::shared_ptr<file_type> & src);
 		static std::shared_ptr<type_string> input(std::pair<std::string::const_iterator,std::string::const_iterator> & src);
 		std::string get() const;
+		std::shared_ptr<const std::string> get_shared() const;
 		std::string & ref();
 		void set(const std::string & str);
+		void set_int(int64_t value);
 		int64_t append(const std::string & str);
 		int64_t setrange(size_t offset, const std::string & str);
 		bool is_int() const { return int_type; }
+		bool is_shared() const { return shared; }
+		int64_t get_int() const { return int_value; }
 		int64_t incrby(int64_t value);
+		static int64_t add_integer(int64_t value, int64_t count);
+		static bool parse_integer(const std::string & str, int64_t & value);
+		static std::shared_ptr<type_string> get_shared_integer(int64_t value);
 	private:
 		void to_int();
 		void to_str();
+		void unshare();
 	};
 };
 
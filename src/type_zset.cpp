@@ -64,10 +64,12 @@ namespace rediscpp
 		return lhs->member < rhs->member;
 	}
 	type_zset::type_zset()
+		: bytes(0)
 	{
 	}
 	type_zset::type_zset(const timeval_type & current)
 		: type_interface(current)
+		, bytes(0)
 	{
 	}
 	type_zset::~type_zset()
@@ -93,10 +95,11 @@ namespace rediscpp
 		for (auto it = members.begin(), end = members.end(); it != end; ++it, ++sit) {
 			auto & member = **it;
 			auto score = *sit;
-			std::shared_ptr<value_type> v(new value_type(member, score));
+			std::shared_ptr<value_type> v(make_value(member, score));
 			auto vit = value.find(member);
 			if (vit == value.end()) {
 				++created;
+				bytes += get_element_memory(member);
 				value.insert(std::make_pair(member, v));
 				sorted.insert(v);
 			} else {
@@ -115,6 +118,7 @@ namespace rediscpp
 			auto & member = **it;
 			auto vit = value.find(member);
 			if (vit != value.end()) {
+				bytes -= get_element_memory(member);
 				erase_sorted(vit->second);
 				value.erase(vit);
 				++removed;
@@ -138,14 +142,15 @@ namespace rediscpp
 	{
 		value.clear();
 		sorted.clear();
+		bytes = 0;
 	}
 	std::pair<type_zset::const_iterator,type_zset::const_iterator> type_zset::zrangebyscore(score_type minimum, score_type maximum, bool inclusive_minimum, bool inclusive_maximum) const
 	{
 		if (maximum < minimum) {
 			return std::make_pair(sorted.end(), sorted.end());
 		}
-		std::shared_ptr<value_type> min_value(new value_type(std::string(), minimum));
-		std::shared_ptr<value_type> max_value(new value_type(std::string(), maximum));
+		std::shared_ptr<value_type> min_value(make_value(std::string(), minimum));
+		std::shared_ptr<value_type> max_value(make_value(std::string(), maximum));
 		auto first = sorted.lower_bound(min_value);
 		auto last = sorted.lower_bound(max_value);
 		if (!inclusive_minimum) {
@@ -223,6 +228,16 @@ namespace rediscpp
 		score = it->second->score;
 		return true;
 	}
+	///afterより後のメンバーをメンバーの順に最大count個集める、afterがNULLなら最初から
+	///@return まだ残っていればtrue
+	bool type_zset::zscan(const std::string * after, size_t count, std::vector<std::pair<const std::string*,score_type>> & members) const
+	{
+		auto it = after ? value.upper_bound(*after) : value.begin();
+		for (auto end = value.end(); it != end && members.size() < count; ++it) {
+			members.push_back(std::make_pair(&it->first, it->second->score));
+		}
+		return it != value.end();
+	}
 	///@retval nan 中断
 	type_zset::score_type type_zset::zincrby(const std::string & member, score_type increment)
 	{
@@ -231,7 +246,8 @@ namespace rediscpp
 		}
 		auto it = value.find(member);
 		if (it == value.end()) {
-			std::shared_ptr<value_type> v(new value_type(member, increment));
+			std::shared_ptr<value_type> v(make_value(member, increment));
+			bytes += get_element_memory(member);
 			value.insert(std::make_pair(member, v));
 			sorted.insert(v);
 			return increment;
@@ -281,23 +297,25 @@ namespace rediscpp
 			} else if (lit->first < rit->first) {//only left
 				++lit;
 			} else {//only right, insert
-				std::shared_ptr<value_type> v(new value_type(*(rit->second)));
+				std::shared_ptr<value_type> v(make_value(*(rit->second)));
 				score_type after = v->score * weight;
 				if (isnan(after)) {
 					throw std::runtime_error("ERR nan score result found");
 				}
 				v->score = after;
+				bytes += get_element_memory(v->member);
 				value.insert(lit, std::make_pair(v->member, v));
 				sorted.insert(v);
 				++rit;
 			}
 		}
 		while (rit != rend) {//insert
-			std::shared_ptr<value_type> v(new value_type(*(rit->second)));
+			std::shared_ptr<value_type> v(make_value(*(rit->second)));
 			v->score *= weight;
 			if (isnan(v->score)) {
 				throw std::runtime_error("ERR nan score result found");
 			}
+			bytes += get_element_memory(v->member);
 			value.insert(lit, std::make_pair(v->member, v));
 			sorted.insert(v);
 			++rit;
@@ -341,6 +359,7 @@ namespace rediscpp
 				++lit;
 				++rit;
 			} else if (lit->first < rit->first) {//only left, erase
+				bytes -= get_element_memory(lit->first);
 				erase_sorted(lit->second);
 				auto eit = lit;
 				++lit;
@@ -350,6 +369,7 @@ namespace rediscpp
 			}
 		}
 		for (auto it = lit; it != value.end(); ++it) {//erase
+			bytes -= get_element_memory(it->first);
 			erase_sorted(it->second);
 		}
 		value.erase(lit, value.end());
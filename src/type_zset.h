@@ -31,16 +31,24 @@ namespace rediscpp
 		{
 			bool operator()(const std::shared_ptr<value_type> & lhs, const std::shared_ptr<value_type> & rhs) const;
 		};
-		std::map<std::string, std::shared_ptr<value_type>> value;//値でユニークな集合
-		std::set<std::shared_ptr<value_type>, score_comparer> sorted;//スコアで並べた状態
+		///要素と共有ポインタの管理領域を一つのブロックにしてnode_pool_typeから確保する
+		template<typename... Args> static std::shared_ptr<value_type> make_value(Args &&... args) { return std::allocate_shared<value_type>(node_allocator<value_type>(), std::forward<Args>(args)...); }
+		typedef std::map<std::string, std::shared_ptr<value_type>, std::less<std::string>, node_allocator<std::pair<const std::string, std::shared_ptr<value_type>>>> value_map_type;
+		typedef std::set<std::shared_ptr<value_type>, score_comparer, node_allocator<std::shared_ptr<value_type>>> sorted_set_type;
+		value_map_type value;//値でユニークな集合
+		sorted_set_type sorted;//スコアで並べた状態
+		size_t bytes;///<要素の大きさの合計
+		static const size_t node_memory = 192;///<valueとsortedの節と、共有したvalue_type
+		static size_t get_element_memory(const std::string & member) { return node_memory + get_string_memory(member.size()) * 2; }
 	public:
-		typedef std::set<std::shared_ptr<value_type>, score_comparer>::const_iterator const_iterator;
+		typedef sorted_set_type::const_iterator const_iterator;
 		type_zset();
 		type_zset(const timeval_type & current);
 		virtual ~type_zset();
 		virtual type_types get_type() const { return zset_type; }
 		virtual void output(std::shared_ptr<file_type> & dst) const;
 		virtual void output(std::string & dst) const;
+		virtual size_t get_memory_usage() const { return sizeof(*this) + bytes; }
 		static std::shared_ptr<type_zset> input(std::shared_ptr<file_type> & src);
 		static std::shared_ptr<type_zset> input(std::pair<std::string::const_iterator,std::string::const_iterator> & src);
 		size_t zadd(const std::vector<score_type> & scores, const std::vector<std::string*> & members);
@@ -55,6 +63,7 @@ namespace rediscpp
 		size_t zcount(score_type minimum, score_type maximum, bool inclusive_minimum, bool inclusive_maximum) const;
 		bool zrank(const std::string & member, size_t & rank, bool rev) const;
 		bool zscore(const std::string & member, score_type & score) const;
+		bool zscan(const std::string * after, size_t count, std::vector<std::pair<const std::string*,score_type>> & members) const;
 		score_type zincrby(const std::string & member, score_type increment);
 		void zunion(const type_zset & rhs, type_zset::score_type weight, aggregate_types aggregate);
 		void zinter(const type_zset & rhs, score_type weight, aggregate_types aggregate);
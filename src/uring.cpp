@@ -0,0 +1,1035 @@
+#include "uring.h"
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define REDIS_CPP_URING 1
+#endif
+#endif
+
+#ifdef REDIS_CPP_URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <signal.h>
+#include <unistd.h>
+#include <limits.h>
+#endif
+
+namespace rediscpp
+{
+#ifdef REDIS_CPP_URING
+	struct uring_poll_type::ring_type
+	{
+		io_uring_params params;
+		void * sq_ptr;
+		size_t sq_size;
+		void * cq_ptr;
+		size_t cq_size;
+		io_uring_sqe * sqes;
+		size_t sqes_size;
+		unsigned * sq_head;
+		unsigned * sq_tail;
+		unsigned sq_mask;
+		unsigned sq_entries;
+		unsigned * sq_array;
+		unsigned sq_local_tail;///<カーネルに公開する前のtail
+		unsigned * cq_head;
+		unsigned * cq_tail;
+		unsigned cq_mask;
+		io_uring_cqe * cqes;
+		ring_type()
+			: sq_ptr(MAP_FAILED)
+			, sq_size(0)
+			, cq_ptr(MAP_FAILED)
+			, cq_size(0)
+			, sqes(reinterpret_cast<io_uring_sqe *>(MAP_FAILED))
+			, sqes_size(0)
+			, sq_local_tail(0)
+		{
+			memset(&params, 0, sizeof(params));
+		}
+		~ring_type()
+		{
+			if (sqes != MAP_FAILED) {
+				munmap(sqes, sqes_size);
+			}
+			if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr) {
+				munmap(cq_ptr, cq_size);
+			}
+			if (sq_ptr != MAP_FAILED) {
+				munmap(sq_ptr, sq_size);
+			}
+		}
+	};
+	///multishot recvが選ぶ受信バッファ
+	///@note 受け取ったバッファはreapでコピーしたら、まとめてIORING_OP_PROVIDE_BUFFERSで戻す
+	struct uring_poll_type::buffer_pool_type
+	{
+		uint8_t * data;
+		size_t data_size;
+		std::vector<uint16_t> recycled;///<コピー済みで、まだカーネルに戻していないバッファ
+		buffer_pool_type()
+			: data(reinterpret_cast<uint8_t *>(MAP_FAILED))
+			, data_size(0)
+		{
+		}
+		~buffer_pool_type()
+		{
+			if (data != MAP_FAILED) {
+				munmap(data, data_size);
+			}
+		}
+		const uint8_t * get(uint16_t id) const { return data + static_cast<size_t>(id) * buffer_size; }
+	};
+	///dispatch後の再登録中のpoll、この間はSQに積むだけにする
+	static __thread uring_poll_type * batching_poll = NULL;
+	std::shared_ptr<poll_type> uring_poll_type::create()
+	{
+		io_uring_params params;
+		memset(&params, 0, sizeof(params));
+		int fd = syscall(__NR_io_uring_setup, queue_depth, &params);
+		if (fd < 0) {
+			lprintf(__FILE__, __LINE__, info_level, "io_uring_setup failed:%s", string_error(errno).c_str());
+			return std::shared_ptr<poll_type>();
+		}
+		std::shared_ptr<uring_poll_type> poll(new uring_poll_type(fd));
+		poll->ring->params = params;
+		//タイムアウト付きの待機にIORING_ENTER_EXT_ARGを使う
+		if (!(params.features & IORING_FEAT_EXT_ARG)) {
+			lputs(__FILE__, __LINE__, info_level, "io_uring does not support IORING_FEAT_EXT_ARG");
+			return std::shared_ptr<poll_type>();
+		}
+		if (!poll->map()) {
+			return std::shared_ptr<poll_type>();
+		}
+		poll->recv_enabled = poll->register_buffers();
+#ifdef IORING_ACCEPT_MULTISHOT
+		poll->accept_enabled = true;
+#endif
+		return poll;
+	}
+	uring_poll_type::uring_poll_type(int fd_)
+		: poll_type(fd_)
+		, ring(new ring_type())
+		, buffers(new buffer_pool_type())
+		, recv_enabled(false)
+		, accept_enabled(false)
+		, last_request(0)
+		, pending(0)
+	{
+	}
+	///@note 実行中のrecvがバッファに書かないように、先にringを閉じてからバッファを解放する
+	uring_poll_type::~uring_poll_type()
+	{
+		close();
+		buffers.reset();
+		ring.reset();
+		for (auto it = acceptors.begin(), end = acceptors.end(); it != end; ++it) {
+			for (auto fit = it->second.accepted.begin(), fend = it->second.accepted.end(); fit != fend; ++fit) {
+				::close(*fit);
+			}
+		}
+	}
+	bool uring_poll_type::map()
+	{
+		ring_type & r = *ring;
+		const io_uring_params & p = r.params;
+		r.sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+		r.cq_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+		const bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if (single) {
+			r.sq_size = r.cq_size = std::max(r.sq_size, r.cq_size);
+		}
+		r.sq_ptr = mmap(NULL, r.sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+		if (r.sq_ptr == MAP_FAILED) {
+			lprintf(__FILE__, __LINE__, error_level, "mmap(IORING_OFF_SQ_RING) failed:%s", string_error(errno).c_str());
+			return false;
+		}
+		if (single) {
+			r.cq_ptr = r.sq_ptr;
+		} else {
+			r.cq_ptr = mmap(NULL, r.cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+			if (r.cq_ptr == MAP_FAILED) {
+				lprintf(__FILE__, __LINE__, error_level, "mmap(IORING_OFF_CQ_RING) failed:%s", string_error(errno).c_str());
+				return false;
+			}
+		}
+		r.sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+		r.sqes = reinterpret_cast<io_uring_sqe *>(mmap(NULL, r.sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+		if (r.sqes == MAP_FAILED) {
+			lprintf(__FILE__, __LINE__, error_level, "mmap(IORING_OFF_SQES) failed:%s", string_error(errno).c_str());
+			return false;
+		}
+		uint8_t * sq = reinterpret_cast<uint8_t *>(r.sq_ptr);
+		uint8_t * cq = reinterpret_cast<uint8_t *>(r.cq_ptr);
+		r.sq_head = reinterpret_cast<unsigned *>(sq + p.sq_off.head);
+		r.sq_tail = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+		r.sq_mask = *reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+		r.sq_entries = *reinterpret_cast<unsigned *>(sq + p.sq_off.ring_entries);
+		r.sq_array = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+		r.sq_local_tail = *r.sq_tail;
+		r.cq_head = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+		r.cq_tail = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+		r.cq_mask = *reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+		r.cqes = reinterpret_cast<io_uring_cqe *>(cq + p.cq_off.cqes);
+		return true;
+	}
+	///受信バッファを全てカーネルに渡す
+	///@retval false 使えないので、受信もPOLL_ADDで待つ
+	///@note 起動時に一度だけ呼ぶので、完了を待って結果を確かめる
+	bool uring_poll_type::register_buffers()
+	{
+#ifdef IORING_RECV_MULTISHOT
+		buffer_pool_type & b = *buffers;
+		b.data_size = static_cast<size_t>(buffer_count) * buffer_size;
+		b.data = reinterpret_cast<uint8_t *>(mmap(NULL, b.data_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+		if (b.data == MAP_FAILED) {
+			lprintf(__FILE__, __LINE__, error_level, "mmap(buffers) failed:%s", string_error(errno).c_str());
+			return false;
+		}
+		b.recycled.reserve(buffer_count);
+		if (!push_provide(0, buffer_count)) {
+			return false;
+		}
+		int r = enter(pending, 1, -1);
+		pending = 0;
+		ring_type & ring_ = *ring;
+		unsigned head = *ring_.cq_head;
+		if (r < 0 || head == __atomic_load_n(ring_.cq_tail, __ATOMIC_ACQUIRE)) {
+			lprintf(__FILE__, __LINE__, info_level, "io_uring provide buffers failed, recv with poll:%s", string_error(r < 0 ? -r : EAGAIN).c_str());
+			return false;
+		}
+		const int res = ring_.cqes[head & ring_.cq_mask].res;
+		__atomic_store_n(ring_.cq_head, head + 1, __ATOMIC_RELEASE);
+		if (res < 0) {
+			lprintf(__FILE__, __LINE__, info_level, "io_uring provide buffers is not available, recv with poll:%s", string_error(-res).c_str());
+			return false;
+		}
+		return true;
+#else
+		return false;
+#endif
+	}
+	///空きSQEを返す、満杯ならば一度投入する
+	///@note mutexを取得して呼ぶ
+	void * uring_poll_type::get_sqe()
+	{
+		ring_type & r = *ring;
+		if (r.sq_entries <= r.sq_local_tail - __atomic_load_n(r.sq_head, __ATOMIC_ACQUIRE)) {
+			submit();
+			if (r.sq_entries <= r.sq_local_tail - __atomic_load_n(r.sq_head, __ATOMIC_ACQUIRE)) {
+				lputs(__FILE__, __LINE__, error_level, "io_uring submission queue is full");
+				return NULL;
+			}
+		}
+		io_uring_sqe * sqe = &r.sqes[r.sq_local_tail & r.sq_mask];
+		memset(sqe, 0, sizeof(*sqe));
+		return sqe;
+	}
+	void uring_poll_type::commit_sqe()
+	{
+		ring_type & r = *ring;
+		unsigned index = r.sq_local_tail & r.sq_mask;
+		r.sq_array[index] = index;
+		++r.sq_local_tail;
+		__atomic_store_n(r.sq_tail, r.sq_local_tail, __ATOMIC_RELEASE);
+		++pending;
+	}
+	///@return 要求の番号、失敗時は0
+	uint64_t uring_poll_type::push_poll_add(pollable_type * pollable, uint32_t events)
+	{
+		io_uring_sqe * sqe = reinterpret_cast<io_uring_sqe *>(get_sqe());
+		if (!sqe) {
+			return 0;
+		}
+		uint32_t mask = events & ~(EPOLLET | EPOLLONESHOT);
+#if __BYTE_ORDER == __BIG_ENDIAN
+		mask = (mask << 16) | (mask >> 16);
+#endif
+		uint64_t request = ++last_request;
+		sqe->opcode = IORING_OP_POLL_ADD;
+		sqe->fd = pollable->get_handle();
+		sqe->poll32_events = mask;
+		sqe->user_data = request;
+		commit_sqe();
+		requests[request] = request_type(pollable, events);
+		return request;
+	}
+	///@note 完了通知は不要なのでuser_dataは0にする
+	bool uring_poll_type::push_poll_remove(uint64_t request)
+	{
+		io_uring_sqe * sqe = reinterpret_cast<io_uring_sqe *>(get_sqe());
+		if (!sqe) {
+			return false;
+		}
+		sqe->opcode = IORING_OP_POLL_REMOVE;
+		sqe->fd = -1;
+		sqe->addr = request;
+		sqe->user_data = 0;
+		commit_sqe();
+		return true;
+	}
+	///渡した受信バッファから選んで受信し続けるrecv
+	///@return 要求の番号、失敗時は0
+	uint64_t uring_poll_type::push_recv(pollable_type * pollable)
+	{
+#ifdef IORING_RECV_MULTISHOT
+		io_uring_sqe * sqe = reinterpret_cast<io_uring_sqe *>(get_sqe());
+		if (!sqe) {
+			return 0;
+		}
+		uint64_t request = ++last_request;
+		sqe->opcode = IORING_OP_RECV;
+		sqe->fd = pollable->get_handle();
+		sqe->ioprio = IORING_RECV_MULTISHOT;
+		sqe->flags = IOSQE_BUFFER_SELECT;
+		sqe->buf_group = buffer_group;
+		sqe->user_data = request;
+		commit_sqe();
+		requests[request] = request_type(pollable, 0, recv_request);
+		return request;
+#else
+		return 0;
+#endif
+	}
+	///待ち受けソケットで受け付け続けるaccept
+	///@return 要求の番号、失敗時は0
+	uint64_t uring_poll_type::push_accept(pollable_type * pollable, uint32_t events)
+	{
+#ifdef IORING_ACCEPT_MULTISHOT
+		io_uring_sqe * sqe = reinterpret_cast<io_uring_sqe *>(get_sqe());
+		if (!sqe) {
+			return 0;
+		}
+		uint64_t request = ++last_request;
+		sqe->opcode = IORING_OP_ACCEPT;
+		sqe->fd = pollable->get_handle();
+		sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+		sqe->user_data = request;
+		commit_sqe();
+		requests[request] = request_type(pollable, events, accept_request);
+		return request;
+#else
+		return 0;
+#endif
+	}
+	///send_bufferの先頭から、IOV_MAX個ずつ送るsendmsgをIOSQE_IO_LINKで連結して積む
+	///@retval false 送るデータが無いか、SQに空きが無い
+	///@note 連結の途中で投入が分かれないように、SQの空きが足りなければ先に投入する
+	///@note 一部しか送れなかったsendmsgの後ろは取り消されるので、送れた分だけ除いて再登録時に送り直す
+	bool uring_poll_type::push_send(pollable_type * pollable, receiver_type & receiver)
+	{
+		socket_type * socket = static_cast<socket_type *>(pollable);
+		socket->consume_sent();
+		send_buffer_type & buffer = socket->get_send_buffer();
+		if (buffer.empty()) {
+			return false;
+		}
+		ring_type & r = *ring;
+		size_t vector_count = std::min<size_t>(buffer.get_segment_count(), max_linked_sends * IOV_MAX);
+		size_t message_count = (vector_count + IOV_MAX - 1) / IOV_MAX;
+		if (r.sq_entries - (r.sq_local_tail - __atomic_load_n(r.sq_head, __ATOMIC_ACQUIRE)) < message_count) {
+			submit();
+			message_count = std::min<size_t>(message_count, r.sq_entries - (r.sq_local_tail - __atomic_load_n(r.sq_head, __ATOMIC_ACQUIRE)));
+			if (!message_count) {
+				return false;
+			}
+			vector_count = std::min<size_t>(vector_count, message_count * IOV_MAX);
+		}
+		if (!receiver.chain || receiver.chain.use_count() != 1) {
+			receiver.chain.reset(new send_chain_type());
+		}
+		send_chain_type & chain = *receiver.chain;
+		chain.vectors.resize(vector_count);
+		chain.messages.resize(message_count);
+		chain.requests.clear();
+		buffer.get_iovec(&chain.vectors[0], vector_count, chain.bytes);
+		chain.remaining = static_cast<unsigned>(message_count);
+		chain.sent = 0;
+		chain.error = 0;
+		for (size_t i = 0; i < message_count; ++i) {
+			msghdr & message = chain.messages[i];
+			memset(&message, 0, sizeof(message));
+			message.msg_iov = &chain.vectors[i * IOV_MAX];
+			message.msg_iovlen = std::min<size_t>(IOV_MAX, vector_count - i * IOV_MAX);
+			io_uring_sqe * sqe = reinterpret_cast<io_uring_sqe *>(get_sqe());
+			uint64_t request = ++last_request;
+			sqe->opcode = IORING_OP_SENDMSG;
+			sqe->fd = pollable->get_handle();
+			sqe->addr = reinterpret_cast<uint64_t>(&message);
+			sqe->len = 1;
+			sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+			if (i + 1 < message_count) {
+				sqe->flags = IOSQE_IO_LINK;
+			}
+			sqe->user_data = request;
+			commit_sqe();
+			request_type info(pollable, 0, send_request);
+			info.chain = receiver.chain;
+			requests[request] = info;
+			chain.requests.push_back(request);
+			++socket_type::send_submission_count;
+		}
+		receiver.sending = true;
+		socket->start_external_send();
+		return true;
+	}
+	///@note 取り消したrecvの最後の完了通知は、要求を消してあるのでreapで捨てる
+	bool uring_poll_type::push_cancel(uint64_t request)
+	{
+		io_uring_sqe * sqe = reinterpret_cast<io_uring_sqe *>(get_sqe());
+		if (!sqe) {
+			return false;
+		}
+		sqe->opcode = IORING_OP_ASYNC_CANCEL;
+		sqe->fd = -1;
+		sqe->addr = request;
+		sqe->user_data = 0;
+		commit_sqe();
+		return true;
+	}
+	///待機中のスレッドを起こして、readyを処理させる
+	bool uring_poll_type::push_nop()
+	{
+		io_uring_sqe * sqe = reinterpret_cast<io_uring_sqe *>(get_sqe());
+		if (!sqe) {
+			return false;
+		}
+		sqe->opcode = IORING_OP_NOP;
+		sqe->user_data = 0;
+		commit_sqe();
+		return true;
+	}
+	///受信バッファのidからcount個をカーネルに渡す
+	///@note 完了通知は不要なのでuser_dataは0にする
+	bool uring_poll_type::push_provide(uint16_t id, unsigned count)
+	{
+		io_uring_sqe * sqe = reinterpret_cast<io_uring_sqe *>(get_sqe());
+		if (!sqe) {
+			return false;
+		}
+		sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+		sqe->fd = count;
+		sqe->addr = reinterpret_cast<uint64_t>(buffers->get(id));
+		sqe->len = buffer_size;
+		sqe->off = id;
+		sqe->buf_group = buffer_group;
+		sqe->user_data = 0;
+		commit_sqe();
+		return true;
+	}
+	///コピー済みのバッファを、連続するidをまとめてカーネルに戻す
+	void uring_poll_type::provide_recycled()
+	{
+		std::vector<uint16_t> & recycled = buffers->recycled;
+		std::sort(recycled.begin(), recycled.end());
+		for (size_t i = 0, size = recycled.size(); i < size; ) {
+			size_t j = i + 1;
+			while (j < size && recycled[j] == recycled[j - 1] + 1) {
+				++j;
+			}
+			push_provide(recycled[i], static_cast<unsigned>(j - i));
+			i = j;
+		}
+		recycled.clear();
+	}
+	///@return 投入した数、失敗時は-errno
+	int uring_poll_type::enter(unsigned to_submit, unsigned min_complete, int timeout_milli_sec)
+	{
+		unsigned flags = 0;
+		__kernel_timespec ts;
+		io_uring_getevents_arg arg;
+		memset(&arg, 0, sizeof(arg));
+		if (min_complete) {
+			flags |= IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+			arg.sigmask_sz = _NSIG / 8;
+			if (0 <= timeout_milli_sec) {
+				ts.tv_sec = timeout_milli_sec / 1000;
+				ts.tv_nsec = (timeout_milli_sec % 1000) * 1000000LL;
+				arg.ts = reinterpret_cast<uint64_t>(&ts);
+			}
+		}
+		int r = syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, min_complete ? &arg : NULL, min_complete ? sizeof(arg) : 0);
+		++syscall_count;
+		return r < 0 ? -errno : r;
+	}
+	///積んだSQEを待たずに投入する
+	///@note mutexを取得して呼ぶ
+	void uring_poll_type::submit()
+	{
+		if (!pending) {
+			return;
+		}
+		int r = enter(pending, 0, 0);
+		if (r < 0) {
+			if (r != -EINTR && r != -EAGAIN && r != -EBUSY) {
+				lprintf(__FILE__, __LINE__, error_level, "io_uring_enter failed:%s", string_error(-r).c_str());
+			}
+			return;
+		}
+		pending -= std::min<unsigned>(pending, r);
+	}
+	///@note EPOLLET, EPOLLONESHOTを除けばepollとpollのイベント値は同じ
+	static uint32_t get_poll_events(int res)
+	{
+		uint32_t mask = res < 0 ? static_cast<uint32_t>(EPOLLERR) : static_cast<uint32_t>(res);
+#if __BYTE_ORDER == __BIG_ENDIAN
+		mask = (mask << 16) | (mask >> 16);
+#endif
+		return mask;
+	}
+	///ソケットのイベントを返す、このreapで返したものなら同じイベントに加える
+	///@note 返したソケットは処理が終わって再登録されるまで、受信したデータをstashに溜める
+	void uring_poll_type::emit(std::vector<epoll_event> & events, size_t & n, pollable_type * pollable, receiver_type & receiver, uint32_t mask)
+	{
+		if (receiver.delivering) {
+			events[receiver.delivering - 1].events |= mask;
+			return;
+		}
+		events[n].events = mask;
+		events[n].data.ptr = pollable;
+		++n;
+		receiver.armed = false;
+		receiver.delivering = n;
+		delivering.push_back(&receiver);
+	}
+	///処理中に溜めたデータとEOF、エラーを渡す
+	void uring_poll_type::deliver(std::vector<epoll_event> & events, size_t & n, pollable_type * pollable, receiver_type & receiver)
+	{
+		socket_type * socket = static_cast<socket_type *>(pollable);
+		uint32_t mask = 0;
+		if (!receiver.stash.empty()) {
+			socket->get_recv().append(receiver.stash.data(), receiver.stash.size());
+			if (max_stashed_bytes < receiver.stash.capacity()) {
+				std::string().swap(receiver.stash);
+			} else {
+				receiver.stash.clear();
+			}
+			mask |= EPOLLIN;
+		}
+		if (receiver.eof) {
+			receiver.eof = false;
+			socket->finish_recv();
+			mask |= EPOLLIN;
+		}
+		if (receiver.error) {
+			receiver.error = 0;
+			mask |= EPOLLERR;
+		}
+		if (receiver.sent) {
+			receiver.sent = false;
+			mask |= EPOLLOUT;
+		}
+		if (mask) {
+			emit(events, n, pollable, receiver, mask);
+		}
+	}
+	///recvの完了通知を処理する
+	///@param[in] more 同じrecvの完了通知が続く
+	///@note 登録中か、このreapで返したソケットならrecv_bufferに直接入れ、それ以外はstashに溜める
+	///@note stashが大きくなりすぎたらrecvを取り消し、再登録時に始め直すので、カーネルの受信バッファで送信側を待たせる
+	void uring_poll_type::received(std::vector<epoll_event> & events, size_t & n, pollable_type * pollable, receiver_type & receiver, int res, bool more, const uint8_t * data)
+	{
+		socket_type * socket = static_cast<socket_type *>(pollable);
+		const bool owned = receiver.armed || receiver.delivering;
+		if (!more) {
+			receiver.recv = 0;
+		}
+		if (0 < res && data) {
+			++socket_type::recv_completion_count;
+			if (owned) {
+				socket->get_recv().append(data, res);
+				emit(events, n, pollable, receiver, EPOLLIN);
+			} else {
+				receiver.stash.append(reinterpret_cast<const char *>(data), res);
+				if (max_stashed_bytes < receiver.stash.size() && receiver.recv && !receiver.throttled) {
+					push_cancel(receiver.recv);
+					receiver.throttled = true;
+				}
+			}
+		} else if (res == 0) {
+			receiver.input_closed = true;
+			if (owned) {
+				socket->finish_recv();
+				emit(events, n, pollable, receiver, EPOLLIN);
+			} else {
+				receiver.eof = true;
+			}
+		} else if (res == -EINVAL) {
+			//multishot recvが使えないカーネルでは、受信もPOLL_ADDで待つ
+			if (recv_enabled) {
+				lputs(__FILE__, __LINE__, info_level, "io_uring multishot recv is not available, recv with poll");
+				recv_enabled = false;
+			}
+			receiver.polling = true;
+			socket->set_external_recv(false);
+			if (receiver.armed) {
+				if (receiver.poll) {
+					push_poll_remove(receiver.poll);
+					requests.erase(receiver.poll);
+				}
+				receiver.poll = push_poll_add(pollable, receiver.events);
+			}
+		} else if (res == -ENOBUFS) {
+			//バッファを戻してから始め直す
+			if (!receiver.recv && !receiver.starved) {
+				receiver.starved = true;
+				starved.push_back(pollable);
+			}
+		} else if (res != -ECANCELED) {
+			receiver.input_closed = true;
+			if (owned) {
+				emit(events, n, pollable, receiver, EPOLLERR);
+			} else {
+				receiver.error = res;
+			}
+		}
+		//途中で終わった場合は続けて受信する
+		if (!receiver.recv && !receiver.input_closed && !receiver.throttled && !receiver.polling && !receiver.starved) {
+			receiver.recv = push_recv(pollable);
+		}
+	}
+	///acceptの完了通知を処理する
+	///@note 受け付けたソケットは溜めておき、溜まっていなかった時だけイベントを返す、on_serverは溜まっている間は取り出し続ける
+	///@note 取り消した待ち受けソケットのacceptが受け付けたソケットは閉じる
+	void uring_poll_type::accepted(std::vector<epoll_event> & events, size_t & n, uint64_t request, const request_type & info, int res, bool more)
+	{
+		auto ait = info.pollable ? acceptors.find(info.pollable) : acceptors.end();
+		if (ait == acceptors.end() || ait->second.accept != request) {
+			if (0 <= res) {
+				::close(res);
+			}
+			return;
+		}
+		acceptor_type & acceptor = ait->second;
+		if (!more) {
+			acceptor.accept = 0;
+		}
+		if (0 <= res) {
+			++socket_type::accept_completion_count;
+			acceptor.accepted.push_back(res);
+			if (acceptor.accepted.size() == 1) {
+				events[n].events = EPOLLIN;
+				events[n].data.ptr = info.pollable;
+				++n;
+			}
+		} else if (res == -EINVAL) {
+			//multishot acceptが使えないカーネルでは、POLL_ADDで待ってacceptを呼ばせる
+			if (accept_enabled) {
+				lputs(__FILE__, __LINE__, info_level, "io_uring multishot accept is not available, accept with poll");
+				accept_enabled = false;
+			}
+			for (auto it = acceptor.accepted.begin(), end = acceptor.accepted.end(); it != end; ++it) {
+				::close(*it);
+			}
+			acceptors.erase(ait);
+			uint64_t next = push_poll_add(info.pollable, info.events);
+			if (next) {
+				armed[info.pollable] = next;
+			}
+			return;
+		}
+		//途中で終わった場合は受け付け直す
+		if (!acceptor.accept && res != -ECANCELED) {
+			acceptor.accept = push_accept(info.pollable, info.events);
+		}
+	}
+	///sendmsgの完了通知を処理する
+	///@note 連結の最後の完了通知で送れたバイト数をソケットに渡し、続きを送らせる必要がある時だけイベントを返す
+	///@note 閉じたソケットのsendmsgは、引き取ったデータを最後の完了通知で解放するだけ
+	void uring_poll_type::sent(std::vector<epoll_event> & events, size_t & n, const request_type & info, int res)
+	{
+		send_chain_type & chain = *info.chain;
+		if (0 < res) {
+			chain.sent += res;
+		} else if (res < 0 && res != -ECANCELED && !chain.error) {
+			chain.error = res;
+		}
+		if (--chain.remaining || !info.pollable) {
+			return;
+		}
+		auto rit = receivers.find(info.pollable);
+		if (rit == receivers.end()) {
+			return;
+		}
+		receiver_type & receiver = rit->second;
+		socket_type * socket = static_cast<socket_type *>(info.pollable);
+		const bool owned = receiver.armed || receiver.delivering;
+		receiver.sending = false;
+		socket->finish_external_send(chain.sent);
+		if (chain.error) {
+			if (owned) {
+				emit(events, n, info.pollable, receiver, EPOLLERR);
+			} else {
+				receiver.error = chain.error;
+			}
+			return;
+		}
+		//送信中に応答が増えた、送り残した、多く送ったので解放させる、閉じる前の送信だった、受信が終わっている
+		if (receiver.wants_send || chain.sent < chain.bytes || release_sent_bytes <= chain.bytes || socket->is_closing() || receiver.input_closed) {
+			receiver.wants_send = false;
+			if (owned) {
+				emit(events, n, info.pollable, receiver, EPOLLOUT);
+			} else {
+				receiver.sent = true;
+			}
+		}
+	}
+	///完了通知をイベントに変換する
+	///@note EPOLLONESHOTでない登録は、epollのレベルトリガと同じになるように再登録する
+	///@note 受信バッファは、どの要求のものでもコピーしたらカーネルに戻し、足りずに止まったrecvはその後で始め直す
+	size_t uring_poll_type::reap(std::vector<epoll_event> & events, size_t limit)
+	{
+		mutex_locker locker(mutex);
+		size_t n = 0;
+		//データを溜めたまま再登録したソケットを先に返す
+		while (!ready.empty() && n < limit) {
+			pollable_type * pollable = ready.front();
+			ready.pop_front();
+			auto rit = receivers.find(pollable);
+			if (rit == receivers.end()) {
+				continue;
+			}
+			rit->second.queued = false;
+			if (rit->second.armed) {
+				deliver(events, n, pollable, rit->second);
+			}
+		}
+		ring_type & r = *ring;
+		unsigned head = *r.cq_head;
+		unsigned tail = __atomic_load_n(r.cq_tail, __ATOMIC_ACQUIRE);
+		for (; head != tail && n < limit; ++head) {
+			const io_uring_cqe & cqe = r.cqes[head & r.cq_mask];
+			const uint64_t request = cqe.user_data;
+			const int res = cqe.res;
+			const bool has_buffer = (cqe.flags & IORING_CQE_F_BUFFER) != 0;
+			const uint16_t buffer_id = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+			auto it = request ? requests.find(request) : requests.end();
+			if (it != requests.end()) {//見つからなければ、削除済みか再登録で置き換えられた
+				request_type info = it->second;
+				if (info.kind == recv_request) {
+					const bool more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+					if (!more) {
+						requests.erase(it);
+					}
+					received(events, n, info.pollable, receivers[info.pollable], res, more, has_buffer ? buffers->get(buffer_id) : NULL);
+				} else if (info.kind == accept_request) {
+					const bool more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+					if (!more) {
+						requests.erase(it);
+					}
+					accepted(events, n, request, info, res, more);
+				} else if (info.kind == send_request) {
+					requests.erase(it);
+					sent(events, n, info, res);
+				} else {
+					requests.erase(it);
+					auto rit = receivers.find(info.pollable);
+					if (rit != receivers.end()) {
+						receiver_type & receiver = rit->second;
+						if (receiver.poll == request) {
+							receiver.poll = 0;
+						}
+						if (res != -ECANCELED && (receiver.armed || receiver.delivering)) {
+							emit(events, n, info.pollable, receiver, get_poll_events(res));
+						}
+					} else {
+						auto ait = armed.find(info.pollable);
+						if (ait != armed.end() && ait->second == request) {
+							armed.erase(ait);
+						}
+						if (res != -ECANCELED) {
+							events[n].events = get_poll_events(res);
+							events[n].data.ptr = info.pollable;
+							++n;
+							if (!(info.events & EPOLLONESHOT)) {
+								uint64_t next = push_poll_add(info.pollable, info.events);
+								if (next) {
+									armed[info.pollable] = next;
+								}
+							}
+						}
+					}
+				}
+			}
+			if (has_buffer) {
+				buffers->recycled.push_back(buffer_id);
+			}
+		}
+		__atomic_store_n(r.cq_head, head, __ATOMIC_RELEASE);
+		//全てのバッファはコピー済みか未処理の完了通知にあるので、戻したときだけ始め直す
+		if (!buffers->recycled.empty()) {
+			provide_recycled();
+			for (auto it = starved.begin(), end = starved.end(); it != end; ++it) {
+				auto rit = receivers.find(*it);
+				if (rit == receivers.end() || !rit->second.starved) {
+					continue;
+				}
+				receiver_type & receiver = rit->second;
+				receiver.starved = false;
+				if (!receiver.recv && !receiver.input_closed && !receiver.throttled && !receiver.polling) {
+					receiver.recv = push_recv(*it);
+				}
+			}
+			starved.clear();
+		}
+		for (auto it = delivering.begin(), end = delivering.end(); it != end; ++it) {
+			(*it)->delivering = 0;
+		}
+		delivering.clear();
+		return n;
+	}
+	///multishot recvで受信し、連結したsendmsgで送信するソケットか
+	///@note multishot recvが使えなければ、受信はPOLL_ADDで待つ
+	bool uring_poll_type::is_receiver(pollable_type * pollable, uint32_t events) const
+	{
+		if (!(events & EPOLLIN) || !(events & EPOLLONESHOT)) {
+			return false;
+		}
+		socket_type * socket = dynamic_cast<socket_type *>(pollable);
+		return socket && !socket->is_listening();
+	}
+	///multishot recvで受信するソケットの登録
+	///@note recvは登録中ずっと続け、再登録では送信バッファの送信と、ファイル送信で送信可能を待つPOLL_ADDだけを行う
+	///@note 送信中に削除する場合は送信中のデータを引き取り、sendmsgを取り消す
+	///@note mutexを取得して呼ぶ
+	bool uring_poll_type::control_receiver(pollable_type * pollable, int op, uint32_t events)
+	{
+		socket_type * socket = static_cast<socket_type *>(pollable);
+		receiver_type & receiver = receivers[pollable];
+		if (receiver.poll) {
+			push_poll_remove(receiver.poll);
+			requests.erase(receiver.poll);
+			receiver.poll = 0;
+		}
+		if (op == EPOLL_CTL_DEL) {
+			if (receiver.recv) {
+				push_cancel(receiver.recv);
+				requests.erase(receiver.recv);
+			}
+			if (receiver.sending) {
+				send_chain_type & chain = *receiver.chain;
+				chain.detached.swap(socket->get_send_buffer());
+				for (auto it = chain.requests.begin(), end = chain.requests.end(); it != end; ++it) {
+					auto rit = requests.find(*it);
+					if (rit != requests.end()) {
+						rit->second.pollable = NULL;
+						push_cancel(*it);
+					}
+				}
+			}
+			if (receiver.queued) {
+				ready.erase(std::remove(ready.begin(), ready.end(), pollable), ready.end());
+			}
+			socket->set_external_recv(false);
+			socket->set_external_send(false);
+			receivers.erase(pollable);
+			return true;
+		}
+		if (op == EPOLL_CTL_ADD) {
+			receiver.polling = !recv_enabled;
+			socket->set_external_recv(!receiver.polling);
+			socket->set_external_send(true);
+		}
+		receiver.events = events;
+		receiver.armed = true;
+		receiver.throttled = false;
+		uint32_t poll_events = receiver.polling ? events : (events & EPOLLOUT);
+		if (events & EPOLLOUT) {
+			if (receiver.sending) {
+				receiver.wants_send = true;
+				poll_events &= ~EPOLLOUT;
+			} else if (push_send(pollable, receiver)) {
+				poll_events &= ~EPOLLOUT;
+			}
+		}
+		if (poll_events) {
+			receiver.poll = push_poll_add(pollable, poll_events | EPOLLONESHOT);
+			if (!receiver.poll) {
+				return false;
+			}
+		}
+		if (!receiver.polling && !receiver.recv && !receiver.input_closed) {
+			receiver.recv = push_recv(pollable);
+			if (!receiver.recv) {
+				return false;
+			}
+		}
+		if ((!receiver.stash.empty() || receiver.eof || receiver.error || receiver.sent) && !receiver.queued) {
+			ready.push_back(pollable);
+			receiver.queued = true;
+			push_nop();
+		}
+		return true;
+	}
+	///multishot acceptで受け付けるソケットか
+	bool uring_poll_type::is_acceptor(pollable_type * pollable, uint32_t events) const
+	{
+		if (!accept_enabled || !(events & EPOLLIN)) {
+			return false;
+		}
+		socket_type * socket = dynamic_cast<socket_type *>(pollable);
+		return socket && socket->is_listening();
+	}
+	///multishot acceptで受け付けるソケットの登録
+	///@note acceptは登録中ずっと続けるので、再登録では何もしない
+	///@note 削除する場合はacceptを取り消し、まだ取り出していないソケットを閉じる
+	///@note mutexを取得して呼ぶ
+	bool uring_poll_type::control_acceptor(pollable_type * pollable, int op, uint32_t events)
+	{
+		acceptor_type & acceptor = acceptors[pollable];
+		if (op == EPOLL_CTL_DEL) {
+			if (acceptor.accept) {
+				auto it = requests.find(acceptor.accept);
+				if (it != requests.end()) {
+					it->second.pollable = NULL;
+				}
+				push_cancel(acceptor.accept);
+			}
+			for (auto it = acceptor.accepted.begin(), end = acceptor.accepted.end(); it != end; ++it) {
+				::close(*it);
+			}
+			acceptors.erase(pollable);
+			return true;
+		}
+		if (!acceptor.accept) {
+			acceptor.accept = push_accept(pollable, events);
+			if (!acceptor.accept) {
+				return false;
+			}
+		}
+		return true;
+	}
+	bool uring_poll_type::pop_accepted(pollable_type * pollable, int & fd)
+	{
+		mutex_locker locker(mutex);
+		auto it = acceptors.find(pollable);
+		if (it == acceptors.end()) {
+			return false;
+		}
+		fd = -1;
+		if (!it->second.accepted.empty()) {
+			fd = it->second.accepted.front();
+			it->second.accepted.pop_front();
+		}
+		return true;
+	}
+	bool uring_poll_type::has_accepted(pollable_type * pollable)
+	{
+		mutex_locker locker(mutex);
+		auto it = acceptors.find(pollable);
+		return it != acceptors.end() && !it->second.accepted.empty();
+	}
+	///@param[in] op EPOLL_CTL_ADD, EPOLL_CTL_MOD, EPOLL_CTL_DEL
+	///@note 登録済みのPOLL_ADDは取り消してから登録し直す、古い完了通知はreapで捨てる
+	bool uring_poll_type::control(pollable_type * pollable, int op, uint32_t events)
+	{
+		mutex_locker locker(mutex);
+		bool result = true;
+		if (receivers.find(pollable) != receivers.end() || (op == EPOLL_CTL_ADD && is_receiver(pollable, events))) {
+			result = control_receiver(pollable, op, events);
+		} else if (acceptors.find(pollable) != acceptors.end() || (op == EPOLL_CTL_ADD && is_acceptor(pollable, events))) {
+			result = control_acceptor(pollable, op, events);
+		} else {
+			auto it = armed.find(pollable);
+			if (it != armed.end()) {
+				push_poll_remove(it->second);
+				requests.erase(it->second);
+				armed.erase(it);
+			}
+			if (op != EPOLL_CTL_DEL) {
+				uint64_t request = push_poll_add(pollable, events);
+				if (request) {
+					armed[pollable] = request;
+				} else {
+					result = false;
+				}
+			}
+		}
+		//dispatch後の再登録以外は、他のスレッドが待機中でも反映されるようにすぐ投入する
+		if (op != EPOLL_CTL_MOD || batching_poll != this) {
+			submit();
+		}
+		return result;
+	}
+	void uring_poll_type::flush_deferred(poll_batch_type & batch)
+	{
+		batching_poll = this;
+		poll_type::flush_deferred(batch);
+		batching_poll = NULL;
+	}
+	///完了通知が無ければ、積んだSQEの投入と待機を1回のio_uring_enterで行う
+	bool uring_poll_type::wait(std::vector<epoll_event> & events, int timeout_milli_sec)
+	{
+		if (static_cast<size_t>(count) < events.size()) {
+			events.resize(count);
+		}
+		if (events.empty()) {
+			return true;
+		}
+		const size_t limit = events.size();
+		size_t n = reap(events, limit);
+		unsigned to_submit = 0;
+		{
+			mutex_locker locker(mutex);
+			to_submit = pending;
+			pending = 0;
+		}
+		if (n == 0 || to_submit) {
+			int r = enter(to_submit, n ? 0 : 1, timeout_milli_sec);
+			++wait_count;
+			unsigned submitted = (r < 0) ? 0 : std::min<unsigned>(to_submit, r);
+			if (submitted < to_submit) {
+				mutex_locker locker(mutex);
+				pending += to_submit - submitted;
+			}
+			if (r < 0 && r != -ETIME && r != -EINTR && r != -EAGAIN && r != -EBUSY) {
+				events.clear();
+				lprintf(__FILE__, __LINE__, error_level, "io_uring_enter failed:%s", string_error(-r).c_str());
+				return false;
+			}
+			if (n == 0) {
+				n = reap(events, limit);
+			}
+		}
+		events.resize(n);
+		event_count += n;
+		send_ready(events);
+		return true;
+	}
+#else
+	struct uring_poll_type::ring_type
+	{
+	};
+	struct uring_poll_type::buffer_pool_type
+	{
+	};
+	std::shared_ptr<poll_type> uring_poll_type::create()
+	{
+		return std::shared_ptr<poll_type>();
+	}
+	uring_poll_type::~uring_poll_type()
+	{
+	}
+	bool uring_poll_type::control(pollable_type * pollable, int op, uint32_t events)
+	{
+		return false;
+	}
+	void uring_poll_type::flush_deferred(poll_batch_type & batch)
+	{
+		poll_type::flush_deferred(batch);
+	}
+	bool uring_poll_type::wait(std::vector<epoll_event> & events, int timeout_milli_sec)
+	{
+		events.clear();
+		return false;
+	}
+	bool uring_poll_type::pop_accepted(pollable_type * pollable, int & fd)
+	{
+		return false;
+	}
+	bool uring_poll_type::has_accepted(pollable_type * pollable)
+	{
+		return false;
+	}
+#endif
+}
@@ -0,0 +1,139 @@
+#ifndef INCLUDE_REDIS_CPP_URING_H
+#define INCLUDE_REDIS_CPP_URING_H
+
+#include "network.h"
+
+namespace rediscpp
+{
+	///io_uringで待機するpoll_type
+	///@note クライアントのソケットはIORING_OP_PROVIDE_BUFFERSで渡したバッファにmultishot recvで受信し、recv_bufferに移してからpollable_type::triggerに渡す
+	///@note クライアントのsend_bufferは、再登録時にIOSQE_IO_LINKで連結したsendmsgで送り、socket_type::sendではsendmsgしない
+	///@note 待ち受けソケットはmultishot acceptで受け付け、受け付けたソケットをsocket_type::acceptで取り出させる
+	///@note それ以外とファイル送信の待機はPOLL_ADDで待ち、通知はepollと同じくtriggerに渡す
+	///@note dispatch中の再登録はSQに積むだけで、次の待機のio_uring_enterでまとめて投入する
+	class uring_poll_type : public poll_type
+	{
+		struct ring_type;
+		struct buffer_pool_type;
+		enum request_kinds
+		{
+			poll_request,
+			recv_request,
+			accept_request,
+			send_request,
+		};
+		///IOSQE_IO_LINKで連結して投入したsendmsg
+		///@note 全ての完了通知を受け取るまでiovecとmsghdrを保持し、途中で閉じたソケットの送信中のデータはdetachedに引き取る
+		struct send_chain_type
+		{
+			std::vector<iovec> vectors;
+			std::vector<msghdr> messages;
+			std::vector<uint64_t> requests;
+			unsigned remaining;///<まだ完了通知を受け取っていないsendmsgの数
+			size_t bytes;///<投入したバイト数
+			size_t sent;///<送信できたバイト数
+			int error;
+			send_buffer_type detached;
+			send_chain_type() : remaining(0), bytes(0), sent(0), error(0) {}
+		};
+		struct request_type
+		{
+			pollable_type * pollable;///<取り消したacceptと、閉じたソケットのsendmsgではNULL
+			uint32_t events;
+			request_kinds kind;
+			std::shared_ptr<send_chain_type> chain;
+			request_type() : pollable(NULL), events(0), kind(poll_request) {}
+			request_type(pollable_type * pollable_, uint32_t events_, request_kinds kind_ = poll_request) : pollable(pollable_), events(events_), kind(kind_) {}
+		};
+		///multishot recvで受信するソケットの状態
+		///@note 登録中はrecv_bufferに直接追加し、処理中に届いた分はstashに溜めて再登録時に渡す
+		struct receiver_type
+		{
+			uint64_t recv;///<実行中のrecv、0なら無し
+			uint64_t poll;///<送信可能を待つPOLL_ADD、0なら無し
+			uint32_t events;
+			bool armed;///<登録されていてイベントを待っている
+			bool queued;///<readyに積んだ
+			bool throttled;///<処理中に溜まりすぎたのでrecvを止めた
+			bool starved;///<受信バッファが足りずにrecvが終わったので、戻すまで待つ
+			bool input_closed;///<EOFかエラーを受け取ったので、もうrecvしない
+			bool polling;///<multishot recvが使えないので、受信もPOLL_ADDで待つ
+			bool eof;///<まだ渡していないEOF
+			int error;///<まだ渡していないエラー
+			bool sending;///<連結したsendmsgが実行中
+			bool wants_send;///<送信中に再登録されたので、送り終えたら通知して続きを送らせる
+			bool sent;///<まだ渡していない送信の完了
+			size_t delivering;///<このreapで返したイベントの位置+1、0なら無し
+			std::string stash;///<処理中に受け取ったデータ
+			std::shared_ptr<send_chain_type> chain;///<送信中か、次の送信で使い回す連結
+			receiver_type() : recv(0), poll(0), events(0), armed(false), queued(false), throttled(false), starved(false), input_closed(false), polling(false), eof(false), error(0), sending(false), wants_send(false), sent(false), delivering(0) {}
+		};
+		///multishot acceptで受け付けるソケットの状態
+		struct acceptor_type
+		{
+			uint64_t accept;///<実行中のaccept、0なら無し
+			std::deque<int> accepted;///<受け付けて、まだsocket_type::acceptで取り出していないソケット
+			acceptor_type() : accept(0) {}
+		};
+		static const unsigned queue_depth = 4096;
+		static const unsigned buffer_count = 512;///<受信バッファの数
+		static const unsigned buffer_size = 8192;
+		static const uint16_t buffer_group = 0;
+		static const size_t max_stashed_bytes = 1024 * 1024;
+		static const size_t max_linked_sends = 4;///<一度に連結するsendmsgの数、それぞれIOV_MAX個まで送る
+		static const size_t release_sent_bytes = 64 * 1024;///<これ以上送ったら通知して、送信バッファを解放させる
+		std::unique_ptr<ring_type> ring;
+		std::unique_ptr<buffer_pool_type> buffers;
+		bool recv_enabled;///<multishot recvを使う
+		bool accept_enabled;///<multishot acceptを使う
+		mutex_type mutex;
+		uint64_t last_request;
+		std::unordered_map<uint64_t, request_type> requests;///<投入したPOLL_ADDとrecv
+		std::unordered_map<pollable_type *, uint64_t> armed;///<pollable毎の有効なPOLL_ADD
+		std::unordered_map<pollable_type *, receiver_type> receivers;
+		std::unordered_map<pollable_type *, acceptor_type> acceptors;
+		std::deque<pollable_type *> ready;///<溜めたデータを持ったまま再登録したソケット
+		std::vector<receiver_type *> delivering;///<reap中にイベントを返したソケット
+		std::vector<pollable_type *> starved;///<受信バッファを戻したらrecvを始め直すソケット
+		unsigned pending;///<SQに積んだが、まだ投入していない数
+		uring_poll_type(int fd_);
+		uring_poll_type(const uring_poll_type &);
+		bool map();
+		bool register_buffers();
+		void * get_sqe();
+		void commit_sqe();
+		uint64_t push_poll_add(pollable_type * pollable, uint32_t events);
+		bool push_poll_remove(uint64_t request);
+		uint64_t push_recv(pollable_type * pollable);
+		uint64_t push_accept(pollable_type * pollable, uint32_t events);
+		bool push_send(pollable_type * pollable, receiver_type & receiver);
+		bool push_cancel(uint64_t request);
+		bool push_nop();
+		bool push_provide(uint16_t id, unsigned count);
+		void provide_recycled();
+		int enter(unsigned to_submit, unsigned min_complete, int timeout_milli_sec);
+		void submit();
+		size_t reap(std::vector<epoll_event> & events, size_t limit);
+		bool is_receiver(pollable_type * pollable, uint32_t events) const;
+		bool control_receiver(pollable_type * pollable, int op, uint32_t events);
+		bool is_acceptor(pollable_type * pollable, uint32_t events) const;
+		bool control_acceptor(pollable_type * pollable, int op, uint32_t events);
+		void emit(std::vector<epoll_event> & events, size_t & n, pollable_type * pollable, receiver_type & receiver, uint32_t mask);
+		void deliver(std::vector<epoll_event> & events, size_t & n, pollable_type * pollable, receiver_type & receiver);
+		void received(std::vector<epoll_event> & events, size_t & n, pollable_type * pollable, receiver_type & receiver, int res, bool more, const uint8_t * data);
+		void accepted(std::vector<epoll_event> & events, size_t & n, uint64_t request, const request_type & info, int res, bool more);
+		void sent(std::vector<epoll_event> & events, size_t & n, const request_type & info, int res);
+	protected:
+		virtual bool control(pollable_type * pollable, int op, uint32_t events);
+		virtual void flush_deferred(poll_batch_type & batch);
+	public:
+		static std::shared_ptr<poll_type> create();
+		virtual ~uring_poll_type();
+		virtual const char * get_engine_name() const { return "io_uring"; }
+		virtual bool wait(std::vector<epoll_event> & events, int timeout_milli_sec = 0);
+		virtual bool pop_accepted(pollable_type * pollable, int & fd);
+		virtual bool has_accepted(pollable_type * pollable);
+	};
+}
+
+#endif
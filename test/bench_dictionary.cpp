@@ -0,0 +1,96 @@
+//キーの辞書のメモリ使用量と検索のベンチマーク
+//g++ -O2 -std=c++0x -I../src bench_dictionary.cpp ../src/dictionary.cpp ../src/expire_wheel.cpp ../src/expire_info.cpp ../src/timeval.cpp -o bench_dictionary
+//./bench_dictionary [keys]
+//@note 辞書の大きさは2倍ずつ増えるので、キー数によって負荷率が0.44から0.875の間で変わる
+#include "dictionary.h"
+#include <stdio.h>
+#include <malloc.h>
+#include <sys/time.h>
+
+using namespace rediscpp;
+
+//値の型は比較に関係しないので、共有する一つの値を入れる
+namespace rediscpp
+{
+	class type_interface
+	{
+	};
+}
+
+static double now()
+{
+	timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+static size_t allocated()
+{
+	struct mallinfo2 info = mallinfo2();
+	return info.uordblks + info.hblkhd;
+}
+static std::string make_key(size_t i)
+{
+	char key[32];
+	snprintf(key, sizeof(key), "key:%zu", i);
+	return key;
+}
+//以前のdatabase_typeの要素の持ち方
+typedef std::unordered_map<std::string,std::pair<std::shared_ptr<expire_info>,std::shared_ptr<type_interface>>> old_values_type;
+static size_t old_insert(old_values_type & values, size_t count, std::shared_ptr<type_interface> & value)
+{
+	size_t before = allocated();
+	for (size_t i = 0; i < count; ++i) {
+		values.insert(std::make_pair(make_key(i), std::make_pair(std::shared_ptr<expire_info>(new expire_info()), value)));
+	}
+	return allocated() - before;
+}
+static size_t new_insert(dictionary_type & values, size_t count, std::shared_ptr<type_interface> & value)
+{
+	size_t before = allocated();
+	for (size_t i = 0; i < count; ++i) {
+		values.insert(make_key(i)).first->value = value;
+	}
+	return allocated() - before;
+}
+//半分は存在しないキーを探す
+template<typename T, typename F>
+static double lookup(const T & values, size_t count, F found)
+{
+	size_t hits = 0;
+	double start = now();
+	for (size_t i = 0; i < count * 2; ++i) {
+		if (found(values, make_key((i * 7919) % (count * 2)))) {
+			++hits;
+		}
+	}
+	double elapsed = now() - start;
+	if (hits != count) {
+		printf("lookup mismatch %zu\n", hits);
+	}
+	return elapsed;
+}
+int main(int argc, char *argv[])
+{
+	size_t count = 1000000;
+	if (1 < argc) {
+		count = strtoull(argv[1], NULL, 10);
+	}
+	std::shared_ptr<type_interface> value(new type_interface());
+	size_t old_bytes, new_bytes;
+	double old_time, new_time;
+	{
+		old_values_type values;
+		old_bytes = old_insert(values, count, value);
+		old_time = lookup(values, count, [](const old_values_type & values, const std::string & key) { return values.find(key) != values.end(); });
+	}
+	{
+		dictionary_type values;
+		new_bytes = new_insert(values, count, value);
+		new_time = lookup(values, count, [](const dictionary_type & values, const std::string & key) { return values.find(key) != NULL; });
+		printf("dictionary capacity %zu, load %.2f\n", values.get_capacity(), static_cast<double>(values.size()) / values.get_capacity());
+	}
+	printf("%zu keys: unordered_map %6.1f bytes/key, dictionary %6.1f bytes/key (%.0f%% less)\n", count,
+		static_cast<double>(old_bytes) / count, static_cast<double>(new_bytes) / count, 100.0 - 100.0 * new_bytes / old_bytes);
+	printf("lookup: unordered_map %6.1f ns, dictionary %6.1f ns\n", old_time * 1e9 / (count * 2), new_time * 1e9 / (count * 2));
+	return 0;
+}
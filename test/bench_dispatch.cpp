@@ -0,0 +1,84 @@
+//コマンド表の検索のベンチマーク
+//g++ -O2 -std=c++0x -I../src bench_dispatch.cpp ../src/perfect_hash.cpp ../src/common.cpp -o bench_dispatch
+#include "perfect_hash.h"
+#include <stdio.h>
+#include <sys/time.h>
+
+using namespace rediscpp;
+
+static double now()
+{
+	timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+//server_type::build_api_mapで登録しているコマンド
+static const char * commands[] = {
+	"AUTH", "ECHO", "PING", "QUIT", "SELECT", "DBSIZE", "FLUSHALL", "FLUSHDB", "SHUTDOWN", "TIME",
+	"SLAVEOF", "SYNC", "REPLCONF", "MONITOR", "INFO", "MULTI", "EXEC", "DISCARD", "WATCH", "UNWATCH",
+	"KEYS", "DEL", "EXISTS", "EXPIRE", "EXPIREAT", "PERSIST", "TTL", "PTTL", "MOVE", "RANDOMKEY",
+	"RENAME", "RENAMENX", "TYPE", "SORT", "DUMP", "RESTORE", "GET", "SET", "SETEX", "SETNX", "PSETEX",
+	"STRLEN", "APPEND", "GETRANGE", "SUBSTR", "SETRANGE", "GETSET", "MGET", "MSET", "MSETNX", "DECR",
+	"DECRBY", "INCR", "INCRBY", "INCRBYFLOAT", "BITCOUNT", "BITOP", "GETBIT", "SETBIT", "BLPOP",
+	"BRPOP", "BRPOPLPUSH", "LPUSH", "RPUSH", "LPUSHX", "RPUSHX", "LPOP", "RPOP", "LINSERT", "LINDEX",
+	"LLEN", "LRANGE", "LREM", "LSET", "LTRIM", "RPOPLPUSH", "HDEL", "HEXISTS", "HGET", "HGETALL",
+	"HKEYS", "HVALS", "HINCRBY", "HINCRBYFLOAT", "HLEN", "HMGET", "HMSET", "HSET", "HSETNX", "SADD",
+	"SCARD", "SISMEMBER", "SMEMBERS", "SMOVE", "SPOP", "SRANDMEMBER", "SREM", "SDIFF", "SDIFFSTORE",
+	"SINTER", "SINTERSTORE", "SUNION", "SUNIONSTORE", "ZADD", "ZCARD", "ZCOUNT", "ZINCRBY",
+	"ZINTERSTORE", "ZUNIONSTORE", "ZRANGE", "ZREVRANGE", "ZRANGEBYSCORE", "ZREVRANGEBYSCORE", "ZRANK",
+	"ZREVRANK", "ZREM", "ZREMRANGEBYRANK", "ZREMRANGEBYSCORE", "ZSCORE",
+};
+int main(int argc, char *argv[])
+{
+	size_t loops = 20000;
+	if (1 < argc) {
+		loops = atoi(argv[1]);
+	}
+	const size_t count = sizeof(commands) / sizeof(*commands);
+	std::map<std::string,int> old_map;
+	perfect_hash_type new_hash;
+	for (size_t i = 0; i < count; ++i) {
+		old_map[commands[i]] = i;
+		new_hash.insert(commands[i]);
+	}
+	double build_start = now();
+	new_hash.build();
+	double build_time = now() - build_start;
+	//クライアントは小文字で送ることが多い
+	std::vector<std::string> requests;
+	for (size_t i = 0; i < count; ++i) {
+		std::string request = commands[i];
+		std::transform(request.begin(), request.end(), request.begin(), tolower);
+		requests.push_back(request);
+	}
+	size_t old_found = 0, new_found = 0;
+	double old_start = now();
+	for (size_t l = 0; l < loops; ++l) {
+		for (auto it = requests.begin(), end = requests.end(); it != end; ++it) {
+			//以前の実装は引数を大文字にしてからstd::mapで引く
+			std::string command = *it;
+			std::transform(command.begin(), command.end(), command.begin(), toupper);
+			if (old_map.find(command) != old_map.end()) {
+				++old_found;
+			}
+		}
+	}
+	double old_time = now() - old_start;
+	double new_start = now();
+	for (size_t l = 0; l < loops; ++l) {
+		for (auto it = requests.begin(), end = requests.end(); it != end; ++it) {
+			if (0 <= new_hash.find(*it)) {
+				++new_found;
+			}
+		}
+	}
+	double new_time = now() - new_start;
+	if (old_found != new_found || new_found != loops * count) {
+		printf("lookup mismatch\n");
+		return 1;
+	}
+	printf("%zu commands, %zu slots, seed %u, build %.3f ms\n", count, new_hash.get_slot_count(), new_hash.get_seed(), build_time * 1e3);
+	printf("old %6.1f ns/lookup, new %6.1f ns/lookup (x%.2f)\n",
+		old_time * 1e9 / old_found, new_time * 1e9 / new_found, old_time / new_time);
+	return 0;
+}
@@ -0,0 +1,210 @@
+//受信バッファとリクエスト解析のベンチマーク
+//g++ -O2 -std=c++0x -I../src bench_parser.cpp ../src/buffer.cpp ../src/common.cpp -o bench_parser
+#include "buffer.h"
+#include <stdio.h>
+#include <sys/time.h>
+
+using namespace rediscpp;
+
+static double now()
+{
+	timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+//以前のstd::dequeを使った実装
+class old_parser
+{
+	std::deque<uint8_t> buf;
+	int argument_count;
+	int argument_index;
+	int argument_size;
+	std::vector<std::string> arguments;
+	bool parse_line(std::string & line)
+	{
+		if (buf.size() < 2) {
+			return false;
+		}
+		auto begin = buf.begin();
+		auto end = buf.end();
+		--end;
+		auto it = std::find(begin, end, '\r');
+		if (it != end) {
+			line.assign(begin, it);
+			std::advance(it, 2);
+			buf.erase(begin, it);
+			return true;
+		}
+		return false;
+	}
+	bool parse_data(std::string & data, int size)
+	{
+		if (buf.size() < size + 2) {
+			return false;
+		}
+		auto begin = buf.begin();
+		auto end = begin;
+		std::advance(end, size);
+		data.assign(begin, end);
+		std::advance(end, 2);
+		buf.erase(begin, end);
+		return true;
+	}
+public:
+	old_parser() : argument_count(0), argument_index(0), argument_size(-2) {}
+	void feed(const std::string & data)
+	{
+		const uint8_t * src = reinterpret_cast<const uint8_t*>(data.c_str());
+		for (size_t offset = 0; offset < data.size(); offset += 1500) {
+			size_t len = std::min<size_t>(1500, data.size() - offset);
+			buf.insert(buf.end(), src + offset, src + offset + len);
+		}
+	}
+	size_t parse()
+	{
+		size_t commands = 0;
+		while (true) {
+			if (argument_count == 0) {
+				std::string line;
+				if (!parse_line(line)) {
+					break;
+				}
+				argument_count = atoi(line.c_str() + 1);
+				argument_index = 0;
+				arguments.clear();
+				arguments.resize(argument_count);
+			} else if (argument_index < argument_count) {
+				if (argument_size == -2) {
+					std::string line;
+					if (!parse_line(line)) {
+						break;
+					}
+					argument_size = atoi(line.c_str() + 1);
+				} else {
+					std::string data;
+					if (!parse_data(data, argument_size)) {
+						break;
+					}
+					arguments[argument_index] = data;
+					argument_size = -2;
+					++argument_index;
+				}
+			} else {
+				++commands;
+				argument_count = 0;
+			}
+		}
+		return commands;
+	}
+};
+//連続領域バッファとスキャナを使った実装
+class new_parser
+{
+	recv_buffer_type buf;
+	int argument_count;
+	int argument_index;
+	int argument_size;
+	std::vector<std::string> arguments;
+	bool parse_header(int64_t & value)
+	{
+		const uint8_t * crlf = buf.find_crlf();
+		if (!crlf) {
+			return false;
+		}
+		value = 0;
+		for (const uint8_t * it = buf.begin() + 1; it < crlf; ++it) {
+			value = value * 10 + (*it - '0');
+		}
+		buf.consume(crlf + 2 - buf.begin());
+		return true;
+	}
+public:
+	new_parser() : argument_count(0), argument_index(0), argument_size(-2) {}
+	void feed(const std::string & data)
+	{
+		const uint8_t * src = reinterpret_cast<const uint8_t*>(data.c_str());
+		for (size_t offset = 0; offset < data.size(); offset += 1500) {
+			size_t len = std::min<size_t>(1500, data.size() - offset);
+			buf.append(src + offset, len);
+		}
+	}
+	size_t parse()
+	{
+		size_t commands = 0;
+		while (true) {
+			if (argument_count == 0) {
+				int64_t count;
+				if (buf.empty() || !parse_header(count)) {
+					break;
+				}
+				argument_count = count;
+				argument_index = 0;
+				arguments.clear();
+				arguments.resize(argument_count);
+			} else if (argument_index < argument_count) {
+				if (argument_size == -2) {
+					int64_t size;
+					if (!parse_header(size)) {
+						break;
+					}
+					argument_size = size;
+				} else {
+					if (buf.size() < argument_size + 2) {
+						break;
+					}
+					arguments[argument_index].assign(reinterpret_cast<const char*>(buf.begin()), argument_size);
+					buf.consume(argument_size + 2);
+					argument_size = -2;
+					++argument_index;
+				}
+			} else {
+				++commands;
+				argument_count = 0;
+			}
+		}
+		return commands;
+	}
+};
+template<typename T>
+static double run(const std::vector<std::string> & batches, size_t loops, size_t & commands)
+{
+	T parser;
+	commands = 0;
+	double start = now();
+	for (size_t i = 0; i < loops; ++i) {
+		for (auto it = batches.begin(), end = batches.end(); it != end; ++it) {
+			parser.feed(*it);
+			commands += parser.parse();
+		}
+	}
+	return now() - start;
+}
+int main(int argc, char *argv[])
+{
+	size_t total = 200000;
+	if (1 < argc) {
+		total = atoi(argv[1]);
+	}
+	printf("scanner: %s\n", get_scanner_name());
+	int depths[] = {1, 16, 256};
+	for (int d = 0; d < 3; ++d) {
+		int depth = depths[d];
+		std::vector<std::string> batches;
+		for (int b = 0; b < 64; ++b) {
+			std::string batch;
+			for (int i = 0; i < depth; ++i) {
+				std::string key = format("key:%08d", b * depth + i);
+				std::string value(32 + (i % 64), 'v');
+				batch += format("*3\r\n$3\r\nSET\r\n$%zd\r\n%s\r\n$%zd\r\n%s\r\n", key.size(), key.c_str(), value.size(), value.c_str());
+			}
+			batches.push_back(batch);
+		}
+		size_t loops = std::max<size_t>(1, total / (64 * depth));
+		size_t old_commands = 0, new_commands = 0;
+		double old_time = run<old_parser>(batches, loops, old_commands);
+		double new_time = run<new_parser>(batches, loops, new_commands);
+		printf("depth %3d: old %8.1f ns/cmd, new %8.1f ns/cmd (%zu cmds, x%.2f)\n", depth,
+			old_time * 1e9 / old_commands, new_time * 1e9 / new_commands, new_commands, old_time / new_time);
+	}
+	return 0;
+}
@@ -0,0 +1,71 @@
+//KEYSとSCANのMATCHのパターン照合のベンチマーク
+//g++ -O2 -std=c++0x -I../src bench_pattern.cpp ../src/glob_pattern.cpp ../src/common.cpp -o bench_pattern
+//./bench_pattern [keys]
+//@note pattern_matchはキー毎にパターンを解釈し、glob_pattern_typeは一度だけ解析する
+#include "glob_pattern.h"
+#include <stdio.h>
+#include <sys/time.h>
+
+using namespace rediscpp;
+
+static double now()
+{
+	timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+static const char * const prefixes[] = { "user", "session", "cache", "order" };
+static std::string make_key(size_t i)
+{
+	char key[48];
+	snprintf(key, sizeof(key), "%s:%zu:%s", prefixes[i % 4], i, (i % 3) ? "name" : "email");
+	return key;
+}
+int main(int argc, char *argv[])
+{
+	size_t count = 10000000;
+	if (1 < argc) {
+		count = strtoull(argv[1], NULL, 10);
+	}
+	std::vector<std::string> keys;
+	keys.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		keys.push_back(make_key(i));
+	}
+	static const char * const patterns[] = {
+		"*",
+		"user:*",
+		"*:email",
+		"*:12345*",
+		"session:*:name",
+		"order:?5*:*a?l",
+		"[uo]*:1[0-4]*:name",
+		"cache:*\\:*",
+	};
+	printf("%zu keys\n", count);
+	printf("%-22s %10s %12s %12s %8s\n", "pattern", "matched", "old ns/key", "new ns/key", "speedup");
+	for (size_t p = 0; p < sizeof(patterns) / sizeof(*patterns); ++p) {
+		const std::string pattern = patterns[p];
+		size_t old_hits = 0, new_hits = 0;
+		double start = now();
+		for (auto it = keys.begin(), end = keys.end(); it != end; ++it) {
+			if (pattern_match(pattern, *it)) {
+				++old_hits;
+			}
+		}
+		double old_time = now() - start;
+		start = now();
+		glob_pattern_type matcher(pattern);
+		for (auto it = keys.begin(), end = keys.end(); it != end; ++it) {
+			if (matcher.match(*it)) {
+				++new_hits;
+			}
+		}
+		double new_time = now() - start;
+		if (old_hits != new_hits) {
+			printf("match mismatch %s %zu %zu\n", pattern.c_str(), old_hits, new_hits);
+		}
+		printf("%-22s %10zu %12.1f %12.1f %7.1fx\n", pattern.c_str(), new_hits, old_time * 1e9 / count, new_time * 1e9 / count, old_time / new_time);
+	}
+	return 0;
+}
@@ -0,0 +1,125 @@
+//応答の書き込みのベンチマーク
+//g++ -O2 -std=c++0x -I../src bench_reply.cpp ../src/reply.cpp ../src/buffer.cpp ../src/common.cpp -o bench_reply
+#include "reply.h"
+#include <stdio.h>
+#include <sys/time.h>
+
+using namespace rediscpp;
+
+static double now()
+{
+	timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+//以前のformatと書き込みキャッシュを使った実装
+class old_writer
+{
+	std::vector<uint8_t> write_cache;
+	send_buffer_type & buffer;
+	void raw(const std::string & raw)
+	{
+		if (raw.size() <= write_cache.capacity() - write_cache.size()) {
+			write_cache.insert(write_cache.end(), raw.begin(), raw.end());
+		} else if (raw.size() <= write_cache.capacity()) {
+			flush();
+			write_cache.insert(write_cache.end(), raw.begin(), raw.end());
+		} else {
+			flush();
+			buffer.append(raw.c_str(), raw.size());
+		}
+	}
+public:
+	old_writer(send_buffer_type & buffer_) : buffer(buffer_) { write_cache.reserve(1500); }
+	void multi_bulk(size_t count) { raw(format("*%zd\r\n", count)); }
+	void integer(int64_t value) { raw(format(":%" PRId64 "\r\n", value)); }
+	void bulk(const std::string & value)
+	{
+		raw(format("$%zd\r\n", value.size()));
+		raw(value);
+		raw("\r\n");
+	}
+	void flush()
+	{
+		if (!write_cache.empty()) {
+			buffer.append(&write_cache[0], write_cache.size());
+			write_cache.clear();
+		}
+	}
+};
+//新しいreply_encoder_typeを使った実装
+class new_writer
+{
+	reply_encoder_type encoder;
+public:
+	new_writer(send_buffer_type & buffer_) : encoder(buffer_) {}
+	void multi_bulk(size_t count) { encoder.multi_bulk(count); }
+	void integer(int64_t value) { encoder.integer(value); }
+	void bulk(const std::string & value) { encoder.bulk(value); }
+	void flush() {}
+};
+static std::string drain(send_buffer_type & buffer)
+{
+	std::string result;
+	iovec vectors[64];
+	while (!buffer.empty()) {
+		size_t len = 0;
+		size_t count = buffer.get_iovec(vectors, 64, len);
+		for (size_t i = 0; i < count; ++i) {
+			result.append(reinterpret_cast<const char *>(vectors[i].iov_base), vectors[i].iov_len);
+		}
+		buffer.consume(len);
+	}
+	return result;
+}
+template<typename T>
+static double run(const std::vector<std::string> & values, const std::vector<int64_t> & integers, size_t loops, std::string & sample)
+{
+	send_buffer_type buffer;
+	double start = now();
+	for (size_t i = 0; i < loops; ++i) {
+		T writer(buffer);
+		writer.multi_bulk(values.size());
+		for (auto it = values.begin(), end = values.end(); it != end; ++it) {
+			writer.bulk(*it);
+		}
+		writer.multi_bulk(integers.size());
+		for (auto it = integers.begin(), end = integers.end(); it != end; ++it) {
+			writer.integer(*it);
+		}
+		writer.flush();
+		if (i == 0) {
+			sample = drain(buffer);
+		} else {
+			buffer.clear();
+		}
+	}
+	return now() - start;
+}
+int main(int argc, char *argv[])
+{
+	size_t loops = 200;
+	if (1 < argc) {
+		loops = atoi(argv[1]);
+	}
+	const size_t elements = 10000;
+	std::vector<std::string> values;
+	std::vector<int64_t> integers;
+	for (size_t i = 0; i < elements; ++i) {
+		values.push_back(std::string(4 + (i % 60), 'v'));
+		integers.push_back(i % 3 ? static_cast<int64_t>(i) : static_cast<int64_t>(i * 1000003) * (i % 2 ? -1 : 1));
+	}
+	integers[0] = std::numeric_limits<int64_t>::min();
+	integers[1] = std::numeric_limits<int64_t>::max();
+	std::string old_sample, new_sample;
+	double old_time = run<old_writer>(values, integers, loops, old_sample);
+	double new_time = run<new_writer>(values, integers, loops, new_sample);
+	if (old_sample != new_sample) {
+		printf("output mismatch\n");
+		return 1;
+	}
+	const double tokens = static_cast<double>(loops) * (elements * 2 + 2);
+	printf("%zu elements x %zu: old %8.1f ns/token, new %8.1f ns/token (x%.2f)\n", elements, loops,
+		old_time * 1e9 / tokens, new_time * 1e9 / tokens, old_time / new_time);
+	return 0;
+}
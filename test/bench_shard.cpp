@@ -0,0 +1,140 @@
+//shard毎のロックによるSETのスループットのベンチマーク
+//g++ -O2 -std=c++0x -pthread bench_shard.cpp -o bench_shard
+//rediscpp -s 1 と rediscpp -s 16 を起動して、それぞれに対して実行し比較する
+//./bench_shard [host] [port] [seconds] [pipeline]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+static double now()
+{
+	timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+static int connect_to(const char * host, const char * port)
+{
+	addrinfo hints, * res = NULL;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(host, port, &hints, &res) != 0) {
+		return -1;
+	}
+	int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+	if (0 <= fd && connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+		close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(res);
+	if (0 <= fd) {
+		int on = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+	}
+	return fd;
+}
+static bool send_all(int fd, const std::string & data)
+{
+	for (size_t sent = 0; sent < data.size();) {
+		ssize_t r = send(fd, data.data() + sent, data.size() - sent, 0);
+		if (r <= 0) {
+			return false;
+		}
+		sent += r;
+	}
+	return true;
+}
+//+OK\r\nをcount個受け取る
+static bool recv_replies(int fd, size_t count)
+{
+	char buf[4096];
+	size_t lines = 0;
+	while (lines < count) {
+		ssize_t r = recv(fd, buf, sizeof(buf), 0);
+		if (r <= 0) {
+			return false;
+		}
+		for (ssize_t i = 0; i < r; ++i) {
+			if (buf[i] == '\n') {
+				++lines;
+			}
+		}
+	}
+	return true;
+}
+//各スレッドは別の接続で、自分のキーにSETし続ける
+static void worker(const char * host, const char * port, int id, size_t pipeline, std::atomic<bool> & running, std::atomic<uint64_t> & total, std::atomic<int> & failed)
+{
+	int fd = connect_to(host, port);
+	if (fd < 0) {
+		++failed;
+		return;
+	}
+	uint64_t count = 0;
+	std::string request;
+	std::string value(32, 'v');
+	for (uint64_t seq = 0; running; ) {
+		request.clear();
+		for (size_t i = 0; i < pipeline; ++i, ++seq) {
+			char key[64];
+			int len = snprintf(key, sizeof(key), "key:%d:%llu", id, static_cast<unsigned long long>(seq % 10000));
+			char header[128];
+			int hlen = snprintf(header, sizeof(header), "*3\r\n$3\r\nSET\r\n$%d\r\n", len);
+			request.append(header, hlen);
+			request.append(key, len);
+			hlen = snprintf(header, sizeof(header), "\r\n$%zu\r\n", value.size());
+			request.append(header, hlen);
+			request.append(value);
+			request.append("\r\n", 2);
+		}
+		if (!send_all(fd, request) || !recv_replies(fd, pipeline)) {
+			++failed;
+			break;
+		}
+		count += pipeline;
+	}
+	close(fd);
+	total += count;
+}
+int main(int argc, char *argv[])
+{
+	const char * host = 1 < argc ? argv[1] : "127.0.0.1";
+	const char * port = 2 < argc ? argv[2] : "6379";
+	double seconds = 3 < argc ? atof(argv[3]) : 2.0;
+	size_t pipeline = 4 < argc ? atoi(argv[4]) : 1;
+	if (pipeline < 1) {
+		pipeline = 1;
+	}
+	for (int threads = 1; threads <= 32; threads *= 2) {
+		std::atomic<bool> running(true);
+		std::atomic<uint64_t> total(0);
+		std::atomic<int> failed(0);
+		std::vector<std::thread> pool;
+		double start = now();
+		for (int i = 0; i < threads; ++i) {
+			pool.push_back(std::thread(worker, host, port, i, pipeline, std::ref(running), std::ref(total), std::ref(failed)));
+		}
+		usleep(static_cast<useconds_t>(seconds * 1000000));
+		running = false;
+		for (auto it = pool.begin(), end = pool.end(); it != end; ++it) {
+			it->join();
+		}
+		double elapsed = now() - start;
+		if (failed) {
+			printf("%2d threads: %d connections failed\n", threads, static_cast<int>(failed));
+			return 1;
+		}
+		printf("%2d threads: %10.0f SET/s\n", threads, total / elapsed);
+	}
+	return 0;
+}
@@ -0,0 +1,95 @@
+//キーの辞書のSCANが、表の大きさの変わる間もずっとあるキーを列挙するかのテスト
+//g++ -O2 -std=c++0x -I../src test_dictionary_scan.cpp ../src/dictionary.cpp ../src/expire_wheel.cpp ../src/expire_info.cpp ../src/timeval.cpp -o test_dictionary_scan
+//./test_dictionary_scan
+//@note 大きい表で何回か進めたカーソルは上位のビットが立っているので、移行中の小さい表と大きい表の両方から続きを列挙する
+#include "dictionary.h"
+#include <stdio.h>
+#include <set>
+
+using namespace rediscpp;
+
+namespace rediscpp
+{
+	class type_interface
+	{
+	};
+}
+
+static std::string make_key(size_t i)
+{
+	char key[32];
+	snprintf(key, sizeof(key), "key:%zu", i);
+	return key;
+}
+//calls回進めてからresizeで表の大きさを変え、最後まで列挙して、残っているキーが全て返ったか
+template<typename F>
+static bool scan_across(size_t count, size_t calls, F resize, const char * name)
+{
+	dictionary_type values;
+	for (size_t i = 0; i < count; ++i) {
+		values.insert(make_key(i));
+	}
+	std::set<std::string> seen;
+	auto callback = [&seen](const dictionary_type::entry_type & entry) { seen.insert(entry.key); };
+	uint64_t cursor = 0;
+	size_t done = 0;
+	for (; done < calls; ++done) {
+		cursor = values.scan(cursor, callback);
+		if (!cursor) {
+			return true;
+		}
+	}
+	std::set<std::string> kept;
+	resize(values, kept);
+	if (!values.is_rehashing()) {
+		printf("%s: %zu calls, not rehashing\n", name, calls);
+		return false;
+	}
+	do {
+		cursor = values.scan(cursor, callback);
+	} while (cursor);
+	size_t missing = 0;
+	for (auto it = kept.begin(), end = kept.end(); it != end; ++it) {
+		if (seen.find(*it) == seen.end()) {
+			++missing;
+		}
+	}
+	if (missing) {
+		printf("%s: %zu calls, %zu keys missing\n", name, calls, missing);
+		return false;
+	}
+	return true;
+}
+int main(int argc, char *argv[])
+{
+	const size_t count = 5000;
+	size_t failures = 0;
+	//5000個では8192の表で512グループなので、全ての開始位置を試す
+	for (size_t calls = 1; calls < 512; ++calls) {
+		//後ろから消して、縮める移行が始まったら止める
+		if (!scan_across(count, calls, [count](dictionary_type & values, std::set<std::string> & kept) {
+			size_t i = count;
+			while (!values.is_rehashing() && i) {
+				values.erase(make_key(--i));
+			}
+			for (size_t j = 0; j < i; ++j) {
+				kept.insert(make_key(j));
+			}
+		}, "shrink")) {
+			++failures;
+		}
+		//足して、広げる移行が始まったら止める
+		if (!scan_across(count, calls, [count](dictionary_type & values, std::set<std::string> & kept) {
+			for (size_t j = 0; j < count; ++j) {
+				kept.insert(make_key(j));
+			}
+			for (size_t i = count; !values.is_rehashing(); ++i) {
+				values.insert(make_key(i));
+			}
+		}, "grow")) {
+			++failures;
+		}
+	}
+	printf("%zu failures\n", failures);
+	return failures ? 1 : 0;
+}